@@ -93,6 +93,8 @@
 #define BLOCK_FLAG_BOTTOM_FIELD_FIRST 0x2000
 /** This block contains a single field from interlaced picture. */
 #define BLOCK_FLAG_SINGLE_FIELD  0x4000
+/** This block is not used as a reference and can be skipped if late */
+#define BLOCK_FLAG_DROPPABLE     0x8000
 
 /** This block contains an interlaced picture */
 #define BLOCK_FLAG_INTERLACED_MASK \
@@ -113,6 +113,14 @@ enum es_out_query_e
     ES_OUT_SPU_SET_HIGHLIGHT, /* arg1= es_out_id_t* (spu es),
                                  arg2= const vlc_spu_highlight_t *, res=can fail  */
 
+    /* Live playback: latency matters more than smoothness. The clock follows
+     * the sender and its pts delay slowly converges to the given jitter
+     * buffer instead of rebuffering when data is late, and the
+     * BLOCK_FLAG_DROPPABLE blocks of access units whose PTS is already late
+     * are all dropped before decoding.
+     * Can be called again as the source's jitter estimation changes. */
+    ES_OUT_SET_LIVE_JITTER, /* arg1=vlc_tick_t i_target res=can fail */
+
     /* First value usable for private control */
     ES_OUT_PRIVATE_START = 0x10000,
 };
@@ -193,6 +201,10 @@ static inline int es_out_ControlModifyPcrSystem( es_out_t *out, bool b_absolute,
 {
     return es_out_Control( out, ES_OUT_MODIFY_PCR_SYSTEM, b_absolute, i_system );
 }
+static inline int es_out_SetLiveJitter( es_out_t *out, vlc_tick_t i_target )
+{
+    return es_out_Control( out, ES_OUT_SET_LIVE_JITTER, i_target );
+}
 
 /**
  * @}
@@ -94,6 +94,19 @@ static void Close( vlc_object_t * );
     "track, can be increased in case of broken pictures due " \
     "to too small buffer.")
 #define DEFAULT_FRAME_BUFFER_SIZE 100000
+#define LIVE_TEXT N_("Low latency live mode")
+#define LIVE_LONGTEXT N_("Favor latency over smoothness: the jitter buffer " \
+    "follows the measured network jitter, playback follows the sender " \
+    "clock instead of rebuffering, and late non-reference frames are " \
+    "dropped.")
+#define SHARE_TEXT N_("Share RTSP sessions")
+#define SHARE_LONGTEXT N_("Players of this process opening the same live " \
+    "RTSP URL receive the data of a single session instead of each " \
+    "setting up its own.")
+#define LIVE_DELAY_TEXT N_("Live mode minimum delay (ms)")
+#define LIVE_DELAY_LONGTEXT N_("Smallest jitter buffer of the live mode, " \
+    "the measured jitter is added to it. The network caching value is " \
+    "the largest one.")
 
 vlc_module_begin ()
     set_description( N_("RTP/RTSP/SDP demuxer (using Live555)" ) )
@@ -141,6 +154,14 @@ vlc_module_begin ()
         add_integer( "rtsp-frame-buffer-size", DEFAULT_FRAME_BUFFER_SIZE,
                      FRAME_BUFFER_SIZE_TEXT, FRAME_BUFFER_SIZE_LONGTEXT,
                      true )
+        add_bool( "rtsp-live", false, LIVE_TEXT, LIVE_LONGTEXT, true )
+            change_safe()
+        add_integer( "rtsp-live-delay", 40, LIVE_DELAY_TEXT,
+                     LIVE_DELAY_LONGTEXT, true )
+            change_integer_range( 0, 1000 )
+            change_safe()
+        add_bool( "rtsp-share", false, SHARE_TEXT, SHARE_LONGTEXT, true )
+            change_safe()
 vlc_module_end ()
 
 
@@ -150,6 +171,23 @@ vlc_module_end ()
 
 namespace {
 
+/* Pool of receive blocks of one track, see RxPoolGet() */
+typedef struct
+{
+    vlc_mutex_t     lock;
+    block_t         *p_free;    /* spare blocks, chained with p_next */
+    unsigned        i_free;
+    unsigned        i_refs;     /* the track + blocks out of the pool */
+    size_t          i_capacity; /* payload size of the blocks, 0 once closed */
+} rx_pool_t;
+
+typedef struct
+{
+    block_t         self;
+    rx_pool_t       *p_pool;
+    size_t          i_capacity;
+} rx_block_t;
+
 typedef struct
 {
     demux_t         *p_demux;
@@ -170,8 +208,9 @@ typedef struct
     bool            b_discard_trunc;
     vlc_demux_chained_t *p_out_muxed;    /* for muxed stream */
 
-    uint8_t         *p_buffer;
-    unsigned int    i_buffer;
+    rx_pool_t       *p_pool;
+    block_t         *p_rx;      /* block live555 is receiving into */
+    unsigned int    i_buffer;   /* payload size of new receive blocks */
 
     bool            b_rtcp_sync;
     bool            b_flushing_discontinuity;
@@ -181,6 +220,11 @@ typedef struct
     int64_t         i_pcr;
     double          f_npt;
 
+    /* Interarrival jitter (RFC 3550 6.4.1), live mode only */
+    vlc_tick_t      i_transit;
+    vlc_tick_t      i_jitter;
+    uint8_t         i_hevc_tids; /* HEVC sub-layers from the SPS, 0 if unknown */
+
     struct dtsgen_t dtsgen;
 
     enum
@@ -193,6 +237,36 @@ typedef struct
 
 } live_track_t;
 
+/* Session shared by the demuxers opening the same URL, see HubJoin() */
+typedef struct live_sub_t live_sub_t;
+
+typedef struct
+{
+    char            *psz_url;
+    int             i_sub;
+    live_sub_t      **sub;      /* followers */
+    int             i_fmt;
+    es_format_t     *fmt;       /* formats of the owner tracks */
+} live_hub_t;
+
+typedef struct
+{
+    es_out_id_t     *p_es;
+    int             i_next_block_flags;
+} live_sub_es_t;
+
+struct live_sub_t
+{
+    live_hub_t      *p_hub;     /* NULL once the owner is gone */
+    vlc_cond_t      wait;
+    block_t         *p_first;   /* blocks and clock updates of the owner */
+    block_t         **pp_last;
+    size_t          i_queued;
+
+    int             i_es;
+    live_sub_es_t   *es;        /* indexed as the owner tracks */
+};
+
 class RTSPClientVlc;
 
 #define CAP_RATE_CONTROL        (1 << 1)
@@ -223,6 +297,7 @@ struct demux_sys_t
 
     /* */
     vlc_tick_t       i_pcr; /* The clock */
+    vlc_tick_t       i_pcr_obs; /* PCR update period, also its offset */
     bool             b_rtcp_sync; /* At least one track received sync */
     double           f_npt;
     double           f_npt_length;
@@ -247,6 +322,17 @@ struct demux_sys_t
     int              i_live555_ret; /* live555 callback return code */
 
     float            f_seek_request;/* In case we receive a seek request while paused*/
+
+    /* Shared session, owned or followed */
+    live_hub_t       *p_hub;
+    live_sub_t       *p_sub;
+
+    /* Live mode */
+    bool             b_live;
+    vlc_tick_t       i_live_delay;  /* smallest jitter buffer */
+    vlc_tick_t       i_live_max;    /* largest jitter buffer */
+    vlc_tick_t       i_live_target; /* last one given to the es_out */
+    vlc_tick_t       i_live_update; /* date of the next jitter check */
 };
 
 
@@ -273,11 +359,14 @@ public:
 static int Demux  ( demux_t * );
 static int Control( demux_t *, int, va_list );
 
+static int OpenSession  ( demux_t * );
 static int Connect      ( demux_t * );
 static int SessionsSetup( demux_t * );
 static int Play         ( demux_t *);
 static int ParseASF     ( demux_t * );
 static int RollOverTcp  ( demux_t * );
+static void UpdateLiveJitter( demux_t * );
+static void SetPCR      ( demux_t *, vlc_tick_t );
 
 static void StreamRead  ( void *, unsigned int, unsigned int,
                           struct timeval, unsigned int );
@@ -295,7 +384,512 @@ static unsigned char* parseVorbisConfigStr( char const* configStr,
 static char *passwordLessURL( vlc_url_t *url );
 
 #define PCR_OBS VLC_TICK_FROM_MS(250)
-#define PCR_OFF PCR_OBS
+#define LIVE_PCR_OBS VLC_TICK_FROM_MS(20)
+
+/* The live jitter buffer is the minimum delay plus that many times the
+ * largest interarrival jitter of the tracks */
+#define LIVE_JITTER_FACTOR 4
+#define LIVE_JITTER_PERIOD VLC_TICK_FROM_MS(500)
+
+/*****************************************************************************
+ * Receive block pool
+ *****************************************************************************
+ * live555 writes each frame straight into a block of the track pool, after
+ * RX_HEADROOM spare bytes for the AMR or H.261 header or the Annex B start
+ * code. Large frames are sent downstream in that block as is, small ones
+ * are copied out (see RxBlockTake()). Blocks come back to the pool when
+ * they are released, from any thread.
+ *****************************************************************************/
+#define RX_HEADROOM 4
+#define RX_TAILROOM 32 /* same end padding as block_Alloc() */
+#define RX_POOL_MAX 16 /* spare blocks kept by a pool */
+
+static void RxPoolFree( block_t *p_list )
+{
+    while( p_list )
+    {
+        block_t *p_next = p_list->p_next;
+        free( container_of( p_list, rx_block_t, self ) );
+        p_list = p_next;
+    }
+}
+
+static void RxBlockRelease( block_t *p_block )
+{
+    rx_block_t *p_rx = container_of( p_block, rx_block_t, self );
+    rx_pool_t *p_pool = p_rx->p_pool;
+
+    vlc_mutex_lock( &p_pool->lock );
+    if( p_rx->i_capacity == p_pool->i_capacity && p_pool->i_free < RX_POOL_MAX )
+    {
+        p_block->p_next = p_pool->p_free;
+        p_pool->p_free = p_block;
+        p_pool->i_free++;
+        p_rx = NULL;
+    }
+    bool b_last = --p_pool->i_refs == 0;
+    vlc_mutex_unlock( &p_pool->lock );
+
+    free( p_rx );
+    if( b_last )
+    {
+        vlc_mutex_destroy( &p_pool->lock );
+        free( p_pool );
+    }
+}
+
+static const struct vlc_block_callbacks rx_block_cbs =
+{
+    RxBlockRelease,
+};
+
+static rx_pool_t *RxPoolNew( size_t i_capacity )
+{
+    rx_pool_t *p_pool = (rx_pool_t *)malloc( sizeof( *p_pool ) );
+    if( !p_pool )
+        return NULL;
+    vlc_mutex_init( &p_pool->lock );
+    p_pool->p_free = NULL;
+    p_pool->i_free = 0;
+    p_pool->i_refs = 1;
+    p_pool->i_capacity = i_capacity;
+    return p_pool;
+}
+
+/* Blocks still out are freed when they are released */
+static void RxPoolClose( rx_pool_t *p_pool )
+{
+    vlc_mutex_lock( &p_pool->lock );
+    block_t *p_list = p_pool->p_free;
+    p_pool->p_free = NULL;
+    p_pool->i_free = 0;
+    p_pool->i_capacity = 0;
+    bool b_last = --p_pool->i_refs == 0;
+    vlc_mutex_unlock( &p_pool->lock );
+
+    RxPoolFree( p_list );
+    if( b_last )
+    {
+        vlc_mutex_destroy( &p_pool->lock );
+        free( p_pool );
+    }
+}
+
+/* New blocks get i_capacity bytes, smaller ones are dropped as they come back */
+static void RxPoolResize( rx_pool_t *p_pool, size_t i_capacity )
+{
+    vlc_mutex_lock( &p_pool->lock );
+    block_t *p_list = p_pool->p_free;
+    p_pool->p_free = NULL;
+    p_pool->i_free = 0;
+    p_pool->i_capacity = i_capacity;
+    vlc_mutex_unlock( &p_pool->lock );
+
+    RxPoolFree( p_list );
+}
+
+/* Empty block with RX_HEADROOM bytes before p_buffer and i_buffer set to
+ * the pool capacity */
+static block_t *RxPoolGet( rx_pool_t *p_pool )
+{
+    vlc_mutex_lock( &p_pool->lock );
+    block_t *p_block = p_pool->p_free;
+    if( p_block )
+    {
+        p_pool->p_free = p_block->p_next;
+        p_pool->i_free--;
+    }
+    size_t i_capacity = p_pool->i_capacity;
+    p_pool->i_refs++;
+    vlc_mutex_unlock( &p_pool->lock );
+
+    rx_block_t *p_rx;
+    if( p_block )
+        p_rx = container_of( p_block, rx_block_t, self );
+    else
+    {
+        p_rx = (rx_block_t *)malloc( sizeof( *p_rx ) + RX_HEADROOM
+                                     + i_capacity + RX_TAILROOM );
+        if( !p_rx )
+        {
+            /* The track still holds its reference */
+            vlc_mutex_lock( &p_pool->lock );
+            p_pool->i_refs--;
+            vlc_mutex_unlock( &p_pool->lock );
+            return NULL;
+        }
+        p_rx->p_pool = p_pool;
+        p_rx->i_capacity = i_capacity;
+    }
+
+    p_block = block_Init( &p_rx->self, &rx_block_cbs, p_rx + 1,
+                          RX_HEADROOM + p_rx->i_capacity + RX_TAILROOM );
+    p_block->p_buffer += RX_HEADROOM;
+    p_block->i_buffer = p_rx->i_capacity;
+    return p_block;
+}
+
+/* Block of the received frame, i_header bytes to fill before the payload.
+ * Frames filling at least half of the receive block are handed over in it;
+ * smaller ones are copied into a block of their size, so that they do not
+ * hold a whole receive block while waiting downstream, and the receive block
+ * is kept for the next frame. */
+static block_t *RxBlockTake( live_track_t *tk, unsigned i_size, unsigned i_header )
+{
+    assert( i_header <= RX_HEADROOM );
+    block_t *p_rx = tk->p_rx;
+    const size_t i_capacity = container_of( p_rx, rx_block_t, self )->i_capacity;
+
+    if( i_size < i_capacity / 2 )
+    {
+        block_t *p_block = block_Alloc( i_header + i_size );
+        if( likely(p_block) )
+        {
+            memcpy( p_block->p_buffer + i_header, p_rx->p_buffer, i_size );
+            return p_block;
+        }
+    }
+
+    tk->p_rx = NULL;
+    p_rx->p_buffer -= i_header;
+    p_rx->i_buffer = i_size + i_header;
+    return p_rx;
+}
+
+/*****************************************************************************
+ * Shared sessions
+ *****************************************************************************
+ * With rtsp-share, the first demuxer of the process opening an URL owns the
+ * session, and the next ones opening the same URL follow it: the owner
+ * queues a copy of its blocks and clock updates to each follower, so the
+ * server streams only once. When the owner goes away, its followers are
+ * orphaned and set the session up again, the first one owning it and the
+ * others following that one.
+ *****************************************************************************/
+#define SUB_RESTART 0xfc /* kinds of the non data blocks of follower queues */
+#define SUB_JITTER  0xfd
+#define SUB_RESET   0xfe
+#define SUB_PCR     0xff
+#define SUB_KIND( b ) \
+    ( ( (b)->i_flags & BLOCK_FLAG_PRIVATE_MASK ) >> BLOCK_FLAG_PRIVATE_SHIFT )
+#define SUB_QUEUE_MAX (8 << 20) /* bytes queued for a stalled follower */
+
+static vlc_mutex_t hub_lock = VLC_STATIC_MUTEX;
+static int i_hubs = 0;
+static live_hub_t **hubs = NULL;
+
+static void HubCleanFormats( live_hub_t *p_hub )
+{
+    for( int i = 0; i < p_hub->i_fmt; i++ )
+        es_format_Clean( &p_hub->fmt[i] );
+    free( p_hub->fmt );
+    p_hub->fmt = NULL;
+    p_hub->i_fmt = 0;
+}
+
+/* Follows the session of the same URL if there is one, registers this
+ * demuxer as its owner otherwise. Returns true when following. */
+static bool HubJoin( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = (demux_sys_t *)p_demux->p_sys;
+    live_hub_t *p_hub = NULL;
+
+    vlc_mutex_lock( &hub_lock );
+    for( int i = 0; i < i_hubs; i++ )
+        if( !strcmp( hubs[i]->psz_url, p_demux->psz_url ) )
+            p_hub = hubs[i];
+
+    if( p_hub )
+    {
+        live_sub_t *p_sub = (live_sub_t *)calloc( 1, sizeof(*p_sub) );
+        if( p_sub )
+        {
+            p_sub->p_hub = p_hub;
+            vlc_cond_init( &p_sub->wait );
+            p_sub->pp_last = &p_sub->p_first;
+            TAB_APPEND_CAST( (live_sub_t **), p_hub->i_sub, p_hub->sub, p_sub );
+            p_sys->p_sub = p_sub;
+        }
+    }
+    else
+    {
+        p_hub = (live_hub_t *)calloc( 1, sizeof(*p_hub) );
+        if( p_hub && ( p_hub->psz_url = strdup( p_demux->psz_url ) ) )
+        {
+            TAB_APPEND_CAST( (live_hub_t **), i_hubs, hubs, p_hub );
+            p_sys->p_hub = p_hub;
+        }
+        else
+            free( p_hub );
+    }
+    vlc_mutex_unlock( &hub_lock );
+
+    if( p_sys->p_sub )
+        msg_Dbg( p_demux, "following the session of %s", p_sys->psz_pl_url );
+    return p_sys->p_sub != NULL;
+}
+
+/* Owner: stops sharing the session, the followers are orphaned */
+static void HubClose( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = (demux_sys_t *)p_demux->p_sys;
+    live_hub_t *p_hub = p_sys->p_hub;
+
+    vlc_mutex_lock( &hub_lock );
+    TAB_REMOVE( i_hubs, hubs, p_hub );
+    for( int i = 0; i < p_hub->i_sub; i++ )
+    {
+        p_hub->sub[i]->p_hub = NULL;
+        vlc_cond_signal( &p_hub->sub[i]->wait );
+    }
+    vlc_mutex_unlock( &hub_lock );
+
+    TAB_CLEAN( p_hub->i_sub, p_hub->sub );
+    HubCleanFormats( p_hub );
+    free( p_hub->psz_url );
+    free( p_hub );
+    p_sys->p_hub = NULL;
+}
+
+/* Owner: gives the followers the formats of the tracks, or stops sharing
+ * a session they could not follow */
+static void HubPublish( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = (demux_sys_t *)p_demux->p_sys;
+    live_hub_t *p_hub = p_sys->p_hub;
+
+    bool b_shareable = p_sys->f_npt_length <= 0; /* pause and seek */
+    for( int i = 0; i < p_sys->i_track; i++ )
+        if( p_sys->track[i]->format != live_track_t::SINGLE_STREAM &&
+            p_sys->track[i]->format != live_track_t::QUICKTIME_STREAM )
+            b_shareable = false;
+    if( !b_shareable )
+    {
+        msg_Dbg( p_demux, "not sharing a non live or muxed session" );
+        HubClose( p_demux );
+        return;
+    }
+
+    es_format_t *fmt = (es_format_t *)vlc_alloc( p_sys->i_track, sizeof(*fmt) );
+    if( !fmt )
+        return;
+    for( int i = 0; i < p_sys->i_track; i++ )
+    {
+        live_track_t *tk = p_sys->track[i];
+        if( tk->p_es )
+            es_format_Copy( &fmt[i], &tk->fmt );
+        else
+            es_format_Init( &fmt[i], UNKNOWN_ES, 0 );
+    }
+
+    vlc_mutex_lock( &hub_lock );
+    HubCleanFormats( p_hub );
+    p_hub->fmt = fmt;
+    p_hub->i_fmt = p_sys->i_track;
+    vlc_mutex_unlock( &hub_lock );
+}
+
+static void SubPush( live_sub_t *p_sub, block_t *p_block, unsigned i_kind )
+{
+    if( p_sub->i_queued > SUB_QUEUE_MAX )
+    {
+        /* Too late, resynchronize the follower */
+        block_ChainRelease( p_sub->p_first );
+        p_sub->p_first = NULL;
+        p_sub->pp_last = &p_sub->p_first;
+        p_sub->i_queued = 0;
+
+        p_block->i_buffer = 0;
+        p_block->i_dts = VLC_TICK_INVALID;
+        i_kind = SUB_RESET;
+    }
+
+    p_block->i_flags = ( p_block->i_flags & ~BLOCK_FLAG_PRIVATE_MASK ) |
+                       ( i_kind << BLOCK_FLAG_PRIVATE_SHIFT );
+    *p_sub->pp_last = p_block;
+    p_sub->pp_last = &p_block->p_next;
+    p_sub->i_queued += p_block->i_buffer;
+    vlc_cond_signal( &p_sub->wait );
+}
+
+/* Owner: queues a copy of p_block (a track block), or a clock update of
+ * the given kind at i_date (p_block NULL), to every follower */
+static void HubSend( live_hub_t *p_hub, unsigned i_kind,
+                     block_t *p_block, vlc_tick_t i_date )
+{
+    /* The copies are made out of the lock, which only guards the queues:
+     * a follower joining meanwhile starts from the next block */
+    vlc_mutex_lock( &hub_lock );
+    const int i_sub = p_hub->i_sub;
+    vlc_mutex_unlock( &hub_lock );
+
+    block_t *p_copies = NULL;
+    for( int i = 0; i < i_sub; i++ )
+    {
+        block_t *p_copy = p_block ? block_Duplicate( p_block ) : block_Alloc( 0 );
+        if( !p_copy )
+            break;
+        if( !p_block )
+            p_copy->i_dts = i_date;
+        p_copy->p_next = p_copies;
+        p_copies = p_copy;
+    }
+
+    vlc_mutex_lock( &hub_lock );
+    for( int i = 0; i < p_hub->i_sub && p_copies; i++ )
+    {
+        block_t *p_copy = p_copies;
+        p_copies = p_copy->p_next;
+        p_copy->p_next = NULL;
+        SubPush( p_hub->sub[i], p_copy, i_kind );
+    }
+    vlc_mutex_unlock( &hub_lock );
+
+    block_ChainRelease( p_copies );
+}
+
+/* Follower: leaves the session */
+static void SubClose( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = (demux_sys_t *)p_demux->p_sys;
+    live_sub_t *p_sub = p_sys->p_sub;
+
+    vlc_mutex_lock( &hub_lock );
+    if( p_sub->p_hub )
+        TAB_REMOVE( p_sub->p_hub->i_sub, p_sub->p_hub->sub, p_sub );
+    vlc_mutex_unlock( &hub_lock );
+
+    block_ChainRelease( p_sub->p_first );
+    vlc_cond_destroy( &p_sub->wait );
+    free( p_sub->es );
+    free( p_sub );
+    p_sys->p_sub = NULL;
+}
+
+static void SubSend( demux_t *p_demux, unsigned i_track, block_t *p_block )
+{
+    demux_sys_t *p_sys = (demux_sys_t *)p_demux->p_sys;
+    live_sub_t *p_sub = p_sys->p_sub;
+
+    if( i_track >= (unsigned)p_sub->i_es )
+    {
+        live_sub_es_t *es = (live_sub_es_t *)realloc( p_sub->es,
+                                                      (i_track + 1) * sizeof(*es) );
+        if( !es )
+        {
+            block_Release( p_block );
+            return;
+        }
+        memset( &es[p_sub->i_es], 0, (i_track + 1 - p_sub->i_es) * sizeof(*es) );
+        p_sub->es = es;
+        p_sub->i_es = i_track + 1;
+    }
+
+    live_sub_es_t *es = &p_sub->es[i_track];
+    if( es->p_es == NULL )
+    {
+        es_format_t fmt;
+        bool b_fmt = false;
+
+        vlc_mutex_lock( &hub_lock );
+        live_hub_t *p_hub = p_sub->p_hub;
+        if( p_hub && i_track < (unsigned)p_hub->i_fmt &&
+            p_hub->fmt[i_track].i_cat != UNKNOWN_ES )
+            b_fmt = es_format_Copy( &fmt, &p_hub->fmt[i_track] ) == VLC_SUCCESS;
+        vlc_mutex_unlock( &hub_lock );
+
+        if( b_fmt )
+        {
+            es->p_es = es_out_Add( p_demux->out, &fmt );
+            es_format_Clean( &fmt );
+        }
+        if( es->p_es == NULL )
+        {
+            block_Release( p_block );
+            return;
+        }
+    }
+
+    p_block->i_flags |= es->i_next_block_flags;
+    es->i_next_block_flags = 0;
+    es_out_Send( p_demux->out, es->p_es, p_block );
+}
+
+static int DemuxFollower( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = (demux_sys_t *)p_demux->p_sys;
+    live_sub_t *p_sub = p_sys->p_sub;
+    const vlc_tick_t i_deadline = vlc_tick_now() + VLC_TICK_FROM_MS(300);
+
+    vlc_mutex_lock( &hub_lock );
+    while( p_sub->p_first == NULL && p_sub->p_hub != NULL )
+        if( vlc_cond_timedwait( &p_sub->wait, &hub_lock, i_deadline ) )
+            break;
+    block_t *p_list = p_sub->p_first;
+    p_sub->p_first = NULL;
+    p_sub->pp_last = &p_sub->p_first;
+    p_sub->i_queued = 0;
+    const bool b_orphan = p_sub->p_hub == NULL;
+    vlc_mutex_unlock( &hub_lock );
+
+    while( p_list )
+    {
+        block_t *p_block = p_list;
+        p_list = p_list->p_next;
+        p_block->p_next = NULL;
+
+        const unsigned i_kind = SUB_KIND( p_block );
+        p_block->i_flags &= ~BLOCK_FLAG_PRIVATE_MASK;
+
+        switch( i_kind )
+        {
+            case SUB_PCR:
+                es_out_SetPCR( p_demux->out, p_block->i_dts );
+                block_Release( p_block );
+                break;
+            case SUB_RESTART:
+                /* The owner tracks were set up again, the ES are created
+                 * again from the new formats by SubSend() */
+                for( int i = 0; i < p_sub->i_es; i++ )
+                    if( p_sub->es[i].p_es )
+                    {
+                        es_out_Del( p_demux->out, p_sub->es[i].p_es );
+                        p_sub->es[i].p_es = NULL;
+                    }
+                /* fall through */
+            case SUB_RESET:
+                es_out_Control( p_demux->out, ES_OUT_RESET_PCR );
+                for( int i = 0; i < p_sub->i_es; i++ )
+                    p_sub->es[i].i_next_block_flags |= BLOCK_FLAG_DISCONTINUITY;
+                block_Release( p_block );
+                break;
+            case SUB_JITTER:
+                if( p_sys->b_live )
+                    es_out_SetLiveJitter( p_demux->out, p_block->i_dts );
+                block_Release( p_block );
+                break;
+            default:
+                SubSend( p_demux, i_kind, p_block );
+                break;
+        }
+    }
+
+    if( !b_orphan )
+        return 1;
+
+    msg_Dbg( p_demux, "session owner gone, setting the session up again" );
+    for( int i = 0; i < p_sub->i_es; i++ )
+        if( p_sub->es[i].p_es )
+            es_out_Del( p_demux->out, p_sub->es[i].p_es );
+    SubClose( p_demux );
+
+    if( OpenSession( p_demux ) != VLC_SUCCESS )
+    {
+        msg_Err( p_demux, "Failed to set up the session of %s", p_sys->psz_pl_url );
+        return 0;
+    }
+    return 1;
+}
 
 /*****************************************************************************
  * DemuxOpen:
@@ -305,7 +899,6 @@ static int  Open ( vlc_object_t *p_this )
     demux_t     *p_demux = (demux_t*)p_this;
     demux_sys_t *p_sys = NULL;
 
-    int i_return;
     int i_error = VLC_EGENERIC;
 
     if (p_demux->out == NULL)
@@ -367,6 +960,15 @@ static int  Open ( vlc_object_t *p_this )
     p_sys->b_force_mcast = var_InheritBool( p_demux, "rtsp-mcast" );
     p_sys->f_seek_request = -1;
 
+    p_sys->b_live = var_InheritBool( p_demux, "rtsp-live" );
+    p_sys->i_pcr_obs = p_sys->b_live ? LIVE_PCR_OBS : PCR_OBS;
+    p_sys->i_live_delay =
+        VLC_TICK_FROM_MS(var_InheritInteger( p_demux, "rtsp-live-delay" ));
+    p_sys->i_live_max = __MAX( p_sys->i_live_delay,
+        VLC_TICK_FROM_MS(var_InheritInteger( p_demux, "network-caching" )) );
+    p_sys->i_live_target = VLC_TICK_INVALID;
+    p_sys->i_live_update = VLC_TICK_INVALID;
+
     /* parse URL for rtsp://[user:[passwd]@]serverip:port/options */
     vlc_UrlParse( &p_sys->url, p_demux->psz_url );
 
@@ -376,15 +978,36 @@ static int  Open ( vlc_object_t *p_this )
         goto error;
     }
 
+    if( ( i_error = OpenSession( p_demux ) ) != VLC_SUCCESS )
+        goto error;
+
+    return VLC_SUCCESS;
+
+error:
+    Close( p_this );
+    return i_error;
+}
+
+/*****************************************************************************
+ * OpenSession: sets the session up, or follows the one of the same URL
+ *****************************************************************************/
+static int OpenSession( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = (demux_sys_t *)p_demux->p_sys;
+
+    if( p_demux->s == NULL && var_InheritBool( p_demux, "rtsp-share" ) &&
+        HubJoin( p_demux ) )
+        return VLC_SUCCESS;
+
     if( ( p_sys->scheduler = BasicTaskScheduler::createNew() ) == NULL )
     {
         msg_Err( p_demux, "BasicTaskScheduler::createNew failed" );
-        goto error;
+        return VLC_EGENERIC;
     }
     if( !( p_sys->env = BasicUsageEnvironment::createNew(*p_sys->scheduler) ) )
     {
         msg_Err( p_demux, "BasicUsageEnvironment::createNew failed" );
-        goto error;
+        return VLC_EGENERIC;
     }
 
     if( p_demux->s != NULL )
@@ -401,10 +1024,7 @@ static int  Open ( vlc_object_t *p_this )
         uint8_t *p_sdp      = (uint8_t*) malloc( i_sdp_max );
 
         if( !p_sdp )
-        {
-            i_error = VLC_ENOMEM;
-            goto error;
-        }
+            return VLC_ENOMEM;
 
         for( ;; )
         {
@@ -414,7 +1034,7 @@ static int  Open ( vlc_object_t *p_this )
             {
                 msg_Err( p_demux, "failed to read SDP" );
                 free( p_sdp );
-                goto error;
+                return VLC_EGENERIC;
             }
 
             i_sdp += i_read;
@@ -430,45 +1050,43 @@ static int  Open ( vlc_object_t *p_this )
         }
         p_sys->p_sdp = (char*)p_sdp;
     }
-    else if( ( i_return = Connect( p_demux ) ) != VLC_SUCCESS )
+    else if( Connect( p_demux ) != VLC_SUCCESS )
     {
         msg_Err( p_demux, "Failed to connect with %s", p_sys->psz_pl_url );
-        goto error;
+        return VLC_EGENERIC;
     }
 
     if( p_sys->p_sdp == NULL )
     {
         msg_Err( p_demux, "Failed to retrieve the RTSP Session Description" );
-        i_error = VLC_ENOMEM;
-        goto error;
+        return VLC_ENOMEM;
     }
 
-    if( ( i_return = SessionsSetup( p_demux ) ) != VLC_SUCCESS )
+    if( SessionsSetup( p_demux ) != VLC_SUCCESS )
     {
         msg_Err( p_demux, "Nothing to play for %s", p_sys->psz_pl_url );
-        goto error;
+        return VLC_EGENERIC;
     }
 
-    if( p_sys->b_real ) goto error;
+    if( p_sys->b_real ) return VLC_EGENERIC;
 
-    if( ( i_return = Play( p_demux ) ) != VLC_SUCCESS )
-        goto error;
+    if( Play( p_demux ) != VLC_SUCCESS )
+        return VLC_EGENERIC;
 
     if( p_sys->p_out_asf && ParseASF( p_demux ) )
     {
         msg_Err( p_demux, "cannot find a usable asf header" );
         /* TODO Clean tracks */
-        goto error;
+        return VLC_EGENERIC;
     }
 
     if( p_sys->i_track <= 0 )
-        goto error;
+        return VLC_EGENERIC;
 
-    return VLC_SUCCESS;
+    if( p_sys->p_hub )
+        HubPublish( p_demux );
 
-error:
-    Close( p_this );
-    return i_error;
+    return VLC_SUCCESS;
 }
 
 /*****************************************************************************
@@ -481,6 +1099,11 @@ static void Close( vlc_object_t *p_this )
 
     vlc_timer_destroy(p_sys->timer);
 
+    if( p_sys->p_hub )
+        HubClose( p_demux );
+    if( p_sys->p_sub )
+        SubClose( p_demux );
+
     if( p_sys->rtsp && p_sys->ms ) p_sys->rtsp->sendTeardownCommand( *p_sys->ms, NULL );
     if( p_sys->ms ) Medium::close( p_sys->ms );
     if( p_sys->rtsp ) RTSPClient::close( p_sys->rtsp );
@@ -494,7 +1117,8 @@ static void Close( vlc_object_t *p_this )
             vlc_demux_chained_Delete( tk->p_out_muxed );
         es_format_Clean( &tk->fmt );
         dtsgen_Clean( &tk->dtsgen );
-        free( tk->p_buffer );
+        if( tk->p_rx ) block_Release( tk->p_rx );
+        RxPoolClose( tk->p_pool );
         free( tk );
     }
     TAB_CLEAN( p_sys->i_track, p_sys->track );
@@ -877,12 +1501,16 @@ static int SessionsSetup( demux_t *p_demux )
             tk->i_prevpts   = VLC_TICK_INVALID;
             tk->i_pcr       = VLC_TICK_INVALID;
             tk->f_npt       = 0.;
+            tk->i_transit   = VLC_TICK_INVALID;
+            tk->i_jitter    = 0;
+            tk->i_hevc_tids = 0;
             dtsgen_Init( &tk->dtsgen );
             tk->state       = live_track_t::STATE_SELECTED;
             tk->i_buffer    = i_frame_buffer;
-            tk->p_buffer    = (uint8_t *)malloc( i_frame_buffer );
+            tk->p_rx        = NULL;
+            tk->p_pool      = RxPoolNew( i_frame_buffer );
 
-            if( !tk->p_buffer )
+            if( !tk->p_pool )
             {
                 free( tk );
                 delete iter;
@@ -1366,6 +1994,9 @@ static int Demux( demux_t *p_demux )
     bool            b_send_pcr = true;
     int             i;
 
+    if( p_sys->p_sub )
+        return DemuxFollower( p_demux );
+
     /* Protect Live555 from simultaneous calls in TimeoutPrevention()
        during pause */
     vlc::threads::mutex_locker locker( p_sys->timeout_mutex );
@@ -1415,8 +2046,16 @@ static int Demux( demux_t *p_demux )
 
         if( tk->waiting == 0 )
         {
+            /* An outgrown receive block is replaced by one of the new size */
+            if( tk->p_rx && tk->p_rx->i_buffer < tk->i_buffer )
+            {
+                block_Release( tk->p_rx );
+                tk->p_rx = NULL;
+            }
+            if( !tk->p_rx && !(tk->p_rx = RxPoolGet( tk->p_pool )) )
+                continue;
             tk->waiting = 1;
-            tk->sub->readSource()->getNextFrame( tk->p_buffer, tk->i_buffer,
+            tk->sub->readSource()->getNextFrame( tk->p_rx->p_buffer, tk->p_rx->i_buffer,
                                           StreamRead, tk, StreamClose, tk );
         }
     }
@@ -1429,6 +2068,9 @@ static int Demux( demux_t *p_demux )
     /* remove the task */
     p_sys->scheduler->unscheduleDelayedTask( task );
 
+    if( p_sys->b_live )
+        UpdateLiveJitter( p_demux );
+
     if( b_send_pcr )
     {
         vlc_tick_t i_minpcr = VLC_TICK_INVALID;
@@ -1453,6 +2095,8 @@ static int Demux( demux_t *p_demux )
         if( p_sys->i_pcr != VLC_TICK_INVALID && b_need_flush )
         {
             es_out_Control( p_demux->out, ES_OUT_RESET_PCR );
+            if( p_sys->p_hub )
+                HubSend( p_sys->p_hub, SUB_RESET, NULL, VLC_TICK_INVALID );
             p_sys->i_pcr = i_minpcr;
             p_sys->f_npt = 0.;
 
@@ -1462,20 +2106,21 @@ static int Demux( demux_t *p_demux )
                 tk->i_prevpts = VLC_TICK_INVALID;
                 tk->i_pcr = VLC_TICK_INVALID;
                 tk->f_npt = 0.;
+                tk->i_transit = VLC_TICK_INVALID;
                 tk->b_flushing_discontinuity = false;
                 tk->i_next_block_flags |= BLOCK_FLAG_DISCONTINUITY;
             }
             if( p_sys->i_pcr != VLC_TICK_INVALID )
-                es_out_SetPCR( p_demux->out, VLC_TICK_0 +
-                               __MAX(0, p_sys->i_pcr - PCR_OFF) );
+                SetPCR( p_demux, VLC_TICK_0 +
+                        __MAX(0, p_sys->i_pcr - p_sys->i_pcr_obs) );
         }
         else if( p_sys->i_pcr == VLC_TICK_INVALID ||
-                 i_minpcr > p_sys->i_pcr + PCR_OBS )
+                 i_minpcr > p_sys->i_pcr + p_sys->i_pcr_obs )
         {
-            p_sys->i_pcr = __MAX(0, i_minpcr - PCR_OFF);
+            p_sys->i_pcr = __MAX(0, i_minpcr - p_sys->i_pcr_obs);
             if( p_sys->i_pcr != VLC_TICK_INVALID ) {
                 //msg_Err(p_demux, "PCR: %"PRId64"", VLC_TICK_0 + p_sys->i_pcr);
-                es_out_SetPCR( p_demux->out, VLC_TICK_0 + p_sys->i_pcr );
+                SetPCR( p_demux, VLC_TICK_0 + p_sys->i_pcr );
             }
         }
     }
@@ -1517,6 +2162,69 @@ static int Demux( demux_t *p_demux )
     return p_sys->b_error ? 0 : 1;
 }
 
+static void SetPCR( demux_t *p_demux, vlc_tick_t i_pcr )
+{
+    demux_sys_t *p_sys = (demux_sys_t *)p_demux->p_sys;
+
+    es_out_SetPCR( p_demux->out, i_pcr );
+    if( p_sys->p_hub )
+        HubSend( p_sys->p_hub, SUB_PCR, NULL, i_pcr );
+}
+
+/*****************************************************************************
+ * TrackUpdateJitter: interarrival jitter of a track, from the arrival time of
+ * an access unit and its timestamp in decode order. Jumps (RTCP
+ * synchronization, gaps) are not jitter
+ *****************************************************************************/
+static void TrackUpdateJitter( live_track_t *tk, vlc_tick_t i_arrival,
+                               vlc_tick_t i_ts )
+{
+    const vlc_tick_t i_transit = i_arrival - i_ts;
+    if( tk->i_transit != VLC_TICK_INVALID )
+    {
+        const vlc_tick_t i_d = llabs( i_transit - tk->i_transit );
+        if( i_d < VLC_TICK_FROM_SEC(1) )
+            tk->i_jitter += ( i_d - tk->i_jitter ) / 16;
+    }
+    tk->i_transit = i_transit;
+}
+
+/*****************************************************************************
+ * UpdateLiveJitter: sizes the es_out jitter buffer from the tracks jitter
+ *****************************************************************************/
+static void UpdateLiveJitter( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = (demux_sys_t *)p_demux->p_sys;
+    const vlc_tick_t i_now = vlc_tick_now();
+
+    if( i_now < p_sys->i_live_update )
+        return;
+    p_sys->i_live_update = i_now + LIVE_JITTER_PERIOD;
+
+    vlc_tick_t i_jitter = 0;
+    for( int i = 0; i < p_sys->i_track; i++ )
+    {
+        live_track_t *tk = p_sys->track[i];
+        if( tk->state == live_track_t::STATE_SELECTED )
+            i_jitter = __MAX( i_jitter, tk->i_jitter );
+    }
+
+    vlc_tick_t i_target = __MIN( p_sys->i_live_delay + LIVE_JITTER_FACTOR * i_jitter,
+                                 p_sys->i_live_max );
+
+    /* Do not bother the clock with small variations */
+    if( p_sys->i_live_target != VLC_TICK_INVALID &&
+        llabs( i_target - p_sys->i_live_target ) < VLC_TICK_FROM_MS(5) )
+        return;
+
+    msg_Dbg( p_demux, "jitter %" PRId64 " ms, live buffer %" PRId64 " ms",
+             MS_FROM_VLC_TICK(i_jitter), MS_FROM_VLC_TICK(i_target) );
+    es_out_SetLiveJitter( p_demux->out, i_target );
+    if( p_sys->p_hub )
+        HubSend( p_sys->p_hub, SUB_JITTER, NULL, i_target );
+    p_sys->i_live_target = i_target;
+}
+
 /*****************************************************************************
  * Control:
  *****************************************************************************/
@@ -1769,8 +2477,11 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
             return VLC_EGENERIC;
 
         case DEMUX_GET_PTS_DELAY:
-            *va_arg( args, vlc_tick_t * ) =
-                VLC_TICK_FROM_MS(var_InheritInteger( p_demux, "network-caching" ));
+            if( p_sys->b_live )
+                *va_arg( args, vlc_tick_t * ) = p_sys->i_live_delay;
+            else
+                *va_arg( args, vlc_tick_t * ) =
+                    VLC_TICK_FROM_MS(var_InheritInteger( p_demux, "network-caching" ));
             return VLC_SUCCESS;
 
         default:
@@ -1804,7 +2515,8 @@ static int RollOverTcp( demux_t *p_demux )
         if( tk->p_es ) es_out_Del( p_demux->out, tk->p_es );
         if( tk->p_asf_block ) block_Release( tk->p_asf_block );
         es_format_Clean( &tk->fmt );
-        free( tk->p_buffer );
+        if( tk->p_rx ) block_Release( tk->p_rx );
+        RxPoolClose( tk->p_pool );
         free( tk );
     }
     TAB_CLEAN( p_sys->i_track, p_sys->track );
@@ -1838,6 +2550,12 @@ static int RollOverTcp( demux_t *p_demux )
     if( ( i_return = Play( p_demux ) ) != VLC_SUCCESS )
         goto error;
 
+    if( p_sys->p_hub )
+        HubPublish( p_demux );
+    /* Not shared anymore if the new session cannot be */
+    if( p_sys->p_hub )
+        HubSend( p_sys->p_hub, SUB_RESTART, NULL, VLC_TICK_INVALID );
+
     return VLC_SUCCESS;
 
 error:
@@ -1954,6 +2672,8 @@ static void StreamRead( void *p_private, unsigned int i_size,
     /* Retrieve NPT for this pts */
     tk->f_npt = tk->sub->getNormalPlayTime(pts);
 
+    const vlc_tick_t i_arrival = vlc_tick_now();
+
     if( tk->format == live_track_t::QUICKTIME_STREAM && tk->p_es == NULL )
     {
         QuickTimeGenericRTPSource *qtRTPSource =
@@ -2014,6 +2734,8 @@ static void StreamRead( void *p_private, unsigned int i_size,
             tk->fmt.audio.i_bitspersample = (sdAtom[22] << 8) | sdAtom[23];
         }
         tk->p_es = es_out_Add( p_demux->out, &tk->fmt );
+        if( p_sys->p_hub )
+            HubPublish( p_demux );
     }
 
 #if 0
@@ -2027,19 +2749,11 @@ static void StreamRead( void *p_private, unsigned int i_size,
     {
         if( tk->i_buffer < 2000000 )
         {
-            void *p_tmp;
             msg_Dbg( p_demux, "lost %d bytes", i_truncated_bytes );
             msg_Dbg( p_demux, "increasing buffer size to %d", tk->i_buffer * 2 );
-            p_tmp = realloc( tk->p_buffer, tk->i_buffer * 2 );
-            if( p_tmp == NULL )
-            {
-                msg_Warn( p_demux, "realloc failed" );
-            }
-            else
-            {
-                tk->p_buffer = (uint8_t*)p_tmp;
-                tk->i_buffer *= 2;
-            }
+            /* Takes effect from the next receive block */
+            tk->i_buffer *= 2;
+            RxPoolResize( tk->p_pool, tk->i_buffer );
         }
 
         if( tk->b_discard_trunc )
@@ -2050,58 +2764,66 @@ static void StreamRead( void *p_private, unsigned int i_size,
         }
     }
 
-    assert( i_size <= tk->i_buffer );
+    assert( i_size <= tk->p_rx->i_buffer );
+    const uint8_t *p_data = tk->p_rx->p_buffer;
 
+    /* The payload is already in place, headers go in the headroom */
     if( tk->fmt.i_codec == VLC_CODEC_AMR_NB ||
         tk->fmt.i_codec == VLC_CODEC_AMR_WB )
     {
         AMRAudioSource *amrSource = (AMRAudioSource*)tk->sub->readSource();
 
-        if( (p_block = block_Alloc( i_size + 1 )) )
-        {
-            p_block->p_buffer[0] = amrSource->lastFrameHeader();
-            memcpy( p_block->p_buffer + 1, tk->p_buffer, i_size );
-        }
+        p_block = RxBlockTake( tk, i_size, 1 );
+        p_block->p_buffer[0] = amrSource->lastFrameHeader();
     }
     else if( tk->fmt.i_codec == VLC_CODEC_H261 )
     {
         H261VideoRTPSource *h261Source = (H261VideoRTPSource*)tk->sub->rtpSource();
         uint32_t header = h261Source->lastSpecialHeader();
-        if( (p_block = block_Alloc( i_size + 4 )) )
-        {
-            memcpy( p_block->p_buffer, &header, 4 );
-            memcpy( p_block->p_buffer + 4, tk->p_buffer, i_size );
-        }
+        p_block = RxBlockTake( tk, i_size, 4 );
+        memcpy( p_block->p_buffer, &header, 4 );
     }
     else if( tk->fmt.i_codec == VLC_CODEC_H264 || tk->fmt.i_codec == VLC_CODEC_HEVC )
     {
-        if( tk->fmt.i_codec == VLC_CODEC_H264 && (tk->p_buffer[0] & 0x1f) >= 24 )
+        if( tk->fmt.i_codec == VLC_CODEC_H264 && (p_data[0] & 0x1f) >= 24 )
             msg_Warn( p_demux, "unsupported NAL type for H264" );
-        else if( tk->fmt.i_codec == VLC_CODEC_HEVC && ((tk->p_buffer[0] & 0x7e)>>1) >= 48 )
+        else if( tk->fmt.i_codec == VLC_CODEC_HEVC && ((p_data[0] & 0x7e)>>1) >= 48 )
             msg_Warn( p_demux, "unsupported NAL type for H265" );
 
         /* Normal NAL type */
-        if( (p_block = block_Alloc( i_size + 4 )) )
-        {
-            p_block->p_buffer[0] = 0x00;
-            p_block->p_buffer[1] = 0x00;
-            p_block->p_buffer[2] = 0x00;
-            p_block->p_buffer[3] = 0x01;
-            memcpy( &p_block->p_buffer[4], tk->p_buffer, i_size );
-            if( tk->sub->rtpSource()->curPacketMarkerBit() )
-                p_block->i_flags |= BLOCK_FLAG_AU_END;
-        }
+        p_block = RxBlockTake( tk, i_size, 4 );
+        p_block->p_buffer[0] = 0x00;
+        p_block->p_buffer[1] = 0x00;
+        p_block->p_buffer[2] = 0x00;
+        p_block->p_buffer[3] = 0x01;
+        if( tk->sub->rtpSource()->curPacketMarkerBit() )
+            p_block->i_flags |= BLOCK_FLAG_AU_END;
+
+        /* sps_max_sub_layers_minus1 */
+        if( tk->fmt.i_codec == VLC_CODEC_HEVC && i_size > 2 &&
+            ( ( p_data[0] & 0x7e ) >> 1 ) == 33 )
+            tk->i_hevc_tids = ( ( p_data[2] >> 1 ) & 0x07 ) + 1;
+
+        /* Slices of non-reference pictures: nal_ref_idc 0 for H264,
+         * sub-layer non-reference VCL types for HEVC, but only in the
+         * highest sub-layer as higher ones may refer to the others */
+        if( p_sys->b_live && i_size > 1 &&
+            ( tk->fmt.i_codec == VLC_CODEC_H264 ?
+              ( p_data[0] & 0x1f ) == 1 && ( p_data[0] & 0x60 ) == 0 :
+              ( ( p_data[0] & 0x7e ) >> 1 ) <= 14 && ( p_data[0] & 0x02 ) == 0 &&
+              ( p_data[1] & 0x07 ) == tk->i_hevc_tids ) )
+            p_block->i_flags |= BLOCK_FLAG_DROPPABLE;
     }
     else if( tk->format == live_track_t::ASF_STREAM )
     {
+        /* Reassembled into its own block, the receive block is reused */
         p_block = StreamParseAsf( p_demux, tk,
                                   tk->sub->rtpSource()->curPacketMarkerBit(),
-                                  tk->p_buffer, i_size );
+                                  p_data, i_size );
     }
     else
     {
-        if( (p_block = block_Alloc( i_size )) )
-            memcpy( p_block->p_buffer, tk->p_buffer, i_size );
+        p_block = RxBlockTake( tk, i_size, 0 );
     }
 
     /* No data sent. Always in sync then */
@@ -2116,6 +2838,7 @@ static void StreamRead( void *p_private, unsigned int i_size,
             const vlc_tick_t i_max_diff = vlc_tick_from_sec(( tk->fmt.i_cat == SPU_ES ) ? 60 : 1);
             tk->b_flushing_discontinuity = (llabs(i_pts - tk->i_pcr) > i_max_diff);
             tk->i_pcr = i_pts;
+            tk->i_transit = VLC_TICK_INVALID;
             tk->dtsgen.count = 0;
         }
     }
@@ -2130,16 +2853,23 @@ static void StreamRead( void *p_private, unsigned int i_size,
         switch( tk->format )
         {
             case live_track_t::ASF_STREAM:
+                if( p_sys->b_live )
+                    TrackUpdateJitter( tk, i_arrival, i_pts );
                 vlc_demux_chained_Send( p_sys->p_out_asf, p_block );
                 break;
             case live_track_t::MULTIPLEXED_STREAM:
+                if( p_sys->b_live )
+                    TrackUpdateJitter( tk, i_arrival, i_pts );
                 vlc_demux_chained_Send( tk->p_out_muxed, p_block );
                 break;
             default:
+            {
+                bool b_new_au = false;
                 if( i_pts != tk->i_prevpts )
                 {
                     p_block->i_pts = VLC_TICK_0 + i_pts;
                     tk->i_prevpts = i_pts;
+                    b_new_au = true;
 
                     dtsgen_AddNextPTS( &tk->dtsgen, i_pts );
                 }
@@ -2153,6 +2883,8 @@ static void StreamRead( void *p_private, unsigned int i_size,
                         p_block->i_dts = dtsgen_GetDTS( &tk->dtsgen );
                         //msg_Err(p_demux, "DTS: %"PRId64"", p_block->i_dts);
                         dtsgen_Debug( VLC_OBJECT(p_demux), &tk->dtsgen, p_block->i_dts, p_block->i_pts );
+                        /* Crafted DTS until the reorder depth is known */
+                        b_new_au &= tk->dtsgen.count > DTSGEN_REORDER_MAX;
                         break;
                     case VLC_CODEC_VP8:
                     default:
@@ -2160,6 +2892,12 @@ static void StreamRead( void *p_private, unsigned int i_size,
                         break;
                 }
 
+                /* The PTS goes back and forth with B-frames, the jitter is
+                 * measured per access unit against the DTS */
+                if( p_sys->b_live && b_new_au &&
+                    p_block->i_dts != VLC_TICK_INVALID )
+                    TrackUpdateJitter( tk, i_arrival, p_block->i_dts );
+
                 if( i_truncated_bytes )
                     p_block->i_flags |= BLOCK_FLAG_CORRUPTED;
 
@@ -2169,6 +2907,14 @@ static void StreamRead( void *p_private, unsigned int i_size,
                     tk->i_next_block_flags = 0;
                 }
 
+                if( p_sys->p_hub )
+                {
+                    int i_track;
+                    TAB_FIND( p_sys->i_track, p_sys->track, tk, i_track );
+                    if( i_track >= 0 && i_track < SUB_RESTART )
+                        HubSend( p_sys->p_hub, i_track, p_block, VLC_TICK_INVALID );
+                }
+
                 vlc_tick_t i_pcr = p_block->i_dts > VLC_TICK_INVALID ? p_block->i_dts : p_block->i_pts;
                 es_out_Send( p_demux->out, tk->p_es, p_block );
                 if( i_pcr > VLC_TICK_INVALID )
@@ -2177,6 +2923,7 @@ static void StreamRead( void *p_private, unsigned int i_size,
                         tk->i_pcr = i_pcr;
                 }
                 break;
+            }
         }
     }
 
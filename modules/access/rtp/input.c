@@ -29,6 +29,7 @@
 #include <vlc_block.h>
 #include <vlc_network.h>
 
+#include <assert.h>
 #include <limits.h>
 #include <errno.h>
 #include <unistd.h>
@@ -45,44 +46,78 @@
 #endif
 
 #define DEFAULT_MRU (1500u - (20 + 8))
+#define RTP_BATCH 32 /* datagrams per recvmmsg() call */
 
 /**
- * Processes a packet received from the RTP socket.
+ * Processes packets received from the RTP socket, in reception order.
  */
-static void rtp_process (demux_t *demux, block_t *block)
+static void rtp_process (demux_t *demux, block_t **blocks, unsigned count)
 {
     demux_sys_t *sys = demux->p_sys;
+    unsigned n = 0;
 
-    if (block->i_buffer < 2)
-        goto drop;
-    const uint8_t ptype = rtp_ptype (block);
-    if (ptype >= 72 && ptype <= 76)
-        goto drop; /* Muxed RTCP, ignore for now FIXME */
+    assert (count <= RTP_BATCH);
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        block_t *block = blocks[i];
+
+        if (block->i_buffer < 2)
+            goto drop;
+        const uint8_t ptype = rtp_ptype (block);
+        if (ptype >= 72 && ptype <= 76)
+            goto drop; /* Muxed RTCP, ignore for now FIXME */
+
+        blocks[n++] = block;
+        continue;
+    drop:
+        block_Release (block);
+    }
+    count = n;
 
 #ifdef HAVE_SRTP
+    int errv[RTP_BATCH];
+
     if (sys->srtp != NULL)
+    {   /* Authenticates and decrypts the whole batch at once */
+        uint8_t *bufv[RTP_BATCH];
+        size_t lenv[RTP_BATCH];
+
+        for (unsigned i = 0; i < count; i++)
+        {
+            bufv[i] = blocks[i]->p_buffer;
+            lenv[i] = blocks[i]->i_buffer;
+        }
+
+        srtp_recv_batch (sys->srtp, bufv, lenv, errv, count);
+
+        for (unsigned i = 0; i < count; i++)
+            blocks[i]->i_buffer = lenv[i];
+    }
+#endif
+
+    for (unsigned i = 0; i < count; i++)
     {
-        size_t len = block->i_buffer;
-        if (srtp_recv (sys->srtp, block->p_buffer, &len))
+        block_t *block = blocks[i];
+
+#ifdef HAVE_SRTP
+        if (sys->srtp != NULL && errv[i] != 0)
         {
             msg_Dbg (demux, "SRTP authentication/decryption failed");
-            goto drop;
+            block_Release (block);
+            continue;
         }
-        block->i_buffer = len;
-    }
 #endif
 
-    /* TODO: use SDP and get rid of this hack */
-    if (unlikely(sys->autodetect))
-    {   /* Autodetect payload type, _before_ rtp_queue() */
-        rtp_autodetect (demux, sys->session, block);
-        sys->autodetect = false;
-    }
+        /* TODO: use SDP and get rid of this hack */
+        if (unlikely(sys->autodetect))
+        {   /* Autodetect payload type, _before_ rtp_queue() */
+            rtp_autodetect (demux, sys->session, block);
+            sys->autodetect = false;
+        }
 
-    rtp_queue (demux, sys->session, block);
-    return;
-drop:
-    block_Release (block);
+        rtp_queue (demux, sys->session, block);
+    }
 }
 
 static int rtp_timeout (vlc_tick_t deadline)
@@ -100,6 +135,86 @@ static int rtp_timeout (vlc_tick_t deadline)
     return t;
 }
 
+#ifdef HAVE_RECVMMSG
+static void rtp_ring_release (void *data)
+{
+    block_t **ring = data;
+
+    for (unsigned i = 0; i < RTP_BATCH; i++)
+        if (ring[i] != NULL)
+            block_Release (ring[i]);
+}
+
+/**
+ * Receives all pending datagrams, up to RTP_BATCH, with a single system
+ * call. Received blocks are handed over and their ring slots emptied,
+ * the others are kept for the next call.
+ * @return false if no block could be allocated
+ */
+static bool rtp_recv_batch (demux_t *demux, int fd, block_t **ring,
+                            struct mmsghdr *msgs, struct iovec *iov,
+                            size_t *mru)
+{
+    unsigned count = 0;
+
+    while (count < RTP_BATCH)
+    {
+        if (ring[count] == NULL)
+        {
+            ring[count] = block_Alloc (*mru);
+            if (unlikely(ring[count] == NULL))
+                break;
+        }
+        iov[count].iov_base = ring[count]->p_buffer;
+        iov[count].iov_len = ring[count]->i_buffer;
+        count++;
+    }
+
+    if (unlikely(count == 0))
+    {
+        if (*mru == DEFAULT_MRU)
+            return false; /* we are totally screwed */
+        *mru = DEFAULT_MRU; /* retry with shrunk MRU */
+        return true;
+    }
+
+    int flags = MSG_DONTWAIT;
+#ifdef __linux__
+    flags |= MSG_TRUNC; /* get the real length of truncated datagrams */
+#endif
+    int val = recvmmsg (fd, msgs, count, flags, NULL);
+    if (val == -1)
+    {
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+            msg_Warn (demux, "RTP network error: %s", vlc_strerror_c(errno));
+        return true;
+    }
+
+    for (int i = 0; i < val; i++)
+    {
+        block_t *block = ring[i];
+        size_t len = msgs[i].msg_len;
+
+        if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC)
+        {
+            msg_Err (demux, "%zu bytes packet truncated (MRU was %zu)",
+                     len, block->i_buffer);
+            block->i_flags |= BLOCK_FLAG_CORRUPTED;
+            if (len > *mru)
+                *mru = len;
+        }
+        else
+            block->i_buffer = len;
+    }
+
+    rtp_process (demux, ring, val);
+    /* The handed over blocks will be reallocated */
+    for (int i = 0; i < val; i++)
+        ring[i] = NULL;
+    return true;
+}
+#endif
+
 /**
  * RTP/RTCP session thread for datagram sockets
  */
@@ -109,6 +224,20 @@ void *rtp_dgram_thread (void *opaque)
     demux_sys_t *sys = demux->p_sys;
     vlc_tick_t deadline = VLC_TICK_INVALID;
     int rtp_fd = sys->fd;
+#ifdef HAVE_RECVMMSG
+    /* Ring of receive blocks, only the ones handed over are reallocated */
+    block_t *ring[RTP_BATCH] = { NULL };
+    struct iovec iov[RTP_BATCH];
+    struct mmsghdr msgs[RTP_BATCH];
+    size_t mru = DEFAULT_MRU;
+
+    memset (msgs, 0, sizeof (msgs));
+    for (unsigned i = 0; i < RTP_BATCH; i++)
+    {
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+#else
     struct iovec iov =
     {
         .iov_len = DEFAULT_MRU,
@@ -118,11 +247,15 @@ void *rtp_dgram_thread (void *opaque)
         .msg_iov = &iov,
         .msg_iovlen = 1,
     };
+#endif
 
     struct pollfd ufd[1];
     ufd[0].fd = rtp_fd;
     ufd[0].events = POLLIN;
 
+#ifdef HAVE_RECVMMSG
+    vlc_cleanup_push (rtp_ring_release, ring);
+#endif
     for (;;)
     {
         int n = poll (ufd, 1, rtp_timeout (deadline));
@@ -139,6 +272,10 @@ void *rtp_dgram_thread (void *opaque)
             if (unlikely(ufd[0].revents & POLLHUP))
                 break; /* RTP socket dead (DCCP only) */
 
+#ifdef HAVE_RECVMMSG
+            if (!rtp_recv_batch (demux, rtp_fd, ring, msgs, iov, &mru))
+                break;
+#else
             block_t *block = block_Alloc (iov.iov_len);
             if (unlikely(block == NULL))
             {
@@ -170,7 +307,7 @@ void *rtp_dgram_thread (void *opaque)
 #endif
                     block->i_buffer = len;
 
-                rtp_process (demux, block);
+                rtp_process (demux, &block, 1);
             }
             else
             {
@@ -178,6 +315,7 @@ void *rtp_dgram_thread (void *opaque)
                           vlc_strerror_c(errno));
                 block_Release (block);
             }
+#endif
         }
 
     dequeue:
@@ -185,6 +323,10 @@ void *rtp_dgram_thread (void *opaque)
             deadline = VLC_TICK_INVALID;
         vlc_restorecancel (canc);
     }
+#ifdef HAVE_RECVMMSG
+    vlc_cleanup_pop ();
+    rtp_ring_release (ring);
+#endif
     return NULL;
 }
 
@@ -222,7 +364,7 @@ void *rtp_stream_thread (void *opaque)
         }
 
         int canc = vlc_savecancel ();
-        rtp_process (demux, block);
+        rtp_process (demux, &block, 1);
         rtp_dequeue_force (demux, sys->session);
         vlc_restorecancel (canc);
     }
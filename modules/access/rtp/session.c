@@ -150,6 +150,7 @@ struct rtp_source_t
 
     uint16_t last_seq; /* sequence of the next dequeued packet */
     block_t *blocks; /* re-ordered blocks queue */
+    block_t *last; /* tail of the re-ordered blocks queue */
     void    *opaque[]; /* Per-source private payload data */
 };
 
@@ -173,6 +174,7 @@ rtp_source_create (demux_t *demux, const rtp_session_t *session,
     source->max_seq = source->bad_seq = init_seq;
     source->last_seq = init_seq - 1;
     source->blocks = NULL;
+    source->last = NULL;
 
     /* Initializes all payload */
     for (unsigned i = 0; i < session->ptc; i++)
@@ -339,6 +341,7 @@ rtp_queue (demux_t *demux, rtp_session_t *session, block_t *block)
             msg_Warn (demux, "sequence resynchronized");
             block_ChainRelease (src->blocks);
             src->blocks = NULL;
+            src->last = NULL;
         }
         else
         {
@@ -351,22 +354,31 @@ rtp_queue (demux_t *demux, rtp_session_t *session, block_t *block)
         src->max_seq = seq + 1;
 
     /* Queues the block in sequence order,
-     * hence there is a single queue for all payload types. */
+     * hence there is a single queue for all payload types.
+     * Whole receive batches mostly arrive in order: appending after the
+     * last queued block is then O(1) rather than a walk of the queue. */
     block_t **pp = &src->blocks;
-    for (block_t *prev = *pp; prev != NULL; prev = *pp)
+    if (src->last != NULL && (int16_t)(seq - rtp_seq (src->last)) > 0)
+        pp = &src->last->p_next;
+    else
     {
-        delta_seq = seq - rtp_seq (prev);
-        if (delta_seq < 0)
-            break;
-        if (delta_seq == 0)
+        for (block_t *prev = *pp; prev != NULL; prev = *pp)
         {
-            msg_Dbg (demux, "duplicate packet (sequence: %"PRIu16")", seq);
-            goto drop; /* duplicate */
+            delta_seq = seq - rtp_seq (prev);
+            if (delta_seq < 0)
+                break;
+            if (delta_seq == 0)
+            {
+                msg_Dbg (demux, "duplicate packet (sequence: %"PRIu16")", seq);
+                goto drop; /* duplicate */
+            }
+            pp = &prev->p_next;
         }
-        pp = &prev->p_next;
     }
     block->p_next = *pp;
     *pp = block;
+    if (block->p_next == NULL)
+        src->last = block;
 
     /*rtp_decode (demux, session, src);*/
     return;
@@ -487,6 +499,8 @@ rtp_decode (demux_t *demux, const rtp_session_t *session, rtp_source_t *src)
 
     assert (block);
     src->blocks = block->p_next;
+    if (src->blocks == NULL)
+        src->last = NULL;
     block->p_next = NULL;
 
     /* Discontinuity detection */
@@ -117,6 +117,11 @@ static void test_keystream (void)
     if (gcry_cipher_setkey (hd, key, sizeof (key)))
         fatal ("Cipher key error");
 
+    gcry_cipher_hd_t hd2;
+    if (gcry_cipher_open (&hd2, GCRY_CIPHER_AES, GCRY_CIPHER_MODE_CTR, 0)
+     || gcry_cipher_setkey (hd2, key, sizeof (key)))
+        fatal ("Cipher initialization error");
+
     if (rtp_crypt (hd, 0, 0, 0, salt, buf, 0xff020))
         fatal ("Encryption failure");
     gcry_cipher_close (hd);
@@ -138,6 +143,18 @@ static void test_keystream (void)
      || memcmp (buf + 0xff020 - sizeof (good_end), good_end,
                 sizeof (good_end)))
         fatal ("Key stream test failed");
+
+    /* Truncated last block */
+    uint8_t tail[37];
+    memset (tail, 0, sizeof (tail));
+    if (rtp_crypt (hd2, 0, 0, 0, salt, tail, sizeof (tail)))
+        fatal ("Encryption failure");
+    gcry_cipher_close (hd2);
+
+    printf (" truncated:   ");
+    printhex (tail, sizeof (tail));
+    if (memcmp (tail, good_start, sizeof (tail)))
+        fatal ("Truncated key stream test failed");
     free (buf);
 }
 
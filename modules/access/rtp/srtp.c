@@ -205,26 +205,12 @@ error:
 static int
 do_ctr_crypt (gcry_cipher_hd_t hd, const void *ctr, uint8_t *data, size_t len)
 {
-    const size_t ctrlen = 16;
-    div_t d = div (len, ctrlen);
-
-    if (gcry_cipher_setctr (hd, ctr, ctrlen)
-     || gcry_cipher_encrypt (hd, data, d.quot * ctrlen, NULL, 0))
+    /* libgcrypt truncates the last key stream block by itself,
+     * so the whole text goes through the bulk (AES-NI) code at once. */
+    if (gcry_cipher_setctr (hd, ctr, 16)
+     || gcry_cipher_encrypt (hd, data, len, NULL, 0))
         return -1;
 
-    if (d.rem)
-    {
-        /* Truncated last block */
-        uint8_t dummy[ctrlen];
-        data += d.quot * ctrlen;
-        memcpy (dummy, data, d.rem);
-        memset (dummy + d.rem, 0, ctrlen - d.rem);
-
-        if (gcry_cipher_encrypt (hd, dummy, ctrlen, data, ctrlen))
-            return -1;
-        memcpy (data, dummy, d.rem);
-    }
-
     return 0;
 }
 
@@ -686,6 +672,38 @@ srtp_recv (srtp_session_t *s, uint8_t *buf, size_t *lenp)
 }
 
 
+/**
+ * Turns an array of SRTP packets into RTP packets, in order. This is
+ * equivalent to srtp_recv() on each packet, but lets the receiver process
+ * a whole batch of datagrams with a single call, through the cipher and
+ * MAC contexts keyed once by srtp_setkey().
+ *
+ * @param bufv array of SRTP packets to be digested/decrypted
+ * @param lenv array of the SRTP packets lengths on entry,
+ *             set to the RTP lengths on exit (undefined in case of error)
+ * @param errv array set to the per-packet error codes (see srtp_recv())
+ * @param count number of packets in the arrays
+ *
+ * @return the number of packets successfully authenticated and decrypted
+ */
+unsigned
+srtp_recv_batch (srtp_session_t *s, uint8_t *const *bufv, size_t *lenv,
+                 int *errv, unsigned count)
+{
+    unsigned ok = 0;
+
+    /* The replay window and the Roll-Over-Counter depend on the previous
+     * packets, hence the packets must be processed in order. */
+    for (unsigned i = 0; i < count; i++)
+    {
+        errv[i] = srtp_recv (s, bufv[i], lenv + i);
+        if (errv[i] == 0)
+            ok++;
+    }
+    return ok;
+}
+
+
 /** AES-CM for RTCP (salt = 14 bytes + 2 nul bytes) */
 static int
 rtcp_crypt (gcry_cipher_hd_t hd, uint32_t ssrc, uint32_t index,
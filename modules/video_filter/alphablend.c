@@ -0,0 +1,626 @@
+/*****************************************************************************
+ * alphablend.c : Dual lens alpha blend projection video filter for vlc
+ *****************************************************************************
+ * Copyright (C) 2018 LINKFLOW Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************
+ * CPU version of the alpha blend projection of the OpenGL output
+ * (opengl_fragment_shader_init_impl_for_alpha_blend). The quad input holds
+ * the front lenses in the upper half and the rear lenses in the lower half;
+ * left and right lenses are shifted towards each other and cross-faded over
+ * the overlap, as getLSourceCoord()/getRSourceCoord() do.
+ *
+ * The horizontal mapping only depends on the column, so it is turned into
+ * a table per plane and half: two bilinear taps per lens and Q14 weights
+ * that already include the cross-fade. Each line then is a weighted sum of
+ * four source pixels per output pixel.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <math.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+#include <vlc_cpu.h>
+#include "filter_picture.h"
+
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+#endif
+
+#define RATIO_FRONT_TEXT N_("Alpha blending's overlapping ratio(front)")
+#define RATIO_REAR_TEXT N_("Alpha blending's overlapping ratio(rear)")
+#define FITTODISPLAY_TEXT N_("Enable fitting to display after alpha blend")
+#define SHOW_DIVIDER_TEXT N_("Show camera divider")
+#define ENABLE_TEXT N_("Enable alpha blend")
+#define ENABLE_LONGTEXT N_("Enable alpha blend. The picture is passed " \
+    "through unchanged otherwise, as the OpenGL output does.")
+
+#define ALPHABLEND_HELP N_("Cross-fade the left and right lenses of a " \
+    "front/rear quad picture, same as the OpenGL alpha blend projection.")
+
+/*****************************************************************************
+ * Local prototypes
+ *****************************************************************************/
+static int  Create    ( vlc_object_t * );
+static void Destroy   ( vlc_object_t * );
+
+static picture_t *Filter( filter_t *, picture_t * );
+static int AlphaBlendCallback( vlc_object_t *, char const *,
+                               vlc_value_t, vlc_value_t, void * );
+
+/* Same options as the OpenGL outputs */
+#define CFG_PREFIX "alpha-blend-"
+
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+vlc_module_begin ()
+    set_description( N_("Alpha blend projection video filter") )
+    set_shortname( N_("Alpha blend projection") )
+    set_help( ALPHABLEND_HELP )
+    set_category( CAT_VIDEO )
+    set_subcategory( SUBCAT_VIDEO_VFILTER )
+    set_capability( "video filter", 0 )
+    add_bool( CFG_PREFIX "fit-to-display", true, FITTODISPLAY_TEXT, FITTODISPLAY_TEXT, true )
+    add_bool( CFG_PREFIX "show-divider", false, SHOW_DIVIDER_TEXT, SHOW_DIVIDER_TEXT, true )
+    add_bool( CFG_PREFIX "enable-blend", false, ENABLE_TEXT, ENABLE_LONGTEXT, true )
+    add_float_with_range( CFG_PREFIX "ratio-front", 0.09, 0.0, 0.5, RATIO_FRONT_TEXT, RATIO_FRONT_TEXT, false )
+    change_safe()
+    add_float_with_range( CFG_PREFIX "ratio-rear", 0.135, 0.0, 0.5, RATIO_REAR_TEXT, RATIO_REAR_TEXT, false )
+    change_safe()
+    add_shortcut( "alphablend" )
+    set_callbacks( Create, Destroy )
+vlc_module_end ()
+
+static const char *const ppsz_filter_options[] = {
+    "ratio-front", "ratio-rear", "fit-to-display", "show-divider",
+    "enable-blend", NULL
+};
+
+/* Divider width in texture coordinates, as in the shader */
+#define V_DIVIDER 0.002f
+#define H_DIVIDER (V_DIVIDER * 9.f / 16.f)
+
+#define WEIGHT_BITS 14
+#define BLOCK 8
+
+/* Column table of one half (front or rear) of one plane */
+typedef struct
+{
+    int32_t *off_l;     /* left lens tap, the second one is at +1 */
+    int32_t *off_r;     /* right lens tap */
+    int16_t *weight_l;  /* Q14 weights of both left taps, interleaved */
+    int16_t *weight_r;
+    uint8_t *contig;    /* block of BLOCK columns reads contiguous pixels */
+    unsigned *black;    /* start, count of the columns without any lens */
+    unsigned i_black;
+} blend_line_t;
+
+typedef struct
+{
+    float ratio[2];     /* front, rear */
+    bool fit;
+    bool divider;
+    bool enable;
+} blend_params_t;
+
+typedef struct
+{
+    vlc_mutex_t lock;
+    blend_params_t params;
+    bool b_dirty;
+
+    /* Tables, owned by the filter thread */
+    blend_params_t cur;
+    int i_planes;
+    int i_width[PICTURE_PLANE_MAX];
+    int i_lines[PICTURE_PLANE_MAX];
+    blend_line_t line[PICTURE_PLANE_MAX][2];
+} filter_sys_t;
+
+/*****************************************************************************
+ * Tables
+ *****************************************************************************/
+
+/* getLSourceCoord(): source x of the left lens and its alpha */
+static float SourceL( float x, float mix, const blend_params_t *p, float *alpha )
+{
+    const float h_divider = p->divider ? H_DIVIDER : 0.f;
+
+    *alpha = 0.f;
+    if( mix == 0.f && x > .5f - h_divider )
+        return x;
+
+    if( !p->fit )
+        x -= mix;
+    else
+    {
+        float scale = (.5f + mix) / .5f;
+        x = (x - mix) / scale + (mix / scale);
+    }
+
+    if( x < 0.f || x > .5f )
+        return x;
+
+    float overlap = 2.f * mix;
+    float start = .5f - overlap;
+    *alpha = (x > start && x < .5f) ? 1.f - (x - start) * (1.f / overlap) : 1.f;
+    return x;
+}
+
+/* getRSourceCoord() */
+static float SourceR( float x, float mix, const blend_params_t *p, float *alpha )
+{
+    const float h_divider = p->divider ? H_DIVIDER : 0.f;
+
+    *alpha = 0.f;
+    if( mix == 0.f && x < .5f + h_divider )
+        return x;
+
+    if( !p->fit )
+        x += mix;
+    else
+    {
+        float scale = (.5f + mix) / .5f;
+        x = (x + mix) / scale + (mix / scale);
+    }
+
+    if( x < .5f || x > 1.f )
+        return x;
+
+    float overlap = 2.f * mix;
+    float end = .5f + overlap;
+    *alpha = (x > .5f && x < end) ? (x - .5f) * (1.f / overlap) : 1.f;
+    return x;
+}
+
+/* Bilinear taps of texture coordinate x on a line of i_width pixels,
+ * clamped to the edge. The tap is at most i_width - 2. */
+static int Tap( float x, int i_width, float *frac )
+{
+    float u = x * i_width - .5f;
+    int i = (int)floorf( u );
+
+    *frac = u - i;
+    if( i < 0 )
+    {
+        i = 0;
+        *frac = 0.f;
+    }
+    else if( i >= i_width - 1 )
+    {
+        i = i_width - 2;
+        *frac = 1.f;
+    }
+    return i;
+}
+
+static void FreeLine( blend_line_t *line )
+{
+    free( line->off_l );
+    free( line->off_r );
+    free( line->weight_l );
+    free( line->weight_r );
+    free( line->contig );
+    free( line->black );
+    memset( line, 0, sizeof(*line) );
+}
+
+static int BuildLine( blend_line_t *line, int i_width, float mix,
+                      const blend_params_t *p )
+{
+    FreeLine( line );
+
+    line->off_l = vlc_alloc( i_width, sizeof(*line->off_l) );
+    line->off_r = vlc_alloc( i_width, sizeof(*line->off_r) );
+    line->weight_l = vlc_alloc( 2 * i_width, sizeof(*line->weight_l) );
+    line->weight_r = vlc_alloc( 2 * i_width, sizeof(*line->weight_r) );
+    line->contig = malloc( i_width / BLOCK + 1 );
+    line->black = vlc_alloc( i_width + 1, sizeof(*line->black) );
+    if( !line->off_l || !line->off_r || !line->weight_l || !line->weight_r
+     || !line->contig || !line->black )
+    {
+        FreeLine( line );
+        return VLC_ENOMEM;
+    }
+
+    const int one = 1 << WEIGHT_BITS;
+    int i_run = -1;
+
+    for( int j = 0; j < i_width; j++ )
+    {
+        const float x = (j + .5f) / i_width;
+        float alpha_l, alpha_r, frac_l, frac_r;
+        float xl = SourceL( x, mix, p, &alpha_l );
+        float xr = SourceR( x, mix, p, &alpha_r );
+        int l = Tap( xl, i_width, &frac_l );
+        int r = Tap( xr, i_width, &frac_r );
+        int16_t *wl = &line->weight_l[2 * j];
+        int16_t *wr = &line->weight_r[2 * j];
+
+        if( alpha_l + alpha_r <= 0.f )
+        {
+            /* Divider or outside of both lenses: black, filled afterwards.
+             * Keep the taps in range and contiguous with the neighbours. */
+            l = r = VLC_CLIP( j, 0, i_width - 2 );
+            wl[0] = wl[1] = wr[0] = wr[1] = 0;
+            if( i_run < 0 || line->black[2 * i_run] + line->black[2 * i_run + 1] != (unsigned)j )
+            {
+                i_run++;
+                line->black[2 * i_run] = j;
+                line->black[2 * i_run + 1] = 0;
+            }
+            line->black[2 * i_run + 1]++;
+        }
+        else
+        {
+            /* (colors_l * a_l + colors_r * a_r) / (a_l + a_r) */
+            float share = alpha_l / (alpha_l + alpha_r);
+            int w[4] = {
+                lroundf( one * share * (1.f - frac_l) ),
+                lroundf( one * share * frac_l ),
+                lroundf( one * (1.f - share) * (1.f - frac_r) ),
+                lroundf( one * (1.f - share) * frac_r ),
+            };
+
+            /* Rounding residue on the largest tap, weights sum to one */
+            int k_max = 0;
+            for( int k = 1; k < 4; k++ )
+                if( w[k] > w[k_max] )
+                    k_max = k;
+            w[k_max] += one - (w[0] + w[1] + w[2] + w[3]);
+
+            wl[0] = w[0]; wl[1] = w[1];
+            wr[0] = w[2]; wr[1] = w[3];
+
+            /* Unused lens follows the other one, for contiguous blocks */
+            if( alpha_l <= 0.f )
+                l = r;
+            else if( alpha_r <= 0.f )
+                r = l;
+        }
+
+        line->off_l[j] = l;
+        line->off_r[j] = r;
+    }
+    line->i_black = i_run + 1;
+
+    for( int b = 0; b < i_width / BLOCK; b++ )
+    {
+        const int32_t *ol = &line->off_l[b * BLOCK];
+        const int32_t *o_r = &line->off_r[b * BLOCK];
+        bool contig = true;
+        for( int k = 1; k < BLOCK && contig; k++ )
+            contig = ol[k] == ol[0] + k && o_r[k] == o_r[0] + k;
+        line->contig[b] = contig;
+    }
+
+    return VLC_SUCCESS;
+}
+
+static void FreeTables( filter_sys_t *p_sys )
+{
+    for( int i = 0; i < PICTURE_PLANE_MAX; i++ )
+    {
+        FreeLine( &p_sys->line[i][0] );
+        FreeLine( &p_sys->line[i][1] );
+        p_sys->i_width[i] = p_sys->i_lines[i] = 0;
+    }
+    p_sys->i_planes = 0;
+}
+
+static int BuildTables( filter_sys_t *p_sys, const picture_t *p_pic )
+{
+    FreeTables( p_sys );
+
+    for( int i = 0; i < p_pic->i_planes; i++ )
+    {
+        const int i_width = p_pic->p[i].i_visible_pitch / p_pic->p[i].i_pixel_pitch;
+        if( i_width < 2 )
+            return VLC_EGENERIC;
+
+        for( int half = 0; half < 2; half++ )
+            if( BuildLine( &p_sys->line[i][half], i_width,
+                           p_sys->cur.ratio[half], &p_sys->cur ) )
+            {
+                FreeTables( p_sys );
+                return VLC_ENOMEM;
+            }
+
+        p_sys->i_width[i] = i_width;
+        p_sys->i_lines[i] = p_pic->p[i].i_visible_lines;
+    }
+    p_sys->i_planes = p_pic->i_planes;
+    return VLC_SUCCESS;
+}
+
+static bool TablesMatch( const filter_sys_t *p_sys, const picture_t *p_pic )
+{
+    if( p_sys->i_planes != p_pic->i_planes )
+        return false;
+    for( int i = 0; i < p_pic->i_planes; i++ )
+        if( p_sys->i_width[i] != p_pic->p[i].i_visible_pitch / p_pic->p[i].i_pixel_pitch
+         || p_sys->i_lines[i] != p_pic->p[i].i_visible_lines )
+            return false;
+    return true;
+}
+
+/*****************************************************************************
+ * Line kernels
+ *****************************************************************************/
+static void BlendPixels( uint8_t *dst, const uint8_t *src,
+                         const blend_line_t *line, int j, int end )
+{
+    for( ; j < end; j++ )
+    {
+        const uint8_t *pl = &src[line->off_l[j]];
+        const uint8_t *pr = &src[line->off_r[j]];
+        const int16_t *wl = &line->weight_l[2 * j];
+        const int16_t *wr = &line->weight_r[2 * j];
+        int v = wl[0] * pl[0] + wl[1] * pl[1] + wr[0] * pr[0] + wr[1] * pr[1];
+
+        dst[j] = (v + (1 << (WEIGHT_BITS - 1))) >> WEIGHT_BITS;
+    }
+}
+
+static void BlendLine_C( uint8_t *dst, const uint8_t *src,
+                         const blend_line_t *line, int i_width )
+{
+    BlendPixels( dst, src, line, 0, i_width );
+}
+
+#ifdef HAVE_SSE2_INTRINSICS
+/* Pairs (p[0], p[1]) .. (p[7], p[8]) multiplied by the interleaved weights */
+__attribute__ ((__target__ ("sse2")))
+static inline void MulTaps( const uint8_t *p, const int16_t *w,
+                            __m128i *lo, __m128i *hi )
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i a = _mm_unpacklo_epi8( _mm_loadl_epi64( (const __m128i *)p ), zero );
+    __m128i b = _mm_unpacklo_epi8( _mm_loadl_epi64( (const __m128i *)(p + 1) ), zero );
+
+    *lo = _mm_madd_epi16( _mm_unpacklo_epi16( a, b ), _mm_loadu_si128( (const __m128i *)w ) );
+    *hi = _mm_madd_epi16( _mm_unpackhi_epi16( a, b ), _mm_loadu_si128( (const __m128i *)(w + 8) ) );
+}
+
+/* Same as MulTaps() for taps that do not advance by one column (fit to
+ * display scaling): the pairs are gathered as 16-bit words first */
+__attribute__ ((__target__ ("sse2")))
+static inline void MulTapsGather( const uint8_t *src, const int32_t *off,
+                                  const int16_t *w, __m128i *lo, __m128i *hi )
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i v = _mm_set_epi16( GetWLE( &src[off[7]] ), GetWLE( &src[off[6]] ),
+                               GetWLE( &src[off[5]] ), GetWLE( &src[off[4]] ),
+                               GetWLE( &src[off[3]] ), GetWLE( &src[off[2]] ),
+                               GetWLE( &src[off[1]] ), GetWLE( &src[off[0]] ) );
+
+    *lo = _mm_madd_epi16( _mm_unpacklo_epi8( v, zero ), _mm_loadu_si128( (const __m128i *)w ) );
+    *hi = _mm_madd_epi16( _mm_unpackhi_epi8( v, zero ), _mm_loadu_si128( (const __m128i *)(w + 8) ) );
+}
+
+__attribute__ ((__target__ ("sse2")))
+static void BlendLine_SSE2( uint8_t *dst, const uint8_t *src,
+                            const blend_line_t *line, int i_width )
+{
+    const __m128i rnd = _mm_set1_epi32( 1 << (WEIGHT_BITS - 1) );
+    int j = 0;
+
+    for( ; j + BLOCK <= i_width; j += BLOCK )
+    {
+        __m128i l_lo, l_hi, r_lo, r_hi;
+        if( line->contig[j / BLOCK] )
+        {
+            MulTaps( &src[line->off_l[j]], &line->weight_l[2 * j], &l_lo, &l_hi );
+            MulTaps( &src[line->off_r[j]], &line->weight_r[2 * j], &r_lo, &r_hi );
+        }
+        else
+        {
+            MulTapsGather( src, &line->off_l[j], &line->weight_l[2 * j], &l_lo, &l_hi );
+            MulTapsGather( src, &line->off_r[j], &line->weight_r[2 * j], &r_lo, &r_hi );
+        }
+
+        __m128i lo = _mm_srai_epi32( _mm_add_epi32( _mm_add_epi32( l_lo, r_lo ), rnd ), WEIGHT_BITS );
+        __m128i hi = _mm_srai_epi32( _mm_add_epi32( _mm_add_epi32( l_hi, r_hi ), rnd ), WEIGHT_BITS );
+        __m128i v = _mm_packs_epi32( lo, hi );
+        _mm_storel_epi64( (__m128i *)&dst[j], _mm_packus_epi16( v, v ) );
+    }
+
+    BlendPixels( dst, src, line, j, i_width );
+}
+#endif
+
+/*****************************************************************************
+ * Create: allocates the filter
+ *****************************************************************************/
+static int Create( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+
+    const vlc_fourcc_t fourcc = p_filter->fmt_in.video.i_chroma;
+    const vlc_chroma_description_t *p_chroma = vlc_fourcc_GetChromaDescription( fourcc );
+    if( !p_chroma || !vlc_fourcc_IsYUV( fourcc ) || p_chroma->plane_count != 3
+     || p_chroma->pixel_size != 1 )
+    {
+        msg_Dbg( p_filter, "Unsupported chroma (%4.4s)", (char*)&fourcc );
+        return VLC_EGENERIC;
+    }
+
+    if( !video_format_IsSimilar( &p_filter->fmt_in.video, &p_filter->fmt_out.video ) )
+    {
+        msg_Err( p_filter, "Input and output formats don't match" );
+        return VLC_EGENERIC;
+    }
+
+    filter_sys_t *p_sys = calloc( 1, sizeof( filter_sys_t ) );
+    if( p_sys == NULL )
+        return VLC_ENOMEM;
+    p_filter->p_sys = p_sys;
+
+    config_ChainParse( p_filter, CFG_PREFIX, ppsz_filter_options,
+                       p_filter->p_cfg );
+
+    vlc_mutex_init( &p_sys->lock );
+    p_sys->params.ratio[0] = var_CreateGetFloatCommand( p_filter, CFG_PREFIX "ratio-front" );
+    p_sys->params.ratio[1] = var_CreateGetFloatCommand( p_filter, CFG_PREFIX "ratio-rear" );
+    p_sys->params.fit = var_CreateGetBoolCommand( p_filter, CFG_PREFIX "fit-to-display" );
+    p_sys->params.divider = var_CreateGetBoolCommand( p_filter, CFG_PREFIX "show-divider" );
+    p_sys->params.enable = var_CreateGetBoolCommand( p_filter, CFG_PREFIX "enable-blend" );
+    p_sys->b_dirty = true;
+
+    for( int i = 0; ppsz_filter_options[i] != NULL; i++ )
+    {
+        char psz_var[32];
+        snprintf( psz_var, sizeof(psz_var), CFG_PREFIX "%s", ppsz_filter_options[i] );
+        var_AddCallback( p_filter, psz_var, AlphaBlendCallback, p_sys );
+    }
+
+    p_filter->pf_video_filter = Filter;
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Destroy: destroy the filter
+ *****************************************************************************/
+static void Destroy( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    for( int i = 0; ppsz_filter_options[i] != NULL; i++ )
+    {
+        char psz_var[32];
+        snprintf( psz_var, sizeof(psz_var), CFG_PREFIX "%s", ppsz_filter_options[i] );
+        var_DelCallback( p_filter, psz_var, AlphaBlendCallback, p_sys );
+    }
+
+    FreeTables( p_sys );
+    vlc_mutex_destroy( &p_sys->lock );
+    free( p_sys );
+}
+
+/*****************************************************************************
+ * Filter
+ *****************************************************************************/
+static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( !p_pic )
+        return NULL;
+
+    vlc_mutex_lock( &p_sys->lock );
+    bool b_dirty = p_sys->b_dirty;
+    p_sys->cur = p_sys->params;
+    p_sys->b_dirty = false;
+    vlc_mutex_unlock( &p_sys->lock );
+
+    /* Both lenses sample the same point: the picture itself */
+    if( !p_sys->cur.enable )
+        return p_pic;
+
+    if( ( b_dirty || !TablesMatch( p_sys, p_pic ) )
+     && BuildTables( p_sys, p_pic ) )
+    {
+        msg_Err( p_filter, "cannot build the blend tables" );
+        picture_Release( p_pic );
+        return NULL;
+    }
+
+    picture_t *p_outpic = filter_NewPicture( p_filter );
+    if( !p_outpic )
+    {
+        picture_Release( p_pic );
+        return NULL;
+    }
+
+    void (*blend_line)( uint8_t *, const uint8_t *, const blend_line_t *, int ) = BlendLine_C;
+#ifdef HAVE_SSE2_INTRINSICS
+    if( vlc_CPU_SSE2() )
+        blend_line = BlendLine_SSE2;
+#endif
+
+    const bool b_full = p_filter->fmt_in.video.b_color_range_full;
+
+    for( int i = 0; i < p_sys->i_planes; i++ )
+    {
+        const plane_t *p_src = &p_pic->p[i];
+        plane_t *p_dst = &p_outpic->p[i];
+        const int i_width = p_sys->i_width[i];
+        const int i_lines = p_sys->i_lines[i];
+        const uint8_t black = i == Y_PLANE ? (b_full ? 0 : 16) : 128;
+        const float v_divider = p_sys->cur.divider ? V_DIVIDER : 0.f;
+
+        for( int y = 0; y < i_lines; y++ )
+        {
+            const float pt_y = (y + .5f) / i_lines;
+            const uint8_t *src = &p_src->p_pixels[y * p_src->i_pitch];
+            uint8_t *dst = &p_dst->p_pixels[y * p_dst->i_pitch];
+            const blend_line_t *line;
+
+            if( pt_y < .5f - v_divider )
+                line = &p_sys->line[i][0];
+            else if( pt_y > .5f + v_divider )
+                line = &p_sys->line[i][1];
+            else
+            {
+                memset( dst, black, i_width );
+                continue;
+            }
+
+            blend_line( dst, src, line, i_width );
+            for( unsigned k = 0; k < line->i_black; k++ )
+                memset( &dst[line->black[2 * k]], black, line->black[2 * k + 1] );
+        }
+    }
+
+    return CopyInfoAndRelease( p_outpic, p_pic );
+}
+
+static int AlphaBlendCallback( vlc_object_t *p_this, char const *psz_var,
+                               vlc_value_t oldval, vlc_value_t newval,
+                               void *p_data )
+{
+    VLC_UNUSED(p_this); VLC_UNUSED(oldval);
+    filter_sys_t *p_sys = (filter_sys_t *)p_data;
+    const char *psz_opt = psz_var + strlen( CFG_PREFIX );
+
+    vlc_mutex_lock( &p_sys->lock );
+    if( !strcmp( psz_opt, "ratio-front" ) )
+        p_sys->params.ratio[0] = VLC_CLIP( newval.f_float, 0.f, .5f );
+    else if( !strcmp( psz_opt, "ratio-rear" ) )
+        p_sys->params.ratio[1] = VLC_CLIP( newval.f_float, 0.f, .5f );
+    else if( !strcmp( psz_opt, "fit-to-display" ) )
+        p_sys->params.fit = newval.b_bool;
+    else if( !strcmp( psz_opt, "show-divider" ) )
+        p_sys->params.divider = newval.b_bool;
+    else if( !strcmp( psz_opt, "enable-blend" ) )
+        p_sys->params.enable = newval.b_bool;
+    p_sys->b_dirty = true;
+    vlc_mutex_unlock( &p_sys->lock );
+
+    return VLC_SUCCESS;
+}
@@ -0,0 +1,82 @@
+/*****************************************************************************
+ * filter_mirror.h: Byte reversed row copy shared by the lens filters
+ *****************************************************************************
+ * Copyright (C) 2018 LINKFLOW Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_FILTER_MIRROR_H
+#define VLC_FILTER_MIRROR_H
+
+#include <vlc_cpu.h>
+
+#ifdef HAVE_SSE2_INTRINSICS
+# include <emmintrin.h>
+#endif
+
+typedef void (*mirror_row_t)( uint8_t *, const uint8_t *, int );
+
+/* dst[0 .. n-1] = src[n-1 .. 0] */
+static inline void MirrorRow_C( uint8_t *dst, const uint8_t *src, int n )
+{
+    for( int i = 0; i < n; i++ )
+        dst[i] = src[n - 1 - i];
+}
+
+#ifdef HAVE_SSE2_INTRINSICS
+/* SSE2 has no byte shuffle: reverse the dwords, then the words inside
+ * each dword, then the bytes inside each word */
+__attribute__ ((__target__ ("sse2")))
+static inline __m128i Reverse16( __m128i v )
+{
+    v = _mm_shuffle_epi32( v, _MM_SHUFFLE( 0, 1, 2, 3 ) );
+    v = _mm_shufflelo_epi16( v, _MM_SHUFFLE( 2, 3, 0, 1 ) );
+    v = _mm_shufflehi_epi16( v, _MM_SHUFFLE( 2, 3, 0, 1 ) );
+    return _mm_or_si128( _mm_slli_epi16( v, 8 ), _mm_srli_epi16( v, 8 ) );
+}
+
+__attribute__ ((__target__ ("sse2")))
+static inline void MirrorRow_SSE2( uint8_t *dst, const uint8_t *src, int n )
+{
+    int i = 0;
+
+    for( ; i + 32 <= n; i += 32 )
+    {
+        __m128i a = _mm_loadu_si128( (const __m128i *)&src[n - i - 16] );
+        __m128i b = _mm_loadu_si128( (const __m128i *)&src[n - i - 32] );
+        _mm_storeu_si128( (__m128i *)&dst[i], Reverse16( a ) );
+        _mm_storeu_si128( (__m128i *)&dst[i + 16], Reverse16( b ) );
+    }
+    for( ; i + 16 <= n; i += 16 )
+    {
+        __m128i a = _mm_loadu_si128( (const __m128i *)&src[n - i - 16] );
+        _mm_storeu_si128( (__m128i *)&dst[i], Reverse16( a ) );
+    }
+    for( ; i < n; i++ )
+        dst[i] = src[n - 1 - i];
+}
+#endif
+
+static inline mirror_row_t MirrorRowSelect( void )
+{
+#ifdef HAVE_SSE2_INTRINSICS
+    if( vlc_CPU_SSE2() )
+        return MirrorRow_SSE2;
+#endif
+    return MirrorRow_C;
+}
+
+#endif
@@ -24,30 +24,18 @@
 # include "config.h"
 #endif
 
-#include <assert.h>
-#include <atomic>
-#include <iostream>
-
 #include <vlc_common.h>
 #include <vlc_plugin.h>
 #include <vlc_filter.h>
 #include <vlc_picture.h>
-#include <vlc_image.h>
-#include <vlc_modules.h>
-#include <vlc_vout.h>
 
 #include "filter_picture.h"
-
-#include "opencv2/imgproc.hpp"
-
-using namespace cv;
-using namespace std;
+#include "filter_mirror.h"
 
 static int  Create      ( vlc_object_t * );
 static void Destroy     ( vlc_object_t * );
 
 static picture_t *Filter( filter_t *, picture_t * );
-static int FilterCallback( vlc_object_t *, char const *, vlc_value_t, vlc_value_t, void * );
 
 vlc_module_begin ()
     set_description( N_("flipswap") )
@@ -60,35 +48,9 @@ vlc_module_begin ()
 vlc_module_end ()
 
 typedef struct {
-    image_handler_t* p_image_handle;
-
-    picture_t* p_proc_image;
+    mirror_row_t mirror_row;
 } filter_sys_t;
 
-void FrameRender(filter_t* ptrFilter, Mat& frame)
-{
-    filter_t *p_filter = (filter_t *)ptrFilter;
-    filter_sys_t *p_sys = (filter_sys_t *)p_filter->p_sys;
-
-    if(!p_sys)
-        return;
-
-    Mat lowerleft = frame(Rect(0, frame.rows/2, frame.cols/2, frame.rows/2));
-    Mat lowerright = frame(Rect(frame.cols/2, frame.rows/2, frame.cols/2, frame.rows/2));
-    flip(lowerleft, lowerleft, 1);
-    flip(lowerright, lowerright, 1);
-
-	// Swap
-    //Mat tmp = lowerright.clone();
-    //lowerleft.copyTo(frame(Rect(frame.cols/2, frame.rows/2, frame.cols/2, frame.rows/2)));
-    //tmp.copyTo(frame(Rect(0, frame.rows/2, frame.cols/2, frame.rows/2)));
-
-	// Not Swap
-	Mat tmp = lowerright.clone();
-	lowerleft.copyTo(frame(Rect(0, frame.rows/2, frame.cols/2, frame.rows/2)));
-	tmp.copyTo(frame(Rect(frame.cols/2, frame.rows/2, frame.cols/2, frame.rows/2)));
-}
-
 static int Create( vlc_object_t *p_this )
 {
     filter_t *p_filter = (filter_t *)p_this;
@@ -112,10 +74,10 @@ static int Create( vlc_object_t *p_this )
     if(p_sys == NULL )
         return VLC_ENOMEM;
 
+    p_sys->mirror_row = MirrorRowSelect();
+
     p_filter->p_sys = p_sys;
     p_filter->pf_video_filter = Filter;
-    p_sys->p_image_handle = image_HandlerCreate( p_filter );
-    p_sys->p_proc_image = NULL;
 
     printf("FlipSwap plugin created\n");
 
@@ -127,77 +89,36 @@ static void Destroy( vlc_object_t *p_this )
     filter_t *p_filter = (filter_t *)p_this;
     filter_sys_t *p_sys = (filter_sys_t *)p_filter->p_sys;
 
-    if (p_sys->p_image_handle) {
-        image_HandlerDelete( p_sys->p_image_handle );
-    }
-
-    if(p_sys->p_proc_image) {
-        picture_Release(p_sys->p_proc_image);
-        p_sys->p_proc_image = NULL;
-    }
-
     printf("FlipSwap Plugin destroyed\n");
     free( p_sys );
 }
 
-static void ReleaseImages( filter_t* p_filter )
+/* The upper half of the quad image is copied as is; in the lower half
+ * each horizontal half of every row is mirrored on its own, so the rear
+ * lenses are flipped without being swapped. All the accepted chromas are
+ * 8 bits planar, a pixel is a byte on every plane. */
+static void MirrorPlane( filter_sys_t *p_sys, plane_t *p_dst, const plane_t *p_src )
 {
-    filter_sys_t* p_sys = (filter_sys_t*)p_filter->p_sys;
-    if(p_sys->p_proc_image) {
-        picture_Release(p_sys->p_proc_image);
-        p_sys->p_proc_image = NULL;
-    }
-}
-
-static void PictureToRGBMat( filter_t* p_filter, picture_t* p_in, Mat& m)
-{
-    filter_sys_t* p_sys = (filter_sys_t *)p_filter->p_sys;
-
-    if(!p_in) {
-        msg_Err( p_filter, "couldn't get a p_in!" );
-        return;
-    }
-
-    video_format_t fmt_out;
-    memset( &fmt_out, 0, sizeof(video_format_t) );
-    fmt_out = p_in->format;
-    fmt_out.i_chroma = VLC_CODEC_RGB24;
+    const int i_lines = __MIN( p_src->i_visible_lines, p_dst->i_visible_lines );
+    const int i_width = __MIN( p_src->i_visible_pitch, p_dst->i_visible_pitch );
+    const int i_upper = i_lines / 2;
+    const int i_half = i_width / 2;
 
-    p_sys->p_proc_image = image_Convert(p_sys->p_image_handle, p_in, &(p_in->format), &fmt_out );
+    for( int y = 0; y < i_upper; y++ )
+        memcpy( &p_dst->p_pixels[y * p_dst->i_pitch],
+                &p_src->p_pixels[y * p_src->i_pitch], i_width );
 
-    if (!p_sys->p_proc_image)
+    for( int y = i_upper; y < i_lines; y++ )
     {
-        msg_Err(p_filter, "can't convert (unsupported formats?), aborting...");
-        return;
+        uint8_t *dst = &p_dst->p_pixels[y * p_dst->i_pitch];
+        const uint8_t *src = &p_src->p_pixels[y * p_src->i_pitch];
+
+        p_sys->mirror_row( dst, src, i_half );
+        p_sys->mirror_row( &dst[i_half], &src[i_half], i_half );
+        /* Odd widths: the last column belongs to neither lens */
+        if( i_width > 2 * i_half )
+            dst[2 * i_half] = src[2 * i_half];
     }
-
-    Size sz = cvSize(abs(p_in->p[0].i_visible_pitch / p_in->p[0].i_pixel_pitch), abs(p_in->p[0].i_visible_lines));
-
-    m = Mat(sz, CV_8UC3, p_sys->p_proc_image->p[0].p_pixels);
-}
-
-static void PrepareResultPicture(filter_t* p_filter, picture_t* ref_pic, picture_t* out_pic)
-{
-    filter_sys_t* p_sys = (filter_sys_t *)p_filter->p_sys;
-
-    if(!ref_pic || !out_pic) {
-        msg_Err( p_filter, "No input pictures" );
-        return;
-    }
-
-    video_format_t fmt_out;
-    memset( &fmt_out, 0, sizeof(video_format_t));
-    fmt_out = ref_pic->format;
-
-    // RGB -> YUV
-    picture_t* p_outpic_tmp = image_Convert(
-            p_sys->p_image_handle,
-            p_sys->p_proc_image,
-            &(p_sys->p_proc_image->format),
-            &fmt_out );
-
-    picture_CopyPixels( out_pic, p_outpic_tmp );
-    CopyInfoAndRelease( out_pic, p_outpic_tmp );
 }
 
 static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
@@ -213,32 +134,8 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
 
     filter_sys_t *p_sys = (filter_sys_t *)p_filter->p_sys;
 
-    Mat frame;
-
-    // Make OpenCV mat from picture and allocate separately
-    PictureToRGBMat(p_filter, p_pic, frame);
-
-    // Render scene of current input
-    FrameRender(p_filter, frame);
-
-    // Make output picture(YUV) from dest picture(RGB)
-    PrepareResultPicture(p_filter, p_pic, p_outpic);
-
-    // Release current output buffer and Mat
-    ReleaseImages(p_filter);
-
-    // Release picture in order to get next picture
-    picture_Release(p_pic);
-    frame.release();
+    for( int i = 0; i < __MIN( p_pic->i_planes, p_outpic->i_planes ); i++ )
+        MirrorPlane( p_sys, &p_outpic->p[i], &p_pic->p[i] );
 
-    return p_outpic;
-}
-
-static int FilterCallback ( vlc_object_t *p_this, char const *psz_var,
-                            vlc_value_t oldval, vlc_value_t newval, void *p_data )
-{
-    (void) p_this; (void)oldval;
-    filter_sys_t *p_sys = (filter_sys_t *)p_data;
-
-    return VLC_SUCCESS;
+    return CopyInfoAndRelease( p_outpic, p_pic );
 }
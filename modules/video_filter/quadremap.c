@@ -0,0 +1,640 @@
+/*****************************************************************************
+ * quadremap.c : Quad lens layout remapper for vlc
+ *****************************************************************************
+ * Copyright (C) 2018 LINKFLOW Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <limits.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+#include "filter_picture.h"
+#include "filter_mirror.h"
+
+#define ORDER_TEXT N_("Lens order")
+#define ORDER_LONGTEXT N_("Comma separated source quadrant (0 upper left, " \
+    "1 upper right, 2 lower left, 3 lower right) shown in each output " \
+    "quadrant, in the same order.")
+#define TYPE_TEXT N_("Lens transforms")
+#define TYPE_LONGTEXT N_("Comma separated transform of each output " \
+    "quadrant: 0, 90, 180, 270, hflip, vflip, transpose or antitranspose. " \
+    "A single value applies to all of them.")
+#define CROP_TEXT N_("Lens crop")
+#define CROP_LONGTEXT N_("Comma separated pixels masked on the borders of " \
+    "each source lens, either one value for all borders or " \
+    "top:left:bottom:right. A single value applies to all lenses.")
+
+#define QUADREMAP_HELP N_("Reorder, rotate, flip and crop the four lenses " \
+    "of a quad picture in a single pass.")
+
+/*****************************************************************************
+ * Local prototypes
+ *****************************************************************************/
+static int  Create    ( vlc_object_t * );
+static void Destroy   ( vlc_object_t * );
+
+static picture_t *Filter( filter_t *, picture_t * );
+static int QuadRemapCallback( vlc_object_t *, char const *,
+                              vlc_value_t, vlc_value_t, void * );
+
+#define CFG_PREFIX "quadremap-"
+
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+vlc_module_begin ()
+    set_description( N_("Quad lens remapper video filter") )
+    set_shortname( N_("Quad remap") )
+    set_help( QUADREMAP_HELP )
+    set_category( CAT_VIDEO )
+    set_subcategory( SUBCAT_VIDEO_VFILTER )
+    set_capability( "video filter", 0 )
+    add_string( CFG_PREFIX "order", "0,1,2,3", ORDER_TEXT, ORDER_LONGTEXT, false )
+    change_safe()
+    add_string( CFG_PREFIX "type", "0,0,hflip,hflip", TYPE_TEXT, TYPE_LONGTEXT, false )
+    change_safe()
+    add_string( CFG_PREFIX "crop", "0", CROP_TEXT, CROP_LONGTEXT, false )
+    change_safe()
+    add_shortcut( "quadremap" )
+    set_callbacks( Create, Destroy )
+vlc_module_end ()
+
+static const char *const ppsz_filter_options[] = {
+    "order", "type", "crop", NULL
+};
+
+/* Same names and orientations as the transform filter. Source pixel of
+ * the output pixel (x, y) of a W x H lens:
+ *   sx = xx * x + xy * y (+ W - 1 if xx < 0, + H - 1 if xy < 0)
+ *   sy = yx * x + yy * y (+ W - 1 if yx < 0, + H - 1 if yy < 0) */
+static const char *const type_list[] = { "0", "90", "180", "270",
+    "hflip", "vflip", "transpose", "antitranspose" };
+static const int8_t type_matrix[][4] = {
+    {  1,  0,  0,  1 }, {  0,  1, -1,  0 }, { -1,  0,  0, -1 }, {  0, -1,  1,  0 },
+    { -1,  0,  0,  1 }, {  1,  0,  0, -1 }, {  0,  1,  1,  0 }, {  0, -1, -1,  0 },
+};
+
+#define LENSES 4
+
+typedef struct
+{
+    unsigned src;       /* source quadrant */
+    unsigned type;      /* index in type_list */
+    int crop[4];        /* top, left, bottom, right, in luma pixels */
+} lens_t;
+
+enum
+{
+    SPAN_FILL,          /* black */
+    SPAN_COPY,          /* source pixels left to right */
+    SPAN_REVERSE,       /* source pixels right to left */
+    SPAN_STRIDE,        /* source pixels down or up a column */
+};
+
+/* One run of output pixels of one row, with where it reads from */
+typedef struct
+{
+    uint8_t op;
+    int8_t dx, dy;      /* source step per output pixel, SPAN_STRIDE */
+    int len;
+    int dst_x, dst_y;
+    int src_x, src_y;   /* source of the first output pixel */
+} span_t;
+
+/* Spans of one plane, sorted by output row then column, so that the
+ * program writes the output plane once from top to bottom */
+typedef struct
+{
+    span_t *spans;
+    unsigned i_spans;
+    int i_width;        /* geometry the program was built for */
+    int i_lines;
+    uint8_t fill;
+} program_t;
+
+typedef struct
+{
+    vlc_mutex_t lock;
+    char *psz_opt[3];   /* order, type and crop options as last accepted */
+    lens_t params[LENSES];
+    bool b_dirty;
+
+    lens_t cur[LENSES];
+    program_t prog[PICTURE_PLANE_MAX];
+    int i_planes;
+    mirror_row_t mirror_row;
+} filter_sys_t;
+
+/*****************************************************************************
+ * Options
+ *****************************************************************************/
+
+/* Splits psz in place on commas, returns the number of items */
+static int SplitList( char *psz, char **items, int i_max )
+{
+    int n = 0;
+    while( psz != NULL )
+    {
+        if( n == i_max )
+            return -1;
+        items[n++] = psz;
+        psz = strchr( psz, ',' );
+        if( psz != NULL )
+            *psz++ = '\0';
+    }
+    return n;
+}
+
+static int ParseInt( const char *psz, int *pi_val, const char **ppsz_end )
+{
+    char *end;
+    long val = strtol( psz, &end, 10 );
+    if( end == psz || val < 0 || val > INT_MAX )
+        return VLC_EGENERIC;
+    *pi_val = val;
+    *ppsz_end = end;
+    return VLC_SUCCESS;
+}
+
+static int ParseOrder( char *psz, lens_t *lens )
+{
+    char *items[LENSES];
+    if( SplitList( psz, items, LENSES ) != LENSES )
+        return VLC_EGENERIC;
+
+    for( int i = 0; i < LENSES; i++ )
+    {
+        const char *end;
+        int src;
+        if( ParseInt( items[i], &src, &end ) || *end != '\0' || src >= LENSES )
+            return VLC_EGENERIC;
+        lens[i].src = src;
+    }
+    return VLC_SUCCESS;
+}
+
+static int ParseType( char *psz, lens_t *lens )
+{
+    char *items[LENSES];
+    const int n = SplitList( psz, items, LENSES );
+    if( n != 1 && n != LENSES )
+        return VLC_EGENERIC;
+
+    for( int i = 0; i < LENSES; i++ )
+    {
+        const char *item = items[n == 1 ? 0 : i];
+        unsigned t = 0;
+        while( t < ARRAY_SIZE(type_list) && strcmp( item, type_list[t] ) )
+            t++;
+        if( t == ARRAY_SIZE(type_list) )
+            return VLC_EGENERIC;
+        lens[i].type = t;
+    }
+    return VLC_SUCCESS;
+}
+
+static int ParseCrop( char *psz, lens_t *lens )
+{
+    char *items[LENSES];
+    const int n = SplitList( psz, items, LENSES );
+    if( n != 1 && n != LENSES )
+        return VLC_EGENERIC;
+
+    for( int i = 0; i < LENSES; i++ )
+    {
+        const char *p = items[n == 1 ? 0 : i];
+        int crop[4], k = 0;
+        for( ;; )
+        {
+            if( k == 4 || ParseInt( p, &crop[k++], &p ) )
+                return VLC_EGENERIC;
+            if( *p == '\0' )
+                break;
+            if( *p++ != ':' )
+                return VLC_EGENERIC;
+        }
+        if( k != 1 && k != 4 )
+            return VLC_EGENERIC;
+        for( int j = 0; j < 4; j++ )
+            lens[i].crop[j] = crop[k == 1 ? 0 : j];
+    }
+    return VLC_SUCCESS;
+}
+
+/* order, type and crop into lens, which is left unchanged on error */
+static int ParseLayout( filter_t *p_filter, char *const *ppsz_opt, lens_t *lens )
+{
+    static int (*const parse[])( char *, lens_t * ) = {
+        ParseOrder, ParseType, ParseCrop
+    };
+    lens_t tmp[LENSES];
+
+    for( int i = 0; i < 3; i++ )
+    {
+        char *psz = strdup( ppsz_opt[i] ? ppsz_opt[i] : "" );
+        if( psz == NULL )
+            return VLC_ENOMEM;
+        int i_ret = parse[i]( psz, tmp );
+        free( psz );
+        if( i_ret )
+        {
+            msg_Err( p_filter, "invalid " CFG_PREFIX "%s \"%s\"",
+                     ppsz_filter_options[i], ppsz_opt[i] ? ppsz_opt[i] : "" );
+            return VLC_EGENERIC;
+        }
+    }
+    memcpy( lens, tmp, sizeof(tmp) );
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Program
+ *****************************************************************************/
+
+/* Appends a span, merged into the previous one when it continues it */
+static void Emit( program_t *prog, const span_t *s )
+{
+    if( s->len <= 0 )
+        return;
+
+    if( prog->i_spans > 0 )
+    {
+        span_t *last = &prog->spans[prog->i_spans - 1];
+        if( last->op == s->op && last->dst_y == s->dst_y
+         && last->dst_x + last->len == s->dst_x
+         && ( s->op == SPAN_FILL
+           || ( s->op == SPAN_COPY && last->src_y == s->src_y
+             && last->src_x + last->len == s->src_x )
+           || ( s->op == SPAN_REVERSE && last->src_y == s->src_y
+             && last->src_x - last->len == s->src_x ) ) )
+        {
+            last->len += s->len;
+            return;
+        }
+    }
+    prog->spans[prog->i_spans++] = *s;
+}
+
+/* Narrows [*lo, *hi) to the x for which min <= a * x + b < max */
+static void Clip( int *lo, int *hi, int a, int b, int min, int max )
+{
+    if( a == 0 )
+    {
+        if( b < min || b >= max )
+            *hi = *lo;
+        return;
+    }
+
+    int l, h;
+    if( a > 0 )
+    {
+        l = min - b;
+        h = max - b;
+    }
+    else
+    {
+        l = b - max + 1;
+        h = b - min + 1;
+    }
+    *lo = __MAX( *lo, l );
+    *hi = __MAX( __MIN( *hi, h ), *lo );
+}
+
+static int CropScale( int i_crop, int i_plane, int i_luma )
+{
+    return ( (int64_t)i_crop * i_plane + i_luma - 1 ) / i_luma;
+}
+
+/* Row y of the output lens at (x0, y0), w x h on this plane. A lens
+ * rotated into a quadrant of another aspect ratio is cropped or padded,
+ * as its source pixels are clipped to the source quadrant. */
+static void EmitLensRow( program_t *prog, const lens_t *lens,
+                         const int *crop, int w, int h,
+                         int x0, int y0, int y )
+{
+    const int8_t *m = type_matrix[lens->type];
+    const int sx0 = ( lens->src % 2 ) * w;
+    const int sy0 = ( lens->src / 2 ) * h;
+    const int bx = m[1] * y + ( m[0] < 0 ? w - 1 : m[1] < 0 ? h - 1 : 0 );
+    const int by = m[3] * y + ( m[2] < 0 ? w - 1 : m[3] < 0 ? h - 1 : 0 );
+
+    int lo = 0, hi = w;
+    Clip( &lo, &hi, m[0], bx, crop[1], w - crop[3] );
+    Clip( &lo, &hi, m[2], by, crop[0], h - crop[2] );
+
+    span_t s = { .op = SPAN_FILL, .len = lo, .dst_x = x0, .dst_y = y0 + y };
+    Emit( prog, &s );
+
+    s.op = m[2] != 0 ? SPAN_STRIDE : m[0] > 0 ? SPAN_COPY : SPAN_REVERSE;
+    s.dx = m[0];
+    s.dy = m[2];
+    s.len = hi - lo;
+    s.dst_x = x0 + lo;
+    s.src_x = sx0 + m[0] * lo + bx;
+    s.src_y = sy0 + m[2] * lo + by;
+    Emit( prog, &s );
+
+    s = (span_t){ .op = SPAN_FILL, .len = w - hi, .dst_x = x0 + hi, .dst_y = y0 + y };
+    Emit( prog, &s );
+}
+
+static int BuildProgram( program_t *prog, const lens_t *lens,
+                         const plane_t *p_plane, const plane_t *p_luma )
+{
+    const int i_width = p_plane->i_visible_pitch;
+    const int i_lines = p_plane->i_visible_lines;
+    const int w = i_width / 2;
+    const int h = i_lines / 2;
+
+    /* 3 spans per lens row, a last odd column, then merged */
+    span_t *spans = vlc_alloc( i_lines, 7 * sizeof(*spans) );
+    if( spans == NULL )
+        return VLC_ENOMEM;
+    free( prog->spans );
+    prog->spans = spans;
+    prog->i_spans = 0;
+    prog->i_width = i_width;
+    prog->i_lines = i_lines;
+
+    int crop[LENSES][4];
+    for( int i = 0; i < LENSES; i++ )
+        for( int j = 0; j < 4; j++ )
+            crop[i][j] = ( j % 2 )
+                ? CropScale( lens[i].crop[j], i_width, p_luma->i_visible_pitch )
+                : CropScale( lens[i].crop[j], i_lines, p_luma->i_visible_lines );
+
+    for( int y = 0; y < i_lines; y++ )
+    {
+        /* The odd last row and column belong to no lens */
+        if( y >= 2 * h )
+        {
+            span_t s = { .op = SPAN_COPY, .dx = 1, .len = i_width,
+                         .dst_y = y, .src_y = y };
+            Emit( prog, &s );
+            continue;
+        }
+
+        for( int q = 2 * ( y / h ); q < 2 * ( y / h ) + 2; q++ )
+            EmitLensRow( prog, &lens[q], crop[q], w, h,
+                         ( q % 2 ) * w, ( q / 2 ) * h, y % h );
+
+        span_t s = { .op = SPAN_COPY, .dx = 1, .len = i_width - 2 * w,
+                     .dst_x = 2 * w, .dst_y = y, .src_x = 2 * w, .src_y = y };
+        Emit( prog, &s );
+    }
+
+    span_t *shrunk = realloc( prog->spans, prog->i_spans * sizeof(*spans) );
+    if( shrunk != NULL )
+        prog->spans = shrunk;
+    return VLC_SUCCESS;
+}
+
+static bool ProgramMatches( const filter_sys_t *p_sys, const picture_t *p_pic )
+{
+    if( p_sys->i_planes != p_pic->i_planes )
+        return false;
+    for( int i = 0; i < p_pic->i_planes; i++ )
+        if( p_sys->prog[i].i_width != p_pic->p[i].i_visible_pitch
+         || p_sys->prog[i].i_lines != p_pic->p[i].i_visible_lines )
+            return false;
+    return true;
+}
+
+static void FreePrograms( filter_sys_t *p_sys )
+{
+    for( int i = 0; i < PICTURE_PLANE_MAX; i++ )
+    {
+        free( p_sys->prog[i].spans );
+        p_sys->prog[i].spans = NULL;
+        p_sys->prog[i].i_spans = 0;
+    }
+    p_sys->i_planes = 0;
+}
+
+static int BuildPrograms( filter_t *p_filter, const picture_t *p_pic )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const bool b_full = p_filter->fmt_in.video.b_color_range_full;
+
+    for( int i = 0; i < p_pic->i_planes; i++ )
+    {
+        if( BuildProgram( &p_sys->prog[i], p_sys->cur, &p_pic->p[i], &p_pic->p[0] ) )
+        {
+            FreePrograms( p_sys );
+            return VLC_ENOMEM;
+        }
+        p_sys->prog[i].fill = i == 0 ? ( b_full ? 0x00 : 0x10 )
+                            : i == A_PLANE ? 0xff : 0x80;
+    }
+    p_sys->i_planes = p_pic->i_planes;
+    return VLC_SUCCESS;
+}
+
+static void RunProgram( const program_t *prog, mirror_row_t mirror_row,
+                        plane_t *p_dst, const plane_t *p_src )
+{
+    for( unsigned i = 0; i < prog->i_spans; i++ )
+    {
+        const span_t *s = &prog->spans[i];
+        uint8_t *dst = &p_dst->p_pixels[s->dst_y * p_dst->i_pitch + s->dst_x];
+        const uint8_t *src = &p_src->p_pixels[s->src_y * p_src->i_pitch + s->src_x];
+
+        switch( s->op )
+        {
+            case SPAN_FILL:
+                memset( dst, prog->fill, s->len );
+                break;
+            case SPAN_COPY:
+                memcpy( dst, src, s->len );
+                break;
+            case SPAN_REVERSE:
+                mirror_row( dst, src - s->len + 1, s->len );
+                break;
+            case SPAN_STRIDE:
+            {
+                const ptrdiff_t step = s->dx + (ptrdiff_t)s->dy * p_src->i_pitch;
+                for( int x = 0; x < s->len; x++ )
+                    dst[x] = src[x * step];
+                break;
+            }
+        }
+    }
+}
+
+/*****************************************************************************
+ * Create: allocates the filter
+ *****************************************************************************/
+static int Create( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+
+    switch( p_filter->fmt_in.video.i_chroma ) {
+        CASE_PLANAR_YUV_SQUARE
+            break;
+        default:
+            msg_Dbg( p_filter, "Unsupported input chroma (%4.4s)",
+                     (char*)&p_filter->fmt_in.video.i_chroma );
+            return VLC_EGENERIC;
+    }
+
+    if( !video_format_IsSimilar( &p_filter->fmt_in.video, &p_filter->fmt_out.video ) )
+    {
+        msg_Err( p_filter, "Input and output formats don't match" );
+        return VLC_EGENERIC;
+    }
+
+    filter_sys_t *p_sys = calloc( 1, sizeof( filter_sys_t ) );
+    if( p_sys == NULL )
+        return VLC_ENOMEM;
+    p_filter->p_sys = p_sys;
+
+    config_ChainParse( p_filter, CFG_PREFIX, ppsz_filter_options,
+                       p_filter->p_cfg );
+
+    for( int i = 0; ppsz_filter_options[i] != NULL; i++ )
+    {
+        char psz_var[32];
+        snprintf( psz_var, sizeof(psz_var), CFG_PREFIX "%s", ppsz_filter_options[i] );
+        p_sys->psz_opt[i] = var_CreateGetStringCommand( p_filter, psz_var );
+    }
+
+    if( ParseLayout( p_filter, p_sys->psz_opt, p_sys->params ) )
+    {
+        for( int i = 0; i < 3; i++ )
+            free( p_sys->psz_opt[i] );
+        free( p_sys );
+        return VLC_EGENERIC;
+    }
+
+    vlc_mutex_init( &p_sys->lock );
+    p_sys->b_dirty = true;
+    p_sys->mirror_row = MirrorRowSelect();
+
+    for( int i = 0; ppsz_filter_options[i] != NULL; i++ )
+    {
+        char psz_var[32];
+        snprintf( psz_var, sizeof(psz_var), CFG_PREFIX "%s", ppsz_filter_options[i] );
+        var_AddCallback( p_filter, psz_var, QuadRemapCallback, p_sys );
+    }
+
+    p_filter->pf_video_filter = Filter;
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Destroy: destroy the filter
+ *****************************************************************************/
+static void Destroy( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    for( int i = 0; ppsz_filter_options[i] != NULL; i++ )
+    {
+        char psz_var[32];
+        snprintf( psz_var, sizeof(psz_var), CFG_PREFIX "%s", ppsz_filter_options[i] );
+        var_DelCallback( p_filter, psz_var, QuadRemapCallback, p_sys );
+        free( p_sys->psz_opt[i] );
+    }
+
+    FreePrograms( p_sys );
+    vlc_mutex_destroy( &p_sys->lock );
+    free( p_sys );
+}
+
+/*****************************************************************************
+ * Filter
+ *****************************************************************************/
+static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( !p_pic )
+        return NULL;
+
+    vlc_mutex_lock( &p_sys->lock );
+    bool b_dirty = p_sys->b_dirty;
+    memcpy( p_sys->cur, p_sys->params, sizeof(p_sys->cur) );
+    p_sys->b_dirty = false;
+    vlc_mutex_unlock( &p_sys->lock );
+
+    if( ( b_dirty || !ProgramMatches( p_sys, p_pic ) )
+     && BuildPrograms( p_filter, p_pic ) )
+    {
+        msg_Err( p_filter, "cannot build the remap program" );
+        picture_Release( p_pic );
+        return NULL;
+    }
+
+    picture_t *p_outpic = filter_NewPicture( p_filter );
+    if( !p_outpic )
+    {
+        picture_Release( p_pic );
+        return NULL;
+    }
+
+    for( int i = 0; i < p_sys->i_planes; i++ )
+        RunProgram( &p_sys->prog[i], p_sys->mirror_row,
+                    &p_outpic->p[i], &p_pic->p[i] );
+
+    return CopyInfoAndRelease( p_outpic, p_pic );
+}
+
+static int QuadRemapCallback( vlc_object_t *p_this, char const *psz_var,
+                              vlc_value_t oldval, vlc_value_t newval,
+                              void *p_data )
+{
+    VLC_UNUSED(oldval);
+    filter_t *p_filter = (filter_t *)p_this;
+    filter_sys_t *p_sys = (filter_sys_t *)p_data;
+    const char *psz_opt = psz_var + strlen( CFG_PREFIX );
+
+    int i = 0;
+    while( strcmp( psz_opt, ppsz_filter_options[i] ) )
+        i++;
+
+    char *psz_new = strdup( newval.psz_string ? newval.psz_string : "" );
+    if( psz_new == NULL )
+        return VLC_ENOMEM;
+
+    vlc_mutex_lock( &p_sys->lock );
+    char *ppsz_opt[3] = { p_sys->psz_opt[0], p_sys->psz_opt[1], p_sys->psz_opt[2] };
+    ppsz_opt[i] = psz_new;
+
+    int i_ret = ParseLayout( p_filter, ppsz_opt, p_sys->params );
+    if( i_ret == VLC_SUCCESS )
+    {
+        free( p_sys->psz_opt[i] );
+        p_sys->psz_opt[i] = psz_new;
+        p_sys->b_dirty = true;
+    }
+    else
+        free( psz_new );
+    vlc_mutex_unlock( &p_sys->lock );
+
+    return i_ret;
+}
@@ -0,0 +1,309 @@
+/* Copyright (C) LINKFLOW Co.,Ltd. - All Rights Reserved
+ * Unauthorized copying of this file, via any medium is strictly prohibited
+ * Proprietary and confidential
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include <vlc_common.h>
+#include <vlc_fs.h>
+
+#include "LFSecurity.h"
+#include "StitchCore.h"
+#include "CalibCache.h"
+
+#ifdef _WIN32
+# ifndef NOMINMAX
+#  define NOMINMAX
+# endif
+# include <windows.h>
+# include <io.h>
+#else
+# include <sys/mman.h>
+# include <unistd.h>
+#endif
+
+// "LFSC", bump the version whenever the layout changes
+static const uint32_t cache_magic = 0x4353464C;
+static const uint32_t cache_version = 1;
+
+// Read-only mapping of a whole file
+class MappedFile
+{
+public:
+    MappedFile() : data(NULL), size(0), fd(-1)
+#ifdef _WIN32
+        , mapping(NULL)
+#endif
+    {}
+    ~MappedFile() { Close(); }
+
+    bool Open(const string& path)
+    {
+        fd = vlc_open(path.c_str(), O_RDONLY);
+        if(fd == -1)
+            return false;
+
+        struct stat st;
+        if(fstat(fd, &st) != 0 || st.st_size <= 0) {
+            Close();
+            return false;
+        }
+        size = (size_t)st.st_size;
+
+#ifdef _WIN32
+        mapping = CreateFileMapping((HANDLE)_get_osfhandle(fd), NULL, PAGE_READONLY, 0, 0, NULL);
+        if(mapping != NULL)
+            data = (const uchar*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+        void* addr = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(addr != MAP_FAILED)
+            data = (const uchar*)addr;
+#endif
+        if(data == NULL) {
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    void Close()
+    {
+#ifdef _WIN32
+        if(data != NULL)
+            UnmapViewOfFile(data);
+        if(mapping != NULL)
+            CloseHandle(mapping);
+        mapping = NULL;
+#else
+        if(data != NULL)
+            munmap((void*)data, size);
+#endif
+        if(fd != -1)
+            vlc_close(fd);
+        data = NULL;
+        size = 0;
+        fd = -1;
+    }
+
+    const uchar* data;
+    size_t size;
+
+private:
+    int fd;
+#ifdef _WIN32
+    HANDLE mapping;
+#endif
+};
+
+// Bounds checked reader over the mapped file, ok turns false on overrun
+class CacheReader
+{
+public:
+    CacheReader(const uchar* data, size_t size) : ok(true), p(data), end(data + size) {}
+
+    template<typename T> T Get()
+    {
+        T v = T();
+        if(!Take(&v, sizeof(T)))
+            ok = false;
+        return v;
+    }
+
+    void GetMat(Mat& m, int type)
+    {
+        int rows = Get<int32_t>(), cols = Get<int32_t>();
+        if(!ok || rows < 0 || cols < 0 || rows > 1 << 15 || cols > 1 << 15) {
+            ok = false;
+            return;
+        }
+        m.create(rows, cols, type);
+        if(!Take(m.data, m.total() * m.elemSize()))
+            ok = false;
+    }
+
+    bool ok;
+
+private:
+    bool Take(void* dst, size_t n)
+    {
+        if(!ok || (size_t)(end - p) < n)
+            return false;
+        memcpy(dst, p, n);
+        p += n;
+        return true;
+    }
+
+    const uchar* p;
+    const uchar* end;
+};
+
+class CacheWriter
+{
+public:
+    template<typename T> void Put(T v)
+    {
+        const uchar* p = (const uchar*)&v;
+        buf.insert(buf.end(), p, p + sizeof(T));
+    }
+
+    void PutMat(const Mat& m, int type)
+    {
+        Mat c;
+        m.convertTo(c, type);
+        Put<int32_t>(c.rows);
+        Put<int32_t>(c.cols);
+        buf.insert(buf.end(), c.data, c.data + c.total() * c.elemSize());
+    }
+
+    vector<uchar> buf;
+};
+
+string MakeCalibCachePath(const string& dir, const string& device, int width, int height)
+{
+    // Keep the device name usable as a file name
+    string name = device;
+    for(size_t i = 0; i < name.size(); i++) {
+        char c = name[i];
+        if(!isalnum((unsigned char)c) && c != '-' && c != '_')
+            name[i] = '_';
+    }
+
+    return dir + DIR_SEP "stitching-" + name + "-" + to_string(width) + "x" + to_string(height) + ".bin";
+}
+
+static bool ReadRecord(CacheReader& in, stCalibRecord& rec)
+{
+    rec.num_images = in.Get<int32_t>();
+    rec.work_scale = in.Get<double>();
+    rec.seam_scale = in.Get<double>();
+    rec.compose_scale = in.Get<double>();
+    rec.seam_work_aspect = in.Get<double>();
+    rec.warped_image_scale = in.Get<float>();
+    rec.crop_box.x = in.Get<int32_t>();
+    rec.crop_box.y = in.Get<int32_t>();
+    rec.crop_box.width = in.Get<int32_t>();
+    rec.crop_box.height = in.Get<int32_t>();
+    if(!in.ok || rec.num_images <= 0 || rec.num_images > 4)
+        return false;
+
+    rec.cameras.resize(rec.num_images);
+    rec.seam_masks.resize(rec.num_images);
+    rec.gain_maps.resize(rec.num_images);
+    for(int i = 0; i < rec.num_images; i++) {
+        CameraParams& cam = rec.cameras[i];
+        cam.focal = in.Get<double>();
+        cam.aspect = in.Get<double>();
+        cam.ppx = in.Get<double>();
+        cam.ppy = in.Get<double>();
+        in.GetMat(cam.R, CV_32F);
+        in.GetMat(cam.t, CV_64F);
+        in.GetMat(rec.seam_masks[i], CV_8U);
+        in.GetMat(rec.gain_maps[i], CV_32F);
+        if(!in.ok || cam.R.size() != Size(3, 3) || cam.t.size() != Size(1, 3))
+            return false;
+    }
+
+    return true;
+}
+
+static void WriteRecord(CacheWriter& out, const stCalibRecord& rec)
+{
+    out.Put<int32_t>(rec.num_images);
+    out.Put<double>(rec.work_scale);
+    out.Put<double>(rec.seam_scale);
+    out.Put<double>(rec.compose_scale);
+    out.Put<double>(rec.seam_work_aspect);
+    out.Put<float>(rec.warped_image_scale);
+    out.Put<int32_t>(rec.crop_box.x);
+    out.Put<int32_t>(rec.crop_box.y);
+    out.Put<int32_t>(rec.crop_box.width);
+    out.Put<int32_t>(rec.crop_box.height);
+
+    for(int i = 0; i < rec.num_images; i++) {
+        const CameraParams& cam = rec.cameras[i];
+        out.Put<double>(cam.focal);
+        out.Put<double>(cam.aspect);
+        out.Put<double>(cam.ppx);
+        out.Put<double>(cam.ppy);
+        out.PutMat(cam.R, CV_32F);
+        out.PutMat(cam.t, CV_64F);
+        out.PutMat(rec.seam_masks[i], CV_8U);
+        out.PutMat(rec.gain_maps[i], CV_32F);
+    }
+}
+
+bool LoadCalibCache(const string& path, stCalibRecord rec[CAMDIR_END], bool valid[CAMDIR_END])
+{
+    for(int seq = FRONT; seq < CAMDIR_END; seq++)
+        valid[seq] = false;
+
+    MappedFile file;
+    if(!file.Open(path))
+        return false;
+
+    CacheReader in(file.data, file.size);
+    if(in.Get<uint32_t>() != cache_magic || in.Get<uint32_t>() != cache_version
+       || in.Get<uint32_t>() != CAMDIR_END || !in.ok) {
+        cout << "[ERR] Ignoring calibration cache of another version: " << path << endl;
+        return false;
+    }
+
+    bool found = false;
+    for(int seq = FRONT; seq < CAMDIR_END; seq++) {
+        if(in.Get<uint8_t>() == 0)
+            continue;
+        if(!ReadRecord(in, rec[seq])) {
+            cout << "[ERR] Broken calibration cache: " << path << endl;
+            break;
+        }
+        valid[seq] = found = true;
+    }
+
+    return found;
+}
+
+bool SaveCalibCache(const string& path, const stCalibRecord rec[CAMDIR_END], const bool valid[CAMDIR_END])
+{
+    CacheWriter out;
+    out.Put<uint32_t>(cache_magic);
+    out.Put<uint32_t>(cache_version);
+    out.Put<uint32_t>(CAMDIR_END);
+    for(int seq = FRONT; seq < CAMDIR_END; seq++) {
+        out.Put<uint8_t>(valid[seq] ? 1 : 0);
+        if(valid[seq])
+            WriteRecord(out, rec[seq]);
+    }
+
+    // Written aside and renamed, a reader never sees a partial file. The
+    // temporary name is unique to the process and the instance, so that
+    // stitchers of the same camera never write the same file.
+#ifdef _WIN32
+    unsigned long pid = GetCurrentProcessId();
+#else
+    unsigned long pid = getpid();
+#endif
+    char suffix[64];
+    snprintf(suffix, sizeof(suffix), ".%lu.%p.tmp", pid, (const void*)rec);
+    string tmp = path + suffix;
+    FILE* f = vlc_fopen(tmp.c_str(), "wb");
+    if(f == NULL)
+        return false;
+    bool ok = fwrite(out.buf.data(), 1, out.buf.size(), f) == out.buf.size();
+    ok = (fclose(f) == 0) && ok;
+    if(!ok || vlc_rename(tmp.c_str(), path.c_str()) != 0) {
+        vlc_unlink(tmp.c_str());
+        return false;
+    }
+
+    return true;
+}
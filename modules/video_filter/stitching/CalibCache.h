@@ -0,0 +1,16 @@
+#ifndef _CALIBCACHE_H_
+#define _CALIBCACHE_H_
+
+#include <string>
+
+// Last good calibration of every direction, in a small binary file per
+// device and input resolution. Loaded when the stitcher starts so that the
+// first frame is already stitched, rewritten after each calibration.
+
+// Cache file for the device (not empty) and the input frame size, in dir
+string MakeCalibCachePath(const string& dir, const string& device, int width, int height);
+// valid[seq] tells which records were found
+bool LoadCalibCache(const string& path, stCalibRecord rec[CAMDIR_END], bool valid[CAMDIR_END]);
+bool SaveCalibCache(const string& path, const stCalibRecord rec[CAMDIR_END], const bool valid[CAMDIR_END]);
+
+#endif // _CALIBCACHE_H_
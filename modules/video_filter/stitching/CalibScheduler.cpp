@@ -0,0 +1,82 @@
+/* Copyright (C) LINKFLOW Co.,Ltd. - All Rights Reserved
+ * Unauthorized copying of this file, via any medium is strictly prohibited
+ * Proprietary and confidential
+ */
+
+#include "CalibScheduler.h"
+
+// Upper bound of calculation workers shared by all stitching instances
+static const unsigned max_calib_workers = 4;
+
+static std::mutex mtxInstance;
+static std::weak_ptr<CalibScheduler> instance;
+
+std::shared_ptr<CalibScheduler> CalibScheduler::Acquire()
+{
+    std::lock_guard<std::mutex> lock(mtxInstance);
+
+    std::shared_ptr<CalibScheduler> scheduler = instance.lock();
+    if(!scheduler) {
+        unsigned numWorkers = std::thread::hardware_concurrency() / 2;
+        if(numWorkers < 1)
+            numWorkers = 1;
+        else if(numWorkers > max_calib_workers)
+            numWorkers = max_calib_workers;
+
+        scheduler.reset(new CalibScheduler(numWorkers));
+        instance = scheduler;
+    }
+
+    return scheduler;
+}
+
+CalibScheduler::CalibScheduler(unsigned numWorkers)
+    : bStop(false)
+{
+    for(unsigned i = 0; i < numWorkers; i++)
+        workers.push_back(std::thread(&CalibScheduler::WorkerThread, this));
+}
+
+CalibScheduler::~CalibScheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        bStop = true;
+    }
+    cond.notify_all();
+
+    for(size_t i = 0; i < workers.size(); i++) {
+        if(workers[i].joinable())
+            workers[i].join();
+    }
+}
+
+void CalibScheduler::Submit(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        jobs.push_back(std::move(job));
+    }
+    cond.notify_one();
+}
+
+void CalibScheduler::WorkerThread()
+{
+    while(true) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            while(!bStop && jobs.empty())
+                cond.wait(lock);
+
+            // Remaining jobs are still run, their owners wait for them
+            if(jobs.empty())
+                break;
+
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+
+        job();
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef _CALIBSCHEDULER_H_
+#define _CALIBSCHEDULER_H_
+
+#ifdef __MINGW32__
+#include "mingw.thread.h"
+#include "mingw.mutex.h"
+#include "mingw.condition_variable.h"
+#else
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#endif
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+// Worker pool running parameter calculation jobs of every stitching
+// instance in the process. Workers sleep on a condition variable until a
+// job is submitted, so nothing runs while no calibration is requested.
+class CalibScheduler
+{
+public:
+    ~CalibScheduler();
+
+    // The pool is created with the first user and joined with the last one
+    static std::shared_ptr<CalibScheduler> Acquire();
+
+    void Submit(std::function<void()> job);
+
+private:
+    CalibScheduler(unsigned numWorkers);
+    void WorkerThread();
+
+    std::mutex mtx;
+    std::condition_variable cond;
+    std::deque<std::function<void()> > jobs;
+    bool bStop;
+    vector<std::thread> workers;
+};
+
+#endif // _CALIBSCHEDULER_H_
@@ -25,6 +25,7 @@
 #include "opencv2/core/core.hpp"
 #include "opencv2/imgproc.hpp"
 #include "opencv2/objdetect.hpp"
+#include "opencv2/core/hal/intrin.hpp"
 
 #include "LFSecurity.h"
 #include "FaceDetection.h"
@@ -105,154 +106,401 @@ Mat GetSkin(Mat const &src)
     return dst;
 }
 
-bool isSkin(Mat const &src)
+// The three rules above as evaluated on one BGR pixel, without intermediate
+// images. YCrCb is computed as cvtColor() does on 8 bit data. The hue rule
+// takes H scaled from [0,360] to [0,255]: H < 25 or H > 230 is a red
+// maximum with 60 * |G - B| / (R - min) < 25 * 360 / 255, that is
+// 17 * |G - B| < 10 * (R - min).
+static const int skin_y_r = 4899, skin_y_g = 9617, skin_y_b = 1868; // 0.299, 0.587, 0.114
+static const int skin_cr = 11682, skin_cb = 9241;                  // 0.713, 0.564
+static const int skin_yuv_shift = 14;
+static const int skin_yuv_delta = 128 << skin_yuv_shift;
+
+static inline bool R2f(float Cr, float Cb)
 {
-    Mat src_ycrcb, src_hsv;
-    // OpenCV scales the YCrCb components, so that they
-    // cover the whole value range of [0,255], so there's
-    // no need to scale the values:
-    cvtColor(src, src_ycrcb, CV_BGR2YCrCb);
-    // OpenCV scales the Hue Channel to [0,180] for
-    // 8bit images, so make sure we are operating on
-    // the full spectrum from [0,360] by using floating
-    // point precision:
-    src.convertTo(src_hsv, CV_32FC3);
-    cvtColor(src_hsv, src_hsv, CV_BGR2HSV);
-    // Now scale the values between [0,255]:
-    normalize(src_hsv, src_hsv, 0.0, 255.0, NORM_MINMAX, CV_32FC3);
-
-    int skinPixel = 0;
+    return Cr <= 1.5862f*Cb+20.f && Cr >= 0.3448f*Cb+76.2069f && Cr >= -4.5652f*Cb+234.5652f
+        && Cr <= -1.15f*Cb+301.75f && Cr <= -2.2857f*Cb+432.85f;
+}
 
-    for(int i = 0; i < src.rows; i++) {
-        for(int j = 0; j < src.cols; j++) {
+static inline bool SkinPixel(int B, int G, int R)
+{
+    if(!R1(R, G, B))
+        return false;
+
+    int mn = min(R, min(G, B));
+    if(R < G || R < B || 17 * abs(G - B) >= 10 * (R - mn))
+        return false;
+
+    const int rnd = 1 << (skin_yuv_shift - 1);
+    int Y = (R * skin_y_r + G * skin_y_g + B * skin_y_b + rnd) >> skin_yuv_shift;
+    int Cr = saturate_cast<uchar>(((R - Y) * skin_cr + skin_yuv_delta + rnd) >> skin_yuv_shift);
+    int Cb = saturate_cast<uchar>(((B - Y) * skin_cb + skin_yuv_delta + rnd) >> skin_yuv_shift);
+    return R2f(Cr, Cb);
+}
 
-            Vec3b pix_bgr = src.ptr<Vec3b>(i)[j];
-            int B = pix_bgr.val[0];
-            int G = pix_bgr.val[1];
-            int R = pix_bgr.val[2];
-            // apply rgb rule
-            bool a = R1(R,G,B);
+#if CV_SIMD128
+// SkinPixel() on 8 pixels in 16 bit lanes, all ones where skin
+static inline v_int16x8 SkinMask8(const v_int16x8& B, const v_int16x8& G, const v_int16x8& R)
+{
+    const v_int16x8 zero = v_setzero_s16();
+    v_int16x8 mx = v_max(R, v_max(G, B));
+    v_int16x8 mn = v_min(R, v_min(G, B));
+    v_int16x8 rg = R - G, gb = G - B;
+    v_int16x8 arg = v_max(rg, zero - rg);
+    v_int16x8 agb = v_max(gb, zero - gb);
+
+    // RGB rule
+    v_int16x8 e1 = (R > v_setall_s16(95)) & (G > v_setall_s16(40)) & (B > v_setall_s16(20))
+                 & ((mx - mn) > v_setall_s16(15)) & (arg > v_setall_s16(15)) & (R > G) & (R > B);
+    v_int16x8 e2 = (R > v_setall_s16(220)) & (G > v_setall_s16(210)) & (B > v_setall_s16(170))
+                 & (arg <= v_setall_s16(15)) & (R > B) & (G > B);
+    // Hue rule
+    v_int16x8 hue = (R >= G) & (R >= B) & ((agb * v_setall_s16(17)) < ((R - mn) * v_setall_s16(10)));
+
+    // YCrCb, pairs multiplied and added in 32 bits
+    const int rnd = 1 << (skin_yuv_shift - 1);
+    const v_int16x8 one = v_setall_s16(1);
+    const v_int16x8 c_rb(skin_y_r, skin_y_b, skin_y_r, skin_y_b, skin_y_r, skin_y_b, skin_y_r, skin_y_b);
+    const v_int16x8 c_g(skin_y_g, rnd, skin_y_g, rnd, skin_y_g, rnd, skin_y_g, rnd);
+    v_int16x8 rb0, rb1, g0, g1;
+    v_zip(R, B, rb0, rb1);
+    v_zip(G, one, g0, g1);
+    v_int16x8 Y = v_pack(v_shr<skin_yuv_shift>(v_dotprod(rb0, c_rb) + v_dotprod(g0, c_g)),
+                         v_shr<skin_yuv_shift>(v_dotprod(rb1, c_rb) + v_dotprod(g1, c_g)));
+
+    const v_int32x4 delta = v_setall_s32(skin_yuv_delta + rnd);
+    const v_int32x4 lo = v_setzero_s32(), hi = v_setall_s32(255);
+    v_int32x4 cr[2], cb[2];
+    v_mul_expand(R - Y, v_setall_s16(skin_cr), cr[0], cr[1]);
+    v_mul_expand(B - Y, v_setall_s16(skin_cb), cb[0], cb[1]);
+
+    v_int32x4 chroma[2];
+    for(int i = 0; i < 2; i++) {
+        v_float32x4 Cr = v_cvt_f32(v_min(v_max(v_shr<skin_yuv_shift>(cr[i] + delta), lo), hi));
+        v_float32x4 Cb = v_cvt_f32(v_min(v_max(v_shr<skin_yuv_shift>(cb[i] + delta), lo), hi));
+        v_float32x4 m = (Cr <= v_setall_f32(1.5862f) * Cb + v_setall_f32(20.f))
+                      & (Cr >= v_setall_f32(0.3448f) * Cb + v_setall_f32(76.2069f))
+                      & (Cr >= v_setall_f32(-4.5652f) * Cb + v_setall_f32(234.5652f))
+                      & (Cr <= v_setall_f32(-1.15f) * Cb + v_setall_f32(301.75f))
+                      & (Cr <= v_setall_f32(-2.2857f) * Cb + v_setall_f32(432.85f));
+        chroma[i] = v_reinterpret_as_s32(m);
+    }
 
-            Vec3b pix_ycrcb = src_ycrcb.ptr<Vec3b>(i)[j];
-            int Y = pix_ycrcb.val[0];
-            int Cr = pix_ycrcb.val[1];
-            int Cb = pix_ycrcb.val[2];
-            // apply ycrcb rule
-            bool b = R2(Y,Cr,Cb);
+    return (e1 | e2) & hue & v_pack(chroma[0], chroma[1]);
+}
+#endif
 
-            Vec3f pix_hsv = src_hsv.ptr<Vec3f>(i)[j];
-            float H = pix_hsv.val[0];
-            float S = pix_hsv.val[1];
-            float V = pix_hsv.val[2];
-            // apply hsv rule
-            bool c = R3(H,S,V);
+// Share of the pixels of a BGR image passing the skin rules
+float SkinRatio(Mat const &src)
+{
+    CV_Assert(src.type() == CV_8UC3);
 
-            if(a && b && c)
-                skinPixel++;
+    int skinPixel = 0;
+    for(int i = 0; i < src.rows; i++) {
+        const uchar* p = src.ptr<uchar>(i);
+        int j = 0;
+#if CV_SIMD128
+        v_int16x8 count = v_setzero_s16();
+        for(; j <= src.cols - 16; j += 16) {
+            v_uint8x16 b, g, r;
+            v_load_deinterleave(p + j * 3, b, g, r);
+            v_uint16x8 b0, b1, g0, g1, r0, r1;
+            v_expand(b, b0, b1);
+            v_expand(g, g0, g1);
+            v_expand(r, r0, r1);
+            // Masks are -1 where skin
+            count -= SkinMask8(v_reinterpret_as_s16(b0), v_reinterpret_as_s16(g0), v_reinterpret_as_s16(r0));
+            count -= SkinMask8(v_reinterpret_as_s16(b1), v_reinterpret_as_s16(g1), v_reinterpret_as_s16(r1));
         }
+        v_int32x4 c0, c1;
+        v_expand(count, c0, c1);
+        skinPixel += v_reduce_sum(c0 + c1);
+#endif
+        for(; j < src.cols; j++)
+            skinPixel += SkinPixel(p[j * 3], p[j * 3 + 1], p[j * 3 + 2]);
     }
 
-    src_hsv.release();
-    src_ycrcb.release();
+    return src.rows * src.cols > 0 ? (float)skinPixel / (src.rows * src.cols) : 0.f;
+}
 
+bool isSkin(Mat const &src)
+{
     // Ratio threshold for deciding wheter skin or not
-    if(skinPixel >= src.rows * src.cols * skin_proportion_threshold)
-        return true;
-
-    return false;
+    return SkinRatio(src) >= skin_proportion_threshold;
 }
 
 //End of Skin Detection//
 
-static void _detectObjectThread()
+FaceDetector::FaceDetector()
+    : hasPrev(false),
+      hasLast(false),
+      framesSinceScan(0),
+      bStop(false)
 {
-    Mat frame_gray;
-    vector<Rect> tmpfaces;
-    vector<Rect> refinedfaces;
-    while(true) {
-        if(bSigStop) {
-            printf("_detectObjectThread exit\n");
-            break;
-        }
+}
+
+FaceDetector::~FaceDetector()
+{
+    Stop();
+}
+
+static double Overlap(const Rect& a, const Rect& b)
+{
+    double inter = (a & b).area();
+    double uni = a.area() + b.area() - inter;
+    return uni > 0 ? inter / uni : 0;
+}
 
-        if(advFaceDetectThread) {
-            advFaceDetectThread = false;
-            cvtColor(srcImg, frame_gray, COLOR_BGR2GRAY);
-            equalizeHist(frame_gray, frame_gray);
+// Full frame scan, boxes in analysed image coordinates
+void FaceDetector::Scan(const FaceFrame &frame, Mat &frame_gray, vector<Rect> &faces)
+{
+    cvtColor(frame.img, frame_gray, COLOR_BGR2GRAY);
+    equalizeHist(frame_gray, frame_gray);
 
-            tmpfaces.clear();
-            refinedfaces.clear();
-            face_cascade.detectMultiScale(frame_gray, tmpfaces, 1.1, cascade_sensitivity, CV_HAAR_DO_CANNY_PRUNING|CV_HAAR_FIND_BIGGEST_OBJECT|CV_HAAR_SCALE_IMAGE, Size(face_min_size, face_min_size), Size(face_max_size, face_max_size));
+    // Sizes are given for the full frame
+    Size minSize(cvRound(face_min_size * frame.scale), cvRound(face_min_size * frame.scale));
+    Size maxSize(cvRound(face_max_size * frame.scale), cvRound(face_max_size * frame.scale));
+    face_cascade.detectMultiScale(frame_gray, faces, 1.1, cascade_sensitivity, CV_HAAR_DO_CANNY_PRUNING|CV_HAAR_FIND_BIGGEST_OBJECT|CV_HAAR_SCALE_IMAGE, minSize, maxSize);
+}
 
-            for(int i = 0; i < tmpfaces.size(); i++) {
-                Mat rectFace = srcImg(tmpfaces[i]);
+// Look for the face of box around its last position only, at a size close
+// to the last one. The neighbourhood is resampled so that the cost does not
+// depend on the size of the face.
+bool FaceDetector::Track(const Mat &img, Rect &box, Mat &frame_gray)
+{
+    Rect roi(box.x - box.width / 2, box.y - box.height / 2, box.width * 2, box.height * 2);
+    roi &= Rect(0, 0, img.cols, img.rows);
+    if(roi.area() == 0)
+        return false;
+
+    double f = min(1.0, (double)face_track_size / box.width);
+    Mat patch;
+    if(f < 1.0)
+        resize(img(roi), patch, Size(), f, f, INTER_AREA);
+    else
+        patch = img(roi);
+    cvtColor(patch, frame_gray, COLOR_BGR2GRAY);
+    equalizeHist(frame_gray, frame_gray);
+
+    vector<Rect> hits;
+    int size = cvRound(box.width * f);
+    face_cascade.detectMultiScale(frame_gray, hits, 1.1, cascade_sensitivity, CV_HAAR_DO_CANNY_PRUNING|CV_HAAR_FIND_BIGGEST_OBJECT|CV_HAAR_SCALE_IMAGE,
+                                  Size(size * 7 / 10, size * 7 / 10), Size(size * 14 / 10, size * 14 / 10));
+    if(hits.empty())
+        return false;
+
+    const Rect& h = hits[0];
+    box = Rect(roi.x + cvRound(h.x / f), roi.y + cvRound(h.y / f), cvRound(h.width / f), cvRound(h.height / f));
+    return true;
+}
+
+bool FaceDetector::Verify(const Mat &img, const Rect &box)
+{
+    Rect r = box & Rect(0, 0, img.cols, img.rows);
+    if(r.area() == 0)
+        return false;
+
+    // To speed up, resize face samples to smaller one here.
+    Mat scaledRectFace;
+    resize(img(r), scaledRectFace, cv::Size(face_min_size, face_min_size), 0, 0, INTER_NEAREST);
+    return isSkin(scaledRectFace);
+}
 
-                // To speed up, resize face samples to smaller one here.
-                Mat scaledRectFace;
-                resize(rectFace, scaledRectFace, cv::Size(face_min_size, face_min_size), 0, 0, INTER_NEAREST);
-                if(isSkin(scaledRectFace))
-                    refinedfaces.push_back(tmpfaces[i]);
+void FaceDetector::Detect(const FaceFrame &frame, Mat &frame_gray, vector<Rect> &found)
+{
+    if(tracks.empty() || ++framesSinceScan >= face_scan_interval) {
+        framesSinceScan = 0;
+
+        vector<Rect> faces;
+        Scan(frame, frame_gray, faces);
+
+        // Tracks the scan did not find again are checked on the next frames
+        for(size_t k = 0; k < tracks.size(); k++)
+            tracks[k].misses++;
+        for(size_t i = 0; i < faces.size(); i++) {
+            if(!Verify(frame.img, faces[i]))
+                continue;
+            size_t k = 0;
+            while(k < tracks.size() && Overlap(tracks[k].box, faces[i]) <= 0.3)
+                k++;
+            if(k == tracks.size())
+                tracks.push_back(FaceTrack());
+            tracks[k].box = faces[i];
+            tracks[k].misses = 0;
+        }
+    } else {
+        for(size_t k = 0; k < tracks.size(); k++) {
+            Rect box = tracks[k].box;
+            if(Track(frame.img, box, frame_gray) && Verify(frame.img, box)) {
+                tracks[k].box = box;
+                tracks[k].misses = 0;
+            } else {
+                tracks[k].misses++;
             }
+        }
+    }
 
-            //Mat sk = GetSkin(srcImg);
-            //imshow("tt", sk);
-            //waitKey(1);
+    // Forget lost faces, and tracks that converged on the same face
+    for(size_t k = 0; k < tracks.size(); ) {
+        bool duplicate = false;
+        for(size_t j = 0; j < k && !duplicate; j++)
+            duplicate = Overlap(tracks[j].box, tracks[k].box) > 0.5;
+        if(duplicate || tracks[k].misses > face_track_misses)
+            tracks.erase(tracks.begin() + k);
+        else
+            k++;
+    }
 
-            mtxFaceDetect.lock();
-            faces.swap(refinedfaces);
-            mtxFaceDetect.unlock();
+    found.clear();
+    for(size_t k = 0; k < tracks.size(); k++) {
+        if(tracks[k].misses > 0)
+            continue;
+        const Rect& r = tracks[k].box;
+        found.push_back(Rect(cvRound(r.x / frame.scale), cvRound(r.y / frame.scale),
+                             cvRound(r.width / frame.scale), cvRound(r.height / frame.scale)));
+    }
+}
 
-            advFaceDetect = true;
+void FaceDetector::DetectObjectThread()
+{
+    FaceFrame frame;
+    Mat frame_gray;
+    vector<Rect> found;
+    while(true) {
+        {
+            std::unique_lock<std::mutex> lock(mtxWake);
+            condWake.wait(lock, [this] { return bStop || !frames.Empty(); });
+        }
+        if(bStop) {
+            printf("_detectObjectThread exit\n");
+            break;
+        }
+
+        // Only the newest queued frame is worth analysing
+        while(frames.Pop(frame)) {
+        }
+
+        Detect(frame, frame_gray, found);
 
-            std::this_thread::sleep_for(std::chrono::milliseconds(40));
-        } else {
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        // Dropped if the render thread stopped reading results
+        FaceResult *res = results.Back();
+        if(res) {
+            res->pts = frame.pts;
+            res->faces.swap(found);
+            results.Push();
         }
     }
 
     // Release memory
+    frame.img.release();
     frame_gray.release();
-
-    vector<Rect>().swap(refinedfaces);
-    refinedfaces.clear();
-
-    vector<Rect>().swap(tmpfaces);
-    tmpfaces.clear();
+    vector<Rect>().swap(found);
 }
 
-void InitFaceDetection()
+bool FaceDetector::Start()
 {
     if(!face_cascade.load(face_cascade_name)) {
         printf("--(!)Error loading face cascade\n");
-        return;
+        return false;
     };
 
-    std::thread detectObjThread(_detectObjectThread);
-    detectObjThread.detach();
-}
+    frames.Reset();
+    results.Reset();
+    hasPrev = hasLast = false;
+    tracks.clear();
+    framesSinceScan = 0;
 
-void InitFaceDetectionAndGetRef(std::thread& thread) {
-    if(!face_cascade.load(face_cascade_name)) {
-        printf("--(!)Error loading face cascade\n");
-        return;
-    };
+    bStop = false;
+    detectThread = std::thread(&FaceDetector::DetectObjectThread, this);
+    return true;
+}
 
-    thread = std::thread(_detectObjectThread);
+void FaceDetector::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtxWake);
+        bStop = true;
+    }
+    condWake.notify_one();
+    if(detectThread.joinable())
+        detectThread.join();
+
+    frames.Reset();
+    results.Reset();
+    prev = FaceResult();
+    last = FaceResult();
+    hasPrev = hasLast = false;
 }
 
-void RunFaceDetectionIfPossible(Mat &image)
+void FaceDetector::Submit(const Mat &image, int64_t pts)
 {
-    if(advFaceDetect) {
-        advFaceDetect = false;
-        image.convertTo(srcImg, CV_8U);
-        advFaceDetectThread = true;
+    FaceFrame *frame = frames.Back();
+    if(!frame)
+        return;
+
+    frame->pts = pts;
+    frame->scale = 1.0;
+    if(image.cols > face_analysis_width)
+        frame->scale = (double)face_analysis_width / image.cols;
+    if(frame->scale < 1.0)
+        resize(image, frame->img, Size(), frame->scale, frame->scale, INTER_AREA);
+    else
+        image.copyTo(frame->img);
+    frames.Push();
+
+    // Taking the lock orders the push with the worker's check
+    {
+        std::lock_guard<std::mutex> lock(mtxWake);
     }
+    condWake.notify_one();
 }
 
-void GetFaceDetectedResult(vector<Rect> &faceRects)
+void FaceDetector::GetFaces(int64_t pts, vector<Rect> &faceRects)
 {
-    // Copy face vector
-    mtxFaceDetect.lock();
-    faceRects.assign(faces.begin(), faces.end());
-    mtxFaceDetect.unlock();
+    faceRects.clear();
+
+    // Keep the two newest results
+    while(results.Pop(prev)) {
+        std::swap(prev, last);
+        hasPrev = hasLast;
+        hasLast = true;
+    }
+    if(!hasLast)
+        return;
+
+    if(pts < last.pts || pts - last.pts > face_hold_time)
+        return; // results from after a seek back, or too old
+
+    // Results always come after their frame was displayed: move the boxes
+    // found on both of the last two results along their motion, at most
+    // one detection period ahead and by a fraction of their size
+    int64_t period = hasPrev ? last.pts - prev.pts : 0;
+    double t = 0.;
+    if(period > 0)
+        t = (double)std::min(pts - last.pts, period) / period;
+
+    vector<bool> matched(prev.faces.size(), false);
+    for(size_t i = 0; i < last.faces.size(); i++) {
+        const Rect& b = last.faces[i];
+        int best = -1;
+        double bestOverlap = 0.3;
+        for(size_t k = 0; t > 0. && k < prev.faces.size(); k++) {
+            double o = Overlap(prev.faces[k], b);
+            if(!matched[k] && o > bestOverlap) {
+                best = (int)k;
+                bestOverlap = o;
+            }
+        }
+        if(best < 0) {
+            faceRects.push_back(b); // held
+            continue;
+        }
+
+        const Rect& a = prev.faces[best];
+        matched[best] = true;
+        double maxX = b.width * face_extrapolate_max, maxY = b.height * face_extrapolate_max;
+        double dx = std::max(-maxX, std::min(maxX, (b.x - a.x) * t));
+        double dy = std::max(-maxY, std::min(maxY, (b.y - a.y) * t));
+        faceRects.push_back(Rect(cvRound(b.x + dx), cvRound(b.y + dy), b.width, b.height));
+    }
 }
@@ -5,35 +5,107 @@
 #ifdef __MINGW32__
 #include "mingw.thread.h"
 #include "mingw.mutex.h"
+#include "mingw.condition_variable.h"
 #else
 #include <thread>
 #include <mutex>
+#include <condition_variable>
 #endif
+#include <atomic>
+#include <cstdint>
+
+#include "SpscQueue.h"
 
 using namespace std;
 using namespace cv;
 
-// Basic
-static std::mutex mtxFaceDetect;
 static string face_cascade_name = "haarcascade_frontalface_alt2.xml";
-static CascadeClassifier face_cascade;
-
-// Image to extract face from
-static Mat srcImg;
-
-// Dominant rect vertor of faces
-static vector<Rect> faces;
 
 // Detection options
-static bool advFaceDetect = true, advFaceDetectThread = false;
 static float skin_proportion_threshold = 0.3;
 static int cascade_sensitivity = 4;
 static int face_min_size = 20;
 static int face_max_size = 400;
+// Frames are analysed at most this wide
+static int face_analysis_width = 960;
+// Faces stay on screen this long (us) after the frame they were found on
+static int64_t face_hold_time = 500000;
+// Extrapolated boxes move at most this fraction of their size
+static float face_extrapolate_max = 0.5;
+// Analysed frames between two full frame scans, the known faces are only
+// looked for around their last position in between
+static int face_scan_interval = 10;
+// Tracked faces are checked at this width at most
+static int face_track_size = 48;
+// A track is dropped after this many frames without its face
+static int face_track_misses = 2;
+
+// Frame handed to the worker, downscaled, with the pts it was taken at
+struct FaceFrame
+{
+    int64_t pts;
+    double scale; // frame to img
+    Mat img;
+};
+
+// Face followed between full scans, in analysed image coordinates
+struct FaceTrack
+{
+    Rect box;
+    int misses;
+};
+
+// Faces found on the frame of pts, in frame coordinates
+struct FaceResult
+{
+    int64_t pts;
+    vector<Rect> faces;
+};
+
+// Face detection worker of one stitching instance. Frames go to the worker
+// and results come back through lock-free queues, both tagged with the pts
+// of the frame, so that boxes are drawn against the frame they belong to.
+class FaceDetector
+{
+public:
+    FaceDetector();
+    ~FaceDetector();
+
+    bool Start();
+    void Stop();
+    // Render thread: queue the frame of pts for analysis, dropped if the
+    // worker is still busy with the previous ones
+    void Submit(const Mat &image, int64_t pts);
+    // Render thread: faces to draw on the frame of pts, extrapolated from
+    // the last two results (which are always older than the frame)
+    void GetFaces(int64_t pts, vector<Rect> &faceRects);
+
+private:
+    void DetectObjectThread();
+    void Detect(const FaceFrame &frame, Mat &frame_gray, vector<Rect> &found);
+    void Scan(const FaceFrame &frame, Mat &frame_gray, vector<Rect> &faces);
+    bool Track(const Mat &img, Rect &box, Mat &frame_gray);
+    bool Verify(const Mat &img, const Rect &box);
+
+    CascadeClassifier face_cascade;
+
+    SpscQueue<FaceFrame, 3> frames;
+    SpscQueue<FaceResult, 4> results;
+
+    // The worker sleeps until a frame is queued
+    std::mutex mtxWake;
+    std::condition_variable condWake;
+
+    // Last two results, render thread only
+    FaceResult prev, last;
+    bool hasPrev, hasLast;
+
+    // Worker only
+    vector<FaceTrack> tracks;
+    int framesSinceScan;
 
-void InitFaceDetection();
-void InitFaceDetectionAndGetRef(std::thread& thread);
-void RunFaceDetectionIfPossible(Mat &image);
-void GetFaceDetectedResult(vector<Rect> &faceRects);
+    std::atomic<bool> bStop;
+    std::thread detectThread;
+};
 
 #endif // _FACEDETECTION_H_
@@ -11,11 +11,5 @@ using namespace std;
 
 string INPUT_DIR = "./input";
 string OUTPUT_DIR =  "./output";
-int OutWidth = 720;
-int OutHeight = 482;
-int RTSP_SrcWidth = 720;
-int RTSP_SrcHeight = 482;
 int VID_SrcWidth = 1280;
 int VID_SrcHeight = 720;
-
-bool bSigStop = false;
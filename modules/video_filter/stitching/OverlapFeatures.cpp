@@ -0,0 +1,224 @@
+/* Copyright (C) LINKFLOW Co.,Ltd. - All Rights Reserved
+ * Unauthorized copying of this file, via any medium is strictly prohibited
+ * Proprietary and confidential
+ */
+
+#include <algorithm>
+#include <climits>
+#include <limits>
+#include <set>
+
+#include "opencv2/imgproc.hpp"
+#include "opencv2/calib3d.hpp"
+#include "opencv2/core/hal/hal.hpp"
+
+#include "OverlapFeatures.h"
+
+// Same detector setup as OrbFeaturesFinder, for the band only
+static const int orb_features = 750;
+static const float orb_scale_factor = 1.3f;
+static const int orb_levels = 5;
+// Candidates are searched within this fraction of the rows around the
+// query row, or of the width around the predicted position once a
+// homography is known
+static const float match_row_band = 0.08f;
+static const float match_track_radius = 0.04f;
+static const int min_matches = 6;
+
+OverlapFeatures::OverlapFeatures()
+{
+    orb = ORB::create(orb_features, orb_scale_factor, orb_levels);
+}
+
+void OverlapFeatures::Reset()
+{
+    prior.release();
+}
+
+void OverlapFeatures::Find(const Mat img[2], float ratio, vector<ImageFeatures>& features)
+{
+    features.resize(2);
+    for (int i = 0; i < 2; ++i)
+    {
+        if (img[i].channels() == 1)
+            gray[i] = img[i];
+        else
+            cvtColor(img[i], gray[i], COLOR_BGR2GRAY);
+
+        // Overlap band: right side of lens 0, left side of lens 1
+        int band = min(gray[i].cols, cvRound(gray[i].cols * ratio));
+        int x0 = (i == 0) ? gray[i].cols - band : 0;
+        orb->detectAndCompute(gray[i](Rect(x0, 0, band, gray[i].rows)), noArray(), keypoints[i], descriptors[i]);
+        for (size_t k = 0; k < keypoints[i].size(); ++k)
+            keypoints[i][k].pt.x += x0;
+
+        order[i].resize(keypoints[i].size());
+        for (size_t k = 0; k < order[i].size(); ++k)
+            order[i][k] = (int)k;
+        const vector<KeyPoint>& kp = keypoints[i];
+        sort(order[i].begin(), order[i].end(), [&kp](int a, int b) { return kp[a].pt.y < kp[b].pt.y; });
+        rows[i].resize(order[i].size());
+        for (size_t k = 0; k < order[i].size(); ++k)
+            rows[i][k] = kp[order[i][k]].pt.y;
+
+        features[i].img_idx = i;
+        features[i].img_size = img[i].size();
+        features[i].keypoints = keypoints[i];
+        descriptors[i].copyTo(features[i].descriptors);
+    }
+}
+
+// Best and second best lens b match of every lens a keypoint, ratio tested.
+// H maps lens a to lens b in image centred coordinates, or is empty.
+static void MatchOneWay(const vector<KeyPoint>& kp_a, const Mat& desc_a,
+                        const vector<KeyPoint>& kp_b, const Mat& desc_b,
+                        const vector<int>& order_b, const vector<float>& rows_b,
+                        const Mat& H, Size img_size, float conf, vector<DMatch>& out)
+{
+    out.clear();
+    if (desc_a.empty() || desc_b.empty())
+        return;
+
+    const Point2f c(img_size.width * 0.5f, img_size.height * 0.5f);
+    const float row_band = img_size.height * match_row_band;
+    const float radius = img_size.width * match_track_radius;
+    const int len = desc_a.cols;
+
+    vector<Point2f> pred;
+    if (!H.empty())
+    {
+        vector<Point2f> pts(kp_a.size());
+        for (size_t k = 0; k < kp_a.size(); ++k)
+            pts[k] = kp_a[k].pt - c;
+        perspectiveTransform(pts, pred, H);
+    }
+
+    for (int q = 0; q < (int)kp_a.size(); ++q)
+    {
+        float px = 0, py = kp_a[q].pt.y, dy = row_band;
+        if (!pred.empty())
+        {
+            px = pred[q].x + c.x;
+            py = pred[q].y + c.y;
+            dy = radius;
+        }
+
+        size_t k = lower_bound(rows_b.begin(), rows_b.end(), py - dy) - rows_b.begin();
+        size_t k_end = upper_bound(rows_b.begin(), rows_b.end(), py + dy) - rows_b.begin();
+
+        const uchar* d = desc_a.ptr<uchar>(q);
+        int best = INT_MAX, second = INT_MAX, best_idx = -1;
+        for (; k < k_end; ++k)
+        {
+            int t = order_b[k];
+            if (!pred.empty() && std::abs(kp_b[t].pt.x - px) > radius)
+                continue;
+
+            int dist = hal::normHamming(d, desc_b.ptr<uchar>(t), len);
+            if (dist < best)
+            {
+                second = best;
+                best = dist;
+                best_idx = t;
+            }
+            else if (dist < second)
+                second = dist;
+        }
+
+        // A lone candidate passes, it is already constrained by position
+        if (best_idx >= 0 && (second == INT_MAX || best < (1.f - conf) * second))
+            out.push_back(DMatch(q, best_idx, (float)best));
+    }
+}
+
+void OverlapFeatures::Match(const vector<ImageFeatures>& features, vector<MatchesInfo>& pairwise_matches, float conf)
+{
+    pairwise_matches.assign(4, MatchesInfo());
+    MatchesInfo& info = pairwise_matches[1];
+    info.src_img_idx = 0;
+    info.dst_img_idx = 1;
+
+    Size img_size = features[0].img_size;
+    Mat prior_inv;
+    if (!prior.empty())
+        prior_inv = prior.inv();
+
+    // Both directions, merged as BestOf2NearestMatcher does
+    vector<DMatch> fwd, bwd;
+    MatchOneWay(keypoints[0], descriptors[0], keypoints[1], descriptors[1], order[1], rows[1], prior, img_size, conf, fwd);
+    MatchOneWay(keypoints[1], descriptors[1], keypoints[0], descriptors[0], order[0], rows[0], prior_inv, img_size, conf, bwd);
+
+    set<pair<int, int> > matched;
+    for (size_t k = 0; k < fwd.size(); ++k)
+    {
+        info.matches.push_back(fwd[k]);
+        matched.insert(make_pair(fwd[k].queryIdx, fwd[k].trainIdx));
+    }
+    for (size_t k = 0; k < bwd.size(); ++k)
+    {
+        if (!matched.count(make_pair(bwd[k].trainIdx, bwd[k].queryIdx)))
+            info.matches.push_back(DMatch(bwd[k].trainIdx, bwd[k].queryIdx, bwd[k].distance));
+    }
+
+    bool accepted = false;
+    if (info.matches.size() >= (size_t)min_matches)
+    {
+        const Point2f c(img_size.width * 0.5f, img_size.height * 0.5f);
+        Mat src_points(1, (int)info.matches.size(), CV_32FC2);
+        Mat dst_points(1, (int)info.matches.size(), CV_32FC2);
+        for (size_t k = 0; k < info.matches.size(); ++k)
+        {
+            src_points.at<Point2f>(0, (int)k) = keypoints[0][info.matches[k].queryIdx].pt - c;
+            dst_points.at<Point2f>(0, (int)k) = keypoints[1][info.matches[k].trainIdx].pt - c;
+        }
+
+        info.H = findHomography(src_points, dst_points, info.inliers_mask, RANSAC);
+        if (!info.H.empty() && std::abs(determinant(info.H)) >= std::numeric_limits<double>::epsilon())
+        {
+            info.num_inliers = 0;
+            for (size_t k = 0; k < info.inliers_mask.size(); ++k)
+                if (info.inliers_mask[k])
+                    info.num_inliers++;
+
+            // Same confidence as BestOf2NearestMatcher, see Brown & Lowe
+            info.confidence = info.num_inliers / (8 + 0.3 * info.matches.size());
+            info.confidence = info.confidence > 3. ? 0. : info.confidence;
+
+            if (info.num_inliers >= min_matches)
+            {
+                // Refine on the inliers only
+                Mat src_in(1, info.num_inliers, CV_32FC2), dst_in(1, info.num_inliers, CV_32FC2);
+                for (size_t k = 0, n = 0; k < info.matches.size(); ++k)
+                {
+                    if (!info.inliers_mask[k])
+                        continue;
+                    src_in.at<Point2f>(0, (int)n) = src_points.at<Point2f>(0, (int)k);
+                    dst_in.at<Point2f>(0, (int)n) = dst_points.at<Point2f>(0, (int)k);
+                    n++;
+                }
+                info.H = findHomography(src_in, dst_in, RANSAC);
+                accepted = !info.H.empty();
+            }
+        }
+    }
+
+    if (!accepted)
+    {
+        // Widen the search again, the cameras may have moved a lot
+        prior.release();
+        if (info.H.empty())
+            info.num_inliers = 0;
+    }
+    else
+        prior = info.H.clone();
+
+    // Reverse pair, as FeaturesMatcher fills it
+    MatchesInfo& dual = pairwise_matches[2];
+    dual = info;
+    dual.src_img_idx = 1;
+    dual.dst_img_idx = 0;
+    if (!info.H.empty())
+        dual.H = info.H.inv();
+    for (size_t k = 0; k < dual.matches.size(); ++k)
+        std::swap(dual.matches[k].queryIdx, dual.matches[k].trainIdx);
+}
@@ -0,0 +1,43 @@
+#ifndef _OVERLAPFEATURES_H_
+#define _OVERLAPFEATURES_H_
+
+#include "opencv2/features2d.hpp"
+#include "opencv2/stitching/detail/matchers.hpp"
+
+#include <vector>
+
+using namespace std;
+using namespace cv;
+using namespace cv::detail;
+
+// ORB feature pipeline of one lens pair, kept alive between calibrations.
+// Detects only in the overlap bands (lens 0 right side, lens 1 left side)
+// and matches along the rows, around the position predicted by the last
+// accepted homography once there is one.
+class OverlapFeatures
+{
+public:
+    OverlapFeatures();
+
+    // Detect and describe the overlap bands of the two work images. ratio is
+    // the band width relative to the image width (1 = whole image).
+    void Find(const Mat img[2], float ratio, vector<ImageFeatures>& features);
+    // Match features[0] against features[1] into the pairwise layout of
+    // BestOf2NearestMatcher, conf is its match_conf
+    void Match(const vector<ImageFeatures>& features, vector<MatchesInfo>& pairwise_matches, float conf);
+    // Forget the last homography, the next match searches the whole band
+    void Reset();
+
+private:
+    Ptr<ORB> orb;
+    Mat gray[2];
+    vector<KeyPoint> keypoints[2];
+    Mat descriptors[2];
+    // Keypoints of each lens by row, for the candidate search
+    vector<int> order[2];
+    vector<float> rows[2];
+    // Last accepted lens 0 -> 1 homography, image centred coordinates
+    Mat prior;
+};
+
+#endif // _OVERLAPFEATURES_H_
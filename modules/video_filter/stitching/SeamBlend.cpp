@@ -0,0 +1,111 @@
+/* Copyright (C) LINKFLOW Co.,Ltd. - All Rights Reserved
+ * Unauthorized copying of this file, via any medium is strictly prohibited
+ * Proprietary and confidential
+ */
+
+#include "opencv2/imgproc.hpp"
+#include "opencv2/core/hal/intrin.hpp"
+
+#include "SeamBlend.h"
+
+// dst = src * gain, gain in Q8 and dst in Q3
+static void ApplyGain(const Mat& src, const Mat& gain, Mat& dst)
+{
+    const int shift = SEAM_MASK_BITS - SEAM_FRAC_BITS;
+
+    dst.create(src.size(), CV_16S);
+    for (int y = 0; y < src.rows; ++y)
+    {
+        const uchar* s = src.ptr<uchar>(y);
+        const ushort* g = gain.ptr<ushort>(y);
+        short* d = dst.ptr<short>(y);
+
+        int x = 0;
+#if CV_SIMD128
+        for (; x <= src.cols - 8; x += 8)
+        {
+            v_uint32x4 lo, hi;
+            v_mul_expand(v_load_expand(s + x), v_load(g + x), lo, hi);
+            v_store(d + x, v_reinterpret_as_s16(v_pack(lo >> shift, hi >> shift)));
+        }
+#endif
+        for (; x < src.cols; ++x)
+            d[x] = saturate_cast<short>((s[x] * g[x]) >> shift);
+    }
+}
+
+// dst = a * m + b * (1 - m), m in Q8. dst may be a.
+static void BlendLevel(const Mat& a, const Mat& b, const Mat& mask, Mat& dst)
+{
+    const int one = 1 << SEAM_MASK_BITS;
+    const int half = one >> 1;
+
+    dst.create(a.size(), CV_16S);
+    for (int y = 0; y < a.rows; ++y)
+    {
+        const short* pa = a.ptr<short>(y);
+        const short* pb = b.ptr<short>(y);
+        const short* pm = mask.ptr<short>(y);
+        short* pd = dst.ptr<short>(y);
+
+        int x = 0;
+#if CV_SIMD128
+        const v_int16x8 v_one = v_setall_s16((short)one);
+        const v_int32x4 v_half = v_setall_s32(half);
+        for (; x <= a.cols - 8; x += 8)
+        {
+            // Interleave (a, b) and (m, 1 - m), one dot product per pixel
+            v_int16x8 ab_lo, ab_hi, m_lo, m_hi;
+            v_int16x8 m = v_load(pm + x);
+            v_zip(v_load(pa + x), v_load(pb + x), ab_lo, ab_hi);
+            v_zip(m, v_one - m, m_lo, m_hi);
+            v_int32x4 lo = (v_dotprod(ab_lo, m_lo) + v_half) >> SEAM_MASK_BITS;
+            v_int32x4 hi = (v_dotprod(ab_hi, m_hi) + v_half) >> SEAM_MASK_BITS;
+            v_store(pd + x, v_pack(lo, hi));
+        }
+#endif
+        for (; x < a.cols; ++x)
+            pd[x] = saturate_cast<short>((pa[x] * pm[x] + pb[x] * (one - pm[x]) + half) >> SEAM_MASK_BITS);
+    }
+}
+
+void BuildSeamMaskPyramid(const Mat& share, int bands, vector<Mat>& pyr)
+{
+    pyr.resize(bands + 1);
+    share.convertTo(pyr[0], CV_16S, (double)(1 << SEAM_MASK_BITS) / 255);
+    for (int l = 0; l < bands; ++l)
+        pyrDown(pyr[l], pyr[l + 1]);
+}
+
+void BlendSeamPlanes(const Mat& src0, const Mat& src1, const Mat gains[2], const vector<Mat>& mask_pyr, Mat& dst)
+{
+    const int bands = (int)mask_pyr.size() - 1;
+    const Mat* src[2] = {&src0, &src1};
+
+    // Laplacian pyramid of each lens, the top level stays Gaussian
+    vector<Mat> lap[2];
+    Mat up;
+    for (int k = 0; k < 2; ++k)
+    {
+        lap[k].resize(bands + 1);
+        ApplyGain(*src[k], gains[k], lap[k][0]);
+        for (int l = 0; l < bands; ++l)
+        {
+            pyrDown(lap[k][l], lap[k][l + 1]);
+            pyrUp(lap[k][l + 1], up, lap[k][l].size());
+            subtract(lap[k][l], up, lap[k][l]);
+        }
+    }
+
+    for (int l = 0; l <= bands; ++l)
+        BlendLevel(lap[0][l], lap[1][l], mask_pyr[l], lap[0][l]);
+
+    // Collapse
+    Mat result = lap[0][bands];
+    for (int l = bands - 1; l >= 0; --l)
+    {
+        pyrUp(result, up, lap[0][l].size());
+        add(up, lap[0][l], result);
+    }
+    result.convertTo(dst, CV_8U, 1.0 / (1 << SEAM_FRAC_BITS));
+}
@@ -0,0 +1,25 @@
+#ifndef _SEAMBLEND_H_
+#define _SEAMBLEND_H_
+
+#include "opencv2/core.hpp"
+
+#include <vector>
+
+using namespace std;
+using namespace cv;
+
+// Fixed point formats of the seam strip blender
+enum {
+    SEAM_FRAC_BITS = 3, // pyramid levels, CV_16S
+    SEAM_MASK_BITS = 8  // lens shares and exposure gains
+};
+
+// Gaussian pyramid of the lens 0 share (CV_8U, 0 or 255), bands + 1 levels
+void BuildSeamMaskPyramid(const Mat& share, int bands, vector<Mat>& pyr);
+
+// Multi-band blend of two single channel 8-bit strips. gains[] are the
+// exposure gains of each strip (CV_16U), mask_pyr comes from
+// BuildSeamMaskPyramid().
+void BlendSeamPlanes(const Mat& src0, const Mat& src1, const Mat gains[2], const vector<Mat>& mask_pyr, Mat& dst);
+
+#endif // _SEAMBLEND_H_
@@ -0,0 +1,65 @@
+#ifndef _SPSCQUEUE_H_
+#define _SPSCQUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// Bounded lock-free queue between exactly one producer thread and one
+// consumer thread. Items are swapped in and out of the ring, so buffers
+// (cv::Mat, vectors) go back and forth without being reallocated.
+// One slot always stays free to tell a full ring from an empty one.
+template <typename T, size_t N>
+class SpscQueue
+{
+public:
+    SpscQueue() : head(0), tail(0) {}
+
+    // Producer: slot to fill before Push(), NULL if the queue is full
+    T* Back()
+    {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if ((t + 1) % N == head.load(std::memory_order_acquire))
+            return NULL;
+        return &ring[t];
+    }
+    // Producer: publish the slot returned by Back()
+    void Push()
+    {
+        size_t t = tail.load(std::memory_order_relaxed);
+        tail.store((t + 1) % N, std::memory_order_release);
+    }
+
+    // Consumer: swap the oldest item into item, false if empty
+    bool Pop(T& item)
+    {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire))
+            return false;
+        std::swap(item, ring[h]);
+        head.store((h + 1) % N, std::memory_order_release);
+        return true;
+    }
+    bool Empty() const
+    {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+    // Only while neither side runs
+    void Reset()
+    {
+        for (size_t i = 0; i < N; ++i)
+            ring[i] = T();
+        head.store(0);
+        tail.store(0);
+    }
+
+private:
+    static_assert(N >= 2, "one slot is always free");
+
+    T ring[N];
+    std::atomic<size_t> head; // next item to pop, written by the consumer
+    std::atomic<size_t> tail; // next slot to fill, written by the producer
+};
+
+#endif // _SPSCQUEUE_H_
@@ -9,6 +9,8 @@
 */
 
 #include <iostream> 
+#include <functional>
+#include <climits>
 
 #include "opencv2/stitching/detail/matchers.hpp"
 #include "opencv2/stitching/detail/seam_finders.hpp"
@@ -16,6 +18,7 @@
 
 #include "LFSecurity.h"
 #include "StitchCore.h"
+#include "SeamBlend.h"
 
 #if ENABLE_CALC_LOG == 1
 #define LOGC(msg) cout<<msg<<endl;
@@ -33,25 +36,196 @@ using namespace std;
 using namespace cv;
 using namespace cv::detail;
 
-bool applyROItoFeatureDetection = true;
-string features_type = "orb";
+static Ptr<WarperCreator> CreateWarperCreator()
+{
+    Ptr<WarperCreator> warper_creator;
+    if (warp_type == "plane")
+        warper_creator = makePtr<cv::PlaneWarper>();
+    else if (warp_type == "cylindrical")
+        warper_creator = makePtr<cv::CylindricalWarper>();
+    else if (warp_type == "spherical")
+        warper_creator = makePtr<cv::SphericalWarper>();
+    else if (warp_type == "fisheye")
+        warper_creator = makePtr<cv::FisheyeWarper>();
+    else if (warp_type == "stereographic")
+        warper_creator = makePtr<cv::StereographicWarper>();
+    else if (warp_type == "compressedPlaneA2B1")
+        warper_creator = makePtr<cv::CompressedRectilinearWarper>(2.0f, 1.0f);
+    else if (warp_type == "compressedPlaneA1.5B1")
+        warper_creator = makePtr<cv::CompressedRectilinearWarper>(1.5f, 1.0f);
+    else if (warp_type == "compressedPlanePortraitA2B1")
+        warper_creator = makePtr<cv::CompressedRectilinearPortraitWarper>(2.0f, 1.0f);
+    else if (warp_type == "compressedPlanePortraitA1.5B1")
+        warper_creator = makePtr<cv::CompressedRectilinearPortraitWarper>(1.5f, 1.0f);
+    else if (warp_type == "paniniA2B1")
+        warper_creator = makePtr<cv::PaniniWarper>(2.0f, 1.0f);
+    else if (warp_type == "paniniA1.5B1")
+        warper_creator = makePtr<cv::PaniniWarper>(1.5f, 1.0f);
+    else if (warp_type == "paniniPortraitA2B1")
+        warper_creator = makePtr<cv::PaniniPortraitWarper>(2.0f, 1.0f);
+    else if (warp_type == "paniniPortraitA1.5B1")
+        warper_creator = makePtr<cv::PaniniPortraitWarper>(1.5f, 1.0f);
+    else if (warp_type == "mercator")
+        warper_creator = makePtr<cv::MercatorWarper>();
+    else if (warp_type == "transverseMercator")
+        warper_creator = makePtr<cv::TransverseMercatorWarper>();
+
+    return warper_creator;
+}
+
+static Ptr<SeamFinder> CreateSeamFinder()
+{
+    Ptr<SeamFinder> seam_finder;
+    if (seam_find_type == "no")
+        seam_finder = makePtr<detail::NoSeamFinder>();
+    else if (seam_find_type == "voronoi")
+        seam_finder = makePtr<detail::VoronoiSeamFinder>();
+    else if (seam_find_type == "gc_color")
+    {
+            seam_finder = makePtr<detail::GraphCutSeamFinder>(GraphCutSeamFinderBase::COST_COLOR);
+    }
+    else if (seam_find_type == "gc_colorgrad")
+    {
+            seam_finder = makePtr<detail::GraphCutSeamFinder>(GraphCutSeamFinderBase::COST_COLOR_GRAD);
+    }
+    else if (seam_find_type == "dp_color")
+        seam_finder = makePtr<detail::DpSeamFinder>(DpSeamFinder::COLOR);
+    else if (seam_find_type == "dp_colorgrad")
+        seam_finder = makePtr<detail::DpSeamFinder>(DpSeamFinder::COLOR_GRAD);
+
+    return seam_finder;
+}
+
+StitchCore::StitchCore()
+    : features_type("orb"),
+      applyROItoFeatureDetection(true),
+      profiler(NULL),
+      outWidth(0),
+      outHeight(0)
+{
+    for(int seq = 0; seq < CAMDIR_END; seq++) {
+        calcParam[seq].num_images = 0;
+        calcParam[seq].map.baked = false;
+        generation[seq] = 0;
+        renderState[seq].generation = 0;
+        renderState[seq].cropPending = false;
+        renderState[seq].validBox = Rect(-1, -1, -1, -1);
+        renderState[seq].seam_residual_ref = -1;
+    }
+}
+
+StitchCore::~StitchCore()
+{
+    DeallocAllParam(FRONT);
+    DeallocAllParam(REAR);
+}
+
+void StitchCore::SetOutputSize(int width, int height)
+{
+    outWidth = width;
+    outHeight = height;
+}
 
-void InitParam(camDir_t seq, int num_image_in_each_seq)
+static void ReleaseRenderMap(stRenderMap& map)
+{
+    map.baked = false;
+    map.src_size = Size();
+    map.compose_scale = 1;
+    map.pano_size = Size();
+    map.pano_size_c = Size();
+
+    vector<Point>().swap(map.corners);
+    vector<Mat>().swap(map.xymaps);
+    vector<Mat>().swap(map.fracmaps);
+    vector<Mat>().swap(map.weights);
+    vector<Point>().swap(map.corners_c);
+    vector<Mat>().swap(map.xymaps_c);
+    vector<Mat>().swap(map.fracmaps_c);
+    vector<Mat>().swap(map.weights_c);
+    vector<Point2f>().swap(map.probe[0]);
+    vector<Point2f>().swap(map.probe[1]);
+    map.crop_box = Rect();
+    vector<Mat>().swap(map.seam_masks);
+    vector<Mat>().swap(map.gain_maps);
+
+    stSeamStrip* strips[2] = {&map.seam, &map.seam_c};
+    for (int i = 0; i < 2; ++i)
+    {
+        strips[i]->roi = Rect();
+        vector<Mat>().swap(strips[i]->mask_pyr);
+        strips[i]->cover.release();
+        strips[i]->gains[0].release();
+        strips[i]->gains[1].release();
+    }
+}
+
+// Bake the seam strip of one plane size: lens 0 share pyramid, coverage
+// and exposure gains over roi. Left empty if the strip is too small.
+static void BakeSeamStrip(stSeamStrip& strip, Rect roi, int bands, const vector<Point>& corners, const vector<Mat>& weights, const vector<Mat>& gains)
+{
+    // Keep at least 4 pixels on the top level
+    int min_side = min(roi.width, roi.height);
+    while (bands > 0 && (min_side >> bands) < 4)
+        bands--;
+    if (bands <= 0)
+        return;
+
+    Mat feather[2];
+    for (int k = 0; k < 2; ++k)
+    {
+        Rect lens(corners[k], weights[k].size());
+        Rect r = lens & roi;
+        Rect src_r = r - corners[k], dst_r = r - roi.tl();
+
+        feather[k] = Mat::zeros(roi.size(), CV_32F);
+        divide(weights[k](src_r), gains[k](src_r), feather[k](dst_r));
+
+        Mat gain(roi.size(), CV_32F, Scalar::all(1));
+        gains[k](src_r).copyTo(gain(dst_r));
+        gain.convertTo(strip.gains[k], CV_16U, 1 << SEAM_MASK_BITS);
+    }
+
+    strip.roi = roi;
+    strip.cover = (feather[0] > 0) | (feather[1] > 0);
+    BuildSeamMaskPyramid(feather[0] >= feather[1], bands, strip.mask_pyr);
+}
+
+// Sample the overlap of both lenses on a sparse grid: pano pixels where
+// both lenses contribute, stored as source positions in each lens.
+static void BuildSeamProbe(stRenderMap& map, const vector<Mat>& xmaps, const vector<Mat>& ymaps)
+{
+    Rect r0(map.corners[0], map.weights[0].size());
+    Rect r1(map.corners[1], map.weights[1].size());
+    Rect overlap = r0 & r1;
+    float scale = 1.f / (float)map.compose_scale;
+
+    for (int y = overlap.y; y < overlap.y + overlap.height; y += seam_probe_step)
+    {
+        for (int x = overlap.x; x < overlap.x + overlap.width; x += seam_probe_step)
+        {
+            Point p0(x - r0.x, y - r0.y), p1(x - r1.x, y - r1.y);
+            if (map.weights[0].at<float>(p0) < 0.05f || map.weights[1].at<float>(p1) < 0.05f)
+                continue;
+
+            map.probe[0].push_back(Point2f(xmaps[0].at<float>(p0), ymaps[0].at<float>(p0)) * scale);
+            map.probe[1].push_back(Point2f(xmaps[1].at<float>(p1), ymaps[1].at<float>(p1)) * scale);
+        }
+    }
+}
+
+void StitchCore::InitParam(camDir_t seq, int num_image_in_each_seq)
 {
     calcParam[seq].num_images = num_image_in_each_seq;
-    renderParam[seq].num_images = num_image_in_each_seq;
 
-    renderParam[seq].updated = false;
     calcParam[seq].work_scale = 1;
-    renderParam[seq].work_scale = 1;
     calcParam[seq].seam_scale = 1;
-    renderParam[seq].seam_scale = 1;
     calcParam[seq].compose_scale = 1;
-    renderParam[seq].compose_scale = 1;
     calcParam[seq].seam_work_aspect = 1;
-    renderParam[seq].seam_work_aspect = 1;
 
-    renderParam[seq].validBox = Rect(-1 ,-1, -1, -1);
+    ReleaseRenderMap(calcParam[seq].map);
+
+    // Nothing to render until the first calculation is published
+    PublishParam(seq, std::shared_ptr<const stRenderParam>());
 
     calcParam[seq].cameras.clear();
     calcParam[seq].indices.clear();
@@ -61,13 +235,16 @@ void InitParam(camDir_t seq, int num_image_in_each_seq)
     calcParam[seq].images.clear();
 }
 
-void ResetParam(camDir_t seq)
+void StitchCore::ResetParam(camDir_t seq)
 {
     calcParam[seq].work_scale = 1;
     calcParam[seq].seam_scale = 1;
     calcParam[seq].compose_scale = 1;
     calcParam[seq].seam_work_aspect = 1;
 
+    ReleaseRenderMap(calcParam[seq].map);
+    overlap[seq].Reset();
+
     calcParam[seq].cameras.clear();
     calcParam[seq].indices.clear();
     for(int i = 0; i < calcParam[seq].images.size(); i++) {
@@ -76,28 +253,35 @@ void ResetParam(camDir_t seq)
     calcParam[seq].images.clear();
 }
 
-void UpdateParam(camDir_t seq)
+void StitchCore::PublishParam(camDir_t seq, std::shared_ptr<const stRenderParam> param)
 {
-    for(int i = 0; i < renderParam[seq].images.size(); i++)
-        renderParam[seq].images[i].release();
-
-    renderParam[seq].updated = true;
-    renderParam[seq].work_scale = calcParam[seq].work_scale;
-    renderParam[seq].seam_scale = calcParam[seq].seam_scale;
-    renderParam[seq].compose_scale = calcParam[seq].compose_scale;
-    renderParam[seq].seam_work_aspect = calcParam[seq].seam_work_aspect;
-    renderParam[seq].warped_image_scale = calcParam[seq].warped_image_scale;
+    // The snapshot replaced here is released on the next publication
+    retiredParam[seq] = std::atomic_exchange(&renderParam[seq], param);
+}
 
-    renderParam[seq].cameras.swap(calcParam[seq].cameras);
-    renderParam[seq].indices.swap(calcParam[seq].indices);
-    renderParam[seq].images.swap(calcParam[seq].images);
+void StitchCore::UpdateParam(camDir_t seq)
+{
+    std::shared_ptr<stRenderParam> param = std::make_shared<stRenderParam>();
+
+    param->generation = ++generation[seq];
+    param->num_images = calcParam[seq].num_images;
+    param->work_scale = calcParam[seq].work_scale;
+    param->seam_scale = calcParam[seq].seam_scale;
+    param->compose_scale = calcParam[seq].compose_scale;
+    param->seam_work_aspect = calcParam[seq].seam_work_aspect;
+    param->warped_image_scale = calcParam[seq].warped_image_scale;
+
+    param->cameras.swap(calcParam[seq].cameras);
+    param->indices.swap(calcParam[seq].indices);
+    param->images.swap(calcParam[seq].images);
+    std::swap(param->map, calcParam[seq].map);
+    ReleaseRenderMap(calcParam[seq].map);
+
+    PublishParam(seq, param);
 }
 
-void DeallocAllParam(camDir_t seq)
+void StitchCore::DeallocAllParam(camDir_t seq)
 {
-	for(int i = 0; i < renderParam[seq].images.size(); i++) {
-        renderParam[seq].images[i].release();
-	}
 	for(int i = 0; i < calcParam[seq].images.size(); i++) {
         calcParam[seq].images[i].release();
     }
@@ -106,16 +290,33 @@ void DeallocAllParam(camDir_t seq)
 	vector<CameraParams>().swap(calcParam[seq].cameras);
 	vector<int>().swap(calcParam[seq].indices);
 
-	vector<Mat>().swap(renderParam[seq].images);
-	vector<CameraParams>().swap(renderParam[seq].cameras);
-	vector<int>().swap(renderParam[seq].indices);
+	ReleaseRenderMap(calcParam[seq].map);
+
+	PublishParam(seq, std::shared_ptr<const stRenderParam>());
+	retiredParam[seq].reset();
+}
+
+std::shared_ptr<const stRenderParam> StitchCore::AcquireRenderParam(camDir_t seq)
+{
+    std::shared_ptr<const stRenderParam> param = std::atomic_load(&renderParam[seq]);
+    if(param && param->generation != renderState[seq].generation) {
+        // New snapshot: take its crop box if it has one, otherwise the box
+        // is measured on the first frame. Drift reference is measured again.
+        renderState[seq].generation = param->generation;
+        renderState[seq].cropPending = param->map.crop_box.area() <= 0;
+        renderState[seq].validBox = param->map.crop_box;
+        renderState[seq].seam_residual_ref = -1;
+    }
+
+    return param;
 }
 
-int CalcCameraParam(camDir_t seq, Mat srcImg[])
+int StitchCore::CalcCameraParam(camDir_t seq, Mat srcImg[])
 {
 #if ENABLE_CALC_LOG
     int64 app_start_time = getTickCount();
 #endif
+    StageClock clock(profiler);
 
     LOGC("Finding features...");
 #if ENABLE_CALC_LOG
@@ -124,6 +325,9 @@ int CalcCameraParam(camDir_t seq, Mat srcImg[])
 
     bool is_work_scale_set = false, is_seam_scale_set = false;
 
+    // ORB pairs go through the persistent overlap pipeline
+    bool useOverlap = (features_type == "orb" && calcParam[seq].num_images == 2);
+
     Ptr<FeaturesFinder> finder;
     if (features_type == "surf")
     {
@@ -132,7 +336,8 @@ int CalcCameraParam(camDir_t seq, Mat srcImg[])
     // ORB사용시, OPENCV matcher에서 BFMatcher 및 NORM_HAMMING을 사용하도록 수정하여야 한다.
     else if (features_type == "orb")
     {
-        finder = makePtr<OrbFeaturesFinder>();
+        if (!useOverlap)
+            finder = makePtr<OrbFeaturesFinder>();
     }
     else
     {
@@ -141,6 +346,7 @@ int CalcCameraParam(camDir_t seq, Mat srcImg[])
     }
 
     Mat full_img, img;
+    Mat work_img[2];
     vector<ImageFeatures> features(calcParam[seq].num_images);
     calcParam[seq].images.resize(calcParam[seq].num_images);
     vector<Size> full_img_sizes(calcParam[seq].num_images);
@@ -183,7 +389,10 @@ int CalcCameraParam(camDir_t seq, Mat srcImg[])
             is_seam_scale_set = true;
         }
 
-        if(applyROItoFeatureDetection) {
+        if(useOverlap) {
+            // Detected below, once both lenses are at work scale
+            work_img[i] = img.clone();
+        } else if(applyROItoFeatureDetection) {
             Mat partImg;
             if(i == 0) {
                 partImg = img(cv::Rect(img.cols * (1.0 - ratioROI), 0, img.cols * ratioROI, img.rows));
@@ -204,17 +413,23 @@ int CalcCameraParam(camDir_t seq, Mat srcImg[])
             features[i].img_idx = i;
         }
 
-        LOGC("Features in image #" << i+1 << ": " << features[i].keypoints.size());
-
         resize(full_img, img, Size(), calcParam[seq].seam_scale, calcParam[seq].seam_scale);
         calcParam[seq].images[i] = img;
     }
 
-    finder->collectGarbage();
+    if(useOverlap) {
+        overlap[seq].Find(work_img, applyROItoFeatureDetection ? ratioROI : 1.f, features);
+    } else {
+        finder->collectGarbage();
+    }
+    for (int i = 0; i < calcParam[seq].num_images; ++i)
+        LOGC("Features in image #" << i+1 << ": " << features[i].keypoints.size());
+
     full_img.release();
     img.release();
 
     LOGC("[#] Finding features, time: " << ((getTickCount() - t) / getTickFrequency()) << " sec");
+    clock.Lap(STAGE_FEATURES);
 
     // If features are not detected enoughly, decide calculation fails.
     for (int i = 0; i < calcParam[seq].num_images; ++i) {
@@ -229,9 +444,13 @@ int CalcCameraParam(camDir_t seq, Mat srcImg[])
     t = getTickCount();
 #endif
     vector<MatchesInfo> pairwise_matches;
-    BestOf2NearestMatcher matcher(try_cuda, match_conf);
-    matcher(features, pairwise_matches);
-    matcher.collectGarbage();
+    if(useOverlap) {
+        overlap[seq].Match(features, pairwise_matches, match_conf);
+    } else {
+        BestOf2NearestMatcher matcher(try_cuda, match_conf);
+        matcher(features, pairwise_matches);
+        matcher.collectGarbage();
+    }
 
     // Prevent abnormal pairwise matching result. sometimes "pairwise matching count == all feature count" happens
     if(pairwise_matches[1].num_inliers < 6 || pairwise_matches[1].matches.size() >= features[0].keypoints.size() || pairwise_matches[1].matches.size() >= features[1].keypoints.size()) {
@@ -242,6 +461,7 @@ int CalcCameraParam(camDir_t seq, Mat srcImg[])
 
     LOGC("Pairwise matched: " << pairwise_matches[0].matches.size() << " / " << pairwise_matches[1].matches.size());
     LOGC("[#] Pairwise matching, time: " << ((getTickCount() - t) / getTickFrequency()) << " sec");
+    clock.Lap(STAGE_MATCH);
 
 #if ENABLE_CALC_LOG
         t = getTickCount();
@@ -293,6 +513,7 @@ int CalcCameraParam(camDir_t seq, Mat srcImg[])
     }
 
     LOGC("[#] Bundle adjustment, time: " << ((getTickCount() - t) / getTickFrequency()) << " sec");
+    clock.Lap(STAGE_BUNDLE);
 
     // Find median focal length
     vector<double> focals;
@@ -323,8 +544,604 @@ int CalcCameraParam(camDir_t seq, Mat srcImg[])
     return 0;
 }
 
-int Render(camDir_t seq, Mat srcImg[], Mat destImg)
+// Bake remap tables, seam masks, blend weights and exposure gains for the
+// cameras in calcParam[seq], so that rendering becomes a single remap and
+// weighted sum per lens. srcImg[] are the full size lens images.
+int StitchCore::BakeRenderMap(camDir_t seq, Mat srcImg[])
+{
+    stCalcParam& param = calcParam[seq];
+    ReleaseRenderMap(param.map);
+    StageClock clock(profiler);
+
+    if((int)param.cameras.size() != param.num_images || (int)param.images.size() != param.num_images)
+        return -1;
+
+    Ptr<WarperCreator> warper_creator = CreateWarperCreator();
+    if (!warper_creator)
+    {
+        cout << "[ERR] Can't create the following warper '" << warp_type << "'\n";
+        return -1;
+    }
+
+    Ptr<SeamFinder> seam_finder = CreateSeamFinder();
+    if (!seam_finder)
+    {
+        cout << "[ERR] Can't create the following seam finder '" << seam_find_type << "'\n";
+        return -1;
+    }
+
+    // Find seams and exposure gains at seam scale, as Render() does
+    vector<Point> corners(param.num_images);
+    vector<UMat> masks_warped(param.num_images);
+    vector<UMat> images_warped(param.num_images);
+    vector<UMat> images_warped_f(param.num_images);
+
+    Ptr<RotationWarper> warper = warper_creator->create(static_cast<float>(param.warped_image_scale * param.seam_work_aspect));
+    for (int i = 0; i < param.num_images; ++i)
+    {
+        Mat_<float> K;
+        param.cameras[i].K().convertTo(K, CV_32F);
+        float swa = (float)param.seam_work_aspect;
+        K(0,0) *= swa; K(0,2) *= swa;
+        K(1,1) *= swa; K(1,2) *= swa;
+
+        UMat mask(param.images[i].size(), CV_8U, Scalar::all(255));
+        corners[i] = warper->warp(param.images[i], K, param.cameras[i].R, INTER_LINEAR, BORDER_REFLECT, images_warped[i]);
+        warper->warp(mask, K, param.cameras[i].R, INTER_NEAREST, BORDER_CONSTANT, masks_warped[i]);
+        images_warped[i].convertTo(images_warped_f[i], CV_32F);
+    }
+
+    Ptr<ExposureCompensator> compensator = ExposureCompensator::createDefault(expos_comp_type);
+    compensator->feed(corners, images_warped, masks_warped);
+    seam_finder->find(images_warped_f, corners, masks_warped);
+
+    images_warped.clear();
+    images_warped_f.clear();
+
+    // Probe the compensator with a flat image to get its gain map
+    vector<Mat> seam_masks(param.num_images), gain_maps(param.num_images);
+    for (int i = 0; i < param.num_images; ++i)
+    {
+        masks_warped[i].copyTo(seam_masks[i]);
+        Mat probe(seam_masks[i].size(), CV_8UC3, Scalar::all(128));
+        compensator->apply(i, corners[i], probe, seam_masks[i]);
+        extractChannel(probe, gain_maps[i], 0);
+        gain_maps[i].convertTo(gain_maps[i], CV_32F, 1.0 / 128);
+    }
+    masks_warped.clear();
+
+    int ret = BuildRenderMap(seq, srcImg[0].size(), seam_masks, gain_maps);
+    clock.Lap(STAGE_BAKE);
+    return ret;
+}
+
+// Second half of BakeRenderMap(): full resolution tables from the seam masks
+// and gain maps found at seam scale. Also used for cached calibrations.
+int StitchCore::BuildRenderMap(camDir_t seq, Size src_size, const vector<Mat>& seam_masks, const vector<Mat>& gain_maps, Rect crop_box)
+{
+#if ENABLE_CALC_LOG
+    int64 t = getTickCount();
+#endif
+
+    stCalcParam& param = calcParam[seq];
+    stRenderMap& map = param.map;
+    ReleaseRenderMap(map);
+
+    if((int)param.cameras.size() != param.num_images || (int)seam_masks.size() != param.num_images || (int)gain_maps.size() != param.num_images)
+        return -1;
+
+    Ptr<WarperCreator> warper_creator = CreateWarperCreator();
+    if (!warper_creator)
+    {
+        cout << "[ERR] Can't create the following warper '" << warp_type << "'\n";
+        return -1;
+    }
+
+    // Build the full resolution tables
+    double compose_scale = 1;
+    if (compose_megapix > 0)
+        compose_scale = min(1.0, sqrt(compose_megapix * 1e6 / src_size.area()));
+    double compose_work_aspect = compose_scale / param.work_scale;
+
+    Ptr<RotationWarper> warper = warper_creator->create(param.warped_image_scale * static_cast<float>(compose_work_aspect));
+
+    vector<Point> corners(param.num_images);
+    vector<Mat> xmaps(param.num_images), ymaps(param.num_images);
+    vector<Mat> gains(param.num_images);
+    vector<UMat> blend_masks(param.num_images);
+    vector<Size> sizes(param.num_images);
+    for (int i = 0; i < param.num_images; ++i)
+    {
+        // Scale a copy of the intrinsics. Cameras are kept at work scale.
+        CameraParams camera = param.cameras[i];
+        camera.focal *= compose_work_aspect;
+        camera.ppx *= compose_work_aspect;
+        camera.ppy *= compose_work_aspect;
+
+        Size sz = src_size;
+        if (std::abs(compose_scale - 1) > 1e-1)
+        {
+            sz.width = cvRound(sz.width * compose_scale);
+            sz.height = cvRound(sz.height * compose_scale);
+        }
+
+        Mat K;
+        camera.K().convertTo(K, CV_32F);
+        Rect roi = warper->buildMaps(sz, K, camera.R, xmaps[i], ymaps[i]);
+        corners[i] = roi.tl();
+        sizes[i] = xmaps[i].size();
+
+        // Lens coverage restricted by the seam
+        Mat mask(sz, CV_8U, Scalar::all(255)), mask_warped, dilated_mask, seam_mask;
+        remap(mask, mask_warped, xmaps[i], ymaps[i], INTER_NEAREST, BORDER_CONSTANT);
+        dilate(seam_masks[i], dilated_mask, Mat());
+        resize(dilated_mask, seam_mask, mask_warped.size());
+        bitwise_and(seam_mask, mask_warped, blend_masks[i]);
+
+        resize(gain_maps[i], gains[i], mask_warped.size(), 0, 0, INTER_LINEAR);
+    }
+
+    // Feather weights normalised over the panorama
+    Size dst_sz = resultRoi(corners, sizes).size();
+    float blend_width = sqrt(static_cast<float>(dst_sz.area())) * blend_strength / 100.f;
+    FeatherBlender feather(blend_width < 1.f ? 1.f : 1.f / blend_width);
+    vector<UMat> weight_maps;
+    Rect dst_roi = feather.createWeightMaps(blend_masks, corners, weight_maps);
+
+    map.corners.resize(param.num_images);
+    map.xymaps.resize(param.num_images);
+    map.fracmaps.resize(param.num_images);
+    map.weights.resize(param.num_images);
+    map.corners_c.resize(param.num_images);
+    map.xymaps_c.resize(param.num_images);
+    map.fracmaps_c.resize(param.num_images);
+    map.weights_c.resize(param.num_images);
+
+    vector<Mat> gains_c(param.num_images);
+    Size pano_size(0, 0);
+    for (int i = 0; i < param.num_images; ++i)
+    {
+        Mat weight;
+        multiply(weight_maps[i], gains[i], weight, 1, CV_32F);
+
+        // Align each lens on even panorama coordinates, so that a 4:2:0
+        // chroma sample always covers the same luma pixel pair.
+        Point corner = corners[i] - dst_roi.tl();
+        int left = corner.x & 1, top = corner.y & 1;
+        int right = (left + weight.cols) & 1, bottom = (top + weight.rows) & 1;
+        copyMakeBorder(xmaps[i], xmaps[i], top, bottom, left, right, BORDER_REPLICATE);
+        copyMakeBorder(ymaps[i], ymaps[i], top, bottom, left, right, BORDER_REPLICATE);
+        copyMakeBorder(weight, weight, top, bottom, left, right, BORDER_CONSTANT, Scalar::all(0));
+        copyMakeBorder(gains[i], gains[i], top, bottom, left, right, BORDER_REPLICATE);
+        corner -= Point(left, top);
+
+        map.corners[i] = corner;
+        map.weights[i] = weight;
+        convertMaps(xmaps[i], ymaps[i], map.xymaps[i], map.fracmaps[i], CV_16SC2);
+
+        // Chroma sample centres sit between two luma samples
+        Mat xmap_c, ymap_c;
+        resize(xmaps[i], xmap_c, Size(), 0.5, 0.5, INTER_AREA);
+        resize(ymaps[i], ymap_c, Size(), 0.5, 0.5, INTER_AREA);
+        xmap_c.convertTo(xmap_c, CV_32F, 0.5, -0.25);
+        ymap_c.convertTo(ymap_c, CV_32F, 0.5, -0.25);
+        convertMaps(xmap_c, ymap_c, map.xymaps_c[i], map.fracmaps_c[i], CV_16SC2);
+        resize(weight, map.weights_c[i], Size(), 0.5, 0.5, INTER_AREA);
+        resize(gains[i], gains_c[i], Size(), 0.5, 0.5, INTER_AREA);
+        map.corners_c[i] = Point(corner.x / 2, corner.y / 2);
+
+        pano_size.width = max(pano_size.width, corner.x + weight.cols);
+        pano_size.height = max(pano_size.height, corner.y + weight.rows);
+    }
+
+    map.src_size = src_size;
+    map.compose_scale = compose_scale;
+    map.pano_size = pano_size;
+    map.pano_size_c = Size(pano_size.width / 2, pano_size.height / 2);
+
+    // Crop box of the covered panorama, so the render loop does not have to
+    // measure it on the first frame
+    map.crop_box = crop_box;
+    if (doCrop && crop_box.area() <= 0)
+    {
+        Mat1b cover(pano_size, uchar(0));
+        for (int i = 0; i < param.num_images; ++i)
+        {
+            Mat lens_cover = cover(Rect(map.corners[i], map.weights[i].size()));
+            bitwise_or(lens_cover, map.weights[i] > 0, lens_cover);
+        }
+        map.crop_box = findCropBox(cover);
+    }
+
+    if (seamMultiBand && param.num_images == 2 && blend_width >= 1.f)
+    {
+        // Only the strip where both lenses overlap goes through the pyramid
+        Rect overlap = Rect(map.corners[0], map.weights[0].size()) & Rect(map.corners[1], map.weights[1].size());
+        int bands = static_cast<int>(ceil(log(blend_width)/log(2.)) - 1.);
+        if (overlap.width > 0)
+        {
+            BakeSeamStrip(map.seam, Rect(overlap.x, 0, overlap.width, pano_size.height), bands,
+                          map.corners, map.weights, gains);
+            BakeSeamStrip(map.seam_c, Rect(overlap.x / 2, 0, overlap.width / 2, map.pano_size_c.height), max(bands - 1, 1),
+                          map.corners_c, map.weights_c, gains_c);
+        }
+    }
+
+    if (param.num_images == 2)
+        BuildSeamProbe(map, xmaps, ymaps);
+
+    // Kept for the calibration cache
+    map.seam_masks = seam_masks;
+    map.gain_maps = gain_maps;
+    map.baked = true;
+
+    LOGC("[#] Render map baking, time: " << ((getTickCount() - t) / getTickFrequency()) << " sec");
+
+    return 0;
+}
+
+// Crop and scale the stitched result into its half of the output frame
+int StitchCore::IntegrateResult(camDir_t seq, Mat& result, Mat srcImg[], Mat destImg)
+{
+    Point ptImgL, ptImgR;
+	switch (seq)
+	{
+	case FRONT:
+		ptImgL = Point(0, 0);
+		ptImgR = Point(outWidth/2, 0);
+		break;
+	case REAR:
+		ptImgL = Point(0, outHeight/2);
+		ptImgR = Point(outWidth/2, outHeight/2);
+		break;
+	default:
+		LOGR("[ERR] Unexpected ERROR. Wierd image sequence");
+		return -1;
+	}
+
+	if(!result.empty()) {
+		if(doCrop) {
+			Mat viewport;
+			result.convertTo(result, CV_8UC3);
+			if(crop2InsideBox(seq, result, viewport)) {
+				resize(viewport, viewport, cv::Size(outWidth, outHeight/2), 0, 0, CV_INTER_LINEAR);
+				viewport.copyTo(destImg(cv::Rect(ptImgL, Size(viewport.cols, viewport.rows))));
+				//rectangle(gray, box, rectColor(255, 0, 0), 2);
+			} else {
+				// Fall back: If cannot obtain unique rectangle blob, displays separate screen
+				resize(srcImg[0], srcImg[0], cv::Size(outWidth/2, outHeight/2), 0, 0, CV_INTER_LINEAR);
+				srcImg[0].copyTo(destImg(cv::Rect(ptImgL ,Size(srcImg[0].cols, srcImg[0].rows))));
+				resize(srcImg[1], srcImg[1], cv::Size(outWidth/2, outHeight/2), 0, 0, CV_INTER_LINEAR);
+				srcImg[1].copyTo(destImg(cv::Rect(ptImgR, Size(srcImg[1].cols, srcImg[1].rows))));
+			}
+			viewport.release();
+		} else {
+			resize(result, result, cv::Size(outWidth, outHeight/2), 0, 0, CV_INTER_LINEAR);
+			result.copyTo(destImg(cv::Rect(ptImgL ,Size(result.cols, result.rows))));
+		}
+	} else {
+		//Error case
+		LOGR("[ERR] Unexpected ERROR. Cannot render this frame");
+	}
+
+	return 0;
+}
+
+// pano(corner + p) += src(p) * weight(p), for any channel count
+static void AccumulateWeighted(const Mat& src, const Mat& weight, Point corner, Mat& pano)
+{
+    const int cn = src.channels();
+    for (int y = 0; y < src.rows; ++y)
+    {
+        const uchar* src_row = src.ptr<uchar>(y);
+        const float* weight_row = weight.ptr<float>(y);
+        float* dst_row = pano.ptr<float>(corner.y + y) + corner.x * cn;
+        for (int x = 0; x < src.cols; ++x)
+        {
+            float w = weight_row[x];
+            if (w == 0.f)
+                continue;
+            for (int c = 0; c < cn; ++c)
+                dst_row[cn*x + c] += src_row[cn*x + c] * w;
+        }
+    }
+}
+
+// Run body on the OpenCV thread pool, or inline if parallelRender is off.
+// Nested parallel_for_ calls run inline, so callers spread the whole frame
+// over one loop rather than nesting per direction and per lens.
+static void RunParallel(const Range& range, const std::function<void(const Range&)>& body)
+{
+    if (parallelRender)
+        parallel_for_(range, body);
+    else
+        body(range);
+}
+
+// Warp the rows of each lens that fall into one band of the panorama and
+// blend them there. Tables are row aligned with the panorama, so a band
+// only reads its own slice of them.
+static void BlendTile(const stBakedJob& job, int plane, const Range& rows)
+{
+    const stRenderMap& map = job.param->map;
+    bool chroma = plane > 0;
+    const vector<Point>& corners = chroma ? map.corners_c : map.corners;
+    const vector<Mat>& xymaps = chroma ? map.xymaps_c : map.xymaps;
+    const vector<Mat>& fracmaps = chroma ? map.fracmaps_c : map.fracmaps;
+    const vector<Mat>& weights = chroma ? map.weights_c : map.weights;
+
+    // Columns of the seam strip are left to BlendSeamStrip()
+    const stSeamStrip& strip = chroma ? map.seam_c : map.seam;
+    int strip_start = INT_MAX, strip_end = INT_MAX;
+    if (!strip.mask_pyr.empty()) {
+        strip_start = strip.roi.x;
+        strip_end = strip.roi.x + strip.roi.width;
+    }
+
+    Mat pano = job.pano[plane].rowRange(rows);
+    Mat acc(pano.size(), CV_32FC(pano.channels()), Scalar::all(0));
+    Mat warped;
+    for (int img_idx = 0; img_idx < job.param->num_images; ++img_idx)
+    {
+        int top = max(rows.start, corners[img_idx].y);
+        int bottom = min(rows.end, corners[img_idx].y + weights[img_idx].rows);
+        if (top >= bottom)
+            continue;
+
+        int left = corners[img_idx].x, right = corners[img_idx].x + weights[img_idx].cols;
+        Range spans[2] = {Range(left, min(right, strip_start)), Range(max(left, strip_end), right)};
+        for (int s = 0; s < 2; ++s)
+        {
+            if (spans[s].start >= spans[s].end)
+                continue;
+
+            Rect lens_rect(spans[s].start - corners[img_idx].x, top - corners[img_idx].y, spans[s].size(), bottom - top);
+            remap(job.src[plane][img_idx], warped, xymaps[img_idx](lens_rect), fracmaps[img_idx](lens_rect), INTER_LINEAR, BORDER_REFLECT);
+            AccumulateWeighted(warped, weights[img_idx](lens_rect), Point(spans[s].start, top - rows.start), acc);
+        }
+    }
+    acc.convertTo(pano, pano.type());
+}
+
+// Multi-band blend of the seam strip of one panorama plane. Each lens is
+// warped over the strip only, beyond its own tables the border is repeated.
+static void BlendSeamStrip(const stBakedJob& job, int plane)
+{
+    const stRenderMap& map = job.param->map;
+    bool chroma = plane > 0;
+    const stSeamStrip& strip = chroma ? map.seam_c : map.seam;
+    if (strip.mask_pyr.empty())
+        return;
+
+    const vector<Point>& corners = chroma ? map.corners_c : map.corners;
+    const vector<Mat>& xymaps = chroma ? map.xymaps_c : map.xymaps;
+    const vector<Mat>& fracmaps = chroma ? map.fracmaps_c : map.fracmaps;
+
+    const Rect& roi = strip.roi;
+    Mat warped[2];
+    for (int k = 0; k < 2; ++k)
+    {
+        Rect r = Rect(corners[k], xymaps[k].size()) & roi;
+        Mat part;
+        remap(job.src[plane][k], part, xymaps[k](r - corners[k]), fracmaps[k](r - corners[k]), INTER_LINEAR, BORDER_REFLECT);
+        copyMakeBorder(part, warped[k], r.y - roi.y, roi.br().y - r.br().y, r.x - roi.x, roi.br().x - r.br().x, BORDER_REPLICATE);
+    }
+
+    Mat blended;
+    if (warped[0].channels() == 1) {
+        BlendSeamPlanes(warped[0], warped[1], strip.gains, strip.mask_pyr, blended);
+    } else {
+        // Packed BGR, one pyramid per channel
+        vector<Mat> ch0, ch1, out(warped[0].channels());
+        split(warped[0], ch0);
+        split(warped[1], ch1);
+        for (size_t c = 0; c < out.size(); ++c)
+            BlendSeamPlanes(ch0[c], ch1[c], strip.gains, strip.mask_pyr, out[c]);
+        merge(out, blended);
+    }
+
+    Mat dst = job.pano[plane](roi);
+    dst.setTo(Scalar::all(0));
+    blended.copyTo(dst, strip.cover);
+}
+
+// Blend every plane of every job in one parallel loop over bands of rows
+static void BlendBakedJobs(vector<stBakedJob>& jobs)
+{
+    vector<stRenderTile> tiles;
+    for (int j = 0; j < (int)jobs.size(); ++j)
+    {
+        for (int plane = 0; plane < jobs[j].planes; ++plane)
+        {
+            int rows = jobs[j].pano[plane].rows;
+            for (int y = 0; y < rows; y += render_tile_rows)
+            {
+                stRenderTile tile;
+                tile.job = j;
+                tile.plane = plane;
+                tile.rows = Range(y, min(y + render_tile_rows, rows));
+                tiles.push_back(tile);
+            }
+        }
+    }
+
+    RunParallel(Range(0, (int)tiles.size()), [&](const Range& r) {
+        for (int i = r.start; i < r.end; ++i)
+            BlendTile(jobs[tiles[i].job], tiles[i].plane, tiles[i].rows);
+    });
+
+    // Seam strips need the whole strip height, one task per plane
+    vector<stRenderTile> strips;
+    for (int j = 0; j < (int)jobs.size(); ++j)
+    {
+        for (int plane = 0; plane < jobs[j].planes; ++plane)
+        {
+            stRenderTile strip;
+            strip.job = j;
+            strip.plane = plane;
+            strip.rows = Range(0, jobs[j].pano[plane].rows);
+            strips.push_back(strip);
+        }
+    }
+
+    RunParallel(Range(0, (int)strips.size()), [&](const Range& r) {
+        for (int i = r.start; i < r.end; ++i)
+            BlendSeamStrip(jobs[strips[i].job], strips[i].plane);
+    });
+}
+
+// Static calibration render path: false if seq has no baked tables for
+// this input, job.param is still set if there are parameters at all.
+bool StitchCore::PrepareBakedJob(camDir_t seq, Mat src[][3], int planes, stBakedJob& job)
+{
+    job.seq = seq;
+    job.param = AcquireRenderParam(seq);
+    if (!job.param)
+        return false;
+
+    const stRenderMap& map = job.param->map;
+    if (!precomputeRenderMap || !map.baked || map.src_size != src[0][0].size())
+        return false;
+
+    job.planes = planes;
+    for (int plane = 0; plane < planes; ++plane)
+    {
+        job.pano[plane].create(plane > 0 ? map.pano_size_c : map.pano_size, src[0][plane].type());
+        job.src[plane].resize(job.param->num_images);
+        for (int img_idx = 0; img_idx < job.param->num_images; ++img_idx)
+        {
+            if (std::abs(map.compose_scale - 1) > 1e-1)
+                resize(src[img_idx][plane], job.src[plane][img_idx], Size(), map.compose_scale, map.compose_scale);
+            else
+                job.src[plane][img_idx] = src[img_idx][plane];
+        }
+    }
+
+    return true;
+}
+
+// Crop and scale the stitched 4:2:0 planes into their half of destPlanes[]
+int StitchCore::IntegratePlanes(camDir_t seq, Mat pano[], Mat srcPlanes[][3], Mat destPlanes[])
+{
+    // Destination half of each plane
+    Mat dest[3];
+    int dest_y = (seq == FRONT) ? 0 : outHeight/2;
+    dest[0] = destPlanes[0](Rect(0, dest_y, outWidth, outHeight/2));
+    dest[1] = destPlanes[1](Rect(0, dest_y/2, outWidth/2, outHeight/4));
+    dest[2] = destPlanes[2](Rect(0, dest_y/2, outWidth/2, outHeight/4));
+
+    Mat viewport;
+    if(!doCrop) {
+        for (int plane = 0; plane < 3; ++plane)
+            resize(pano[plane], dest[plane], dest[plane].size(), 0, 0, INTER_LINEAR);
+    } else if(crop2InsideBox(seq, pano[0], viewport)) {
+        const Rect& box = renderState[seq].validBox;
+        Rect box_c(box.x / 2, box.y / 2, max(box.width / 2, 1), max(box.height / 2, 1));
+        resize(viewport, dest[0], dest[0].size(), 0, 0, INTER_LINEAR);
+        resize(pano[1](box_c), dest[1], dest[1].size(), 0, 0, INTER_LINEAR);
+        resize(pano[2](box_c), dest[2], dest[2].size(), 0, 0, INTER_LINEAR);
+    } else {
+        // Fall back: If cannot obtain unique rectangle blob, displays separate screen
+        for (int plane = 0; plane < 3; ++plane) {
+            int half = dest[plane].cols / 2;
+            Mat left = dest[plane](Rect(0, 0, half, dest[plane].rows));
+            Mat right = dest[plane](Rect(half, 0, dest[plane].cols - half, dest[plane].rows));
+            resize(srcPlanes[0][plane], left, left.size(), 0, 0, INTER_LINEAR);
+            resize(srcPlanes[1][plane], right, right.size(), 0, 0, INTER_LINEAR);
+        }
+    }
+    viewport.release();
+
+    return 1;
+}
+
+void StitchCore::RenderFrame(Mat srcImg[], Mat destImg, int ret[])
 {
+#if ENABLE_RENDER_LOG
+    int64 t = getTickCount();
+#endif
+
+    StageClock clock(profiler);
+    vector<stBakedJob> jobs;
+    for (int seq = FRONT; seq < CAMDIR_END; ++seq)
+    {
+        Mat lens[2][3] = {{srcImg[seq * 2]}, {srcImg[seq * 2 + 1]}};
+        stBakedJob job;
+        if (PrepareBakedJob((camDir_t)seq, lens, 1, job)) {
+            jobs.push_back(job);
+            ret[seq] = 1;
+        } else {
+            // No tables (yet), warp and blend this direction on the fly
+            ret[seq] = Render((camDir_t)seq, &srcImg[seq * 2], destImg);
+            clock.Skip();
+        }
+    }
+    if (jobs.empty())
+        return;
+    BlendBakedJobs(jobs);
+
+    LOGR("[#] Baked compositing, time: " << ((getTickCount() - t) / getTickFrequency()) << " sec");
+    clock.Lap(STAGE_BLEND);
+
+    for (size_t j = 0; j < jobs.size(); ++j)
+    {
+        if (IntegrateResult(jobs[j].seq, jobs[j].pano[0], &srcImg[jobs[j].seq * 2], destImg) < 0)
+            ret[jobs[j].seq] = -1;
+    }
+    clock.Lap(STAGE_CROP);
+}
+
+void StitchCore::RenderFramePlanes(Mat srcPlanes[][3], Mat destPlanes[], int ret[])
+{
+#if ENABLE_RENDER_LOG
+    int64 t = getTickCount();
+#endif
+
+    StageClock clock(profiler);
+    vector<stBakedJob> jobs;
+    for (int seq = FRONT; seq < CAMDIR_END; ++seq)
+    {
+        stBakedJob job;
+        if (PrepareBakedJob((camDir_t)seq, &srcPlanes[seq * 2], 3, job)) {
+            jobs.push_back(job);
+            ret[seq] = 1;
+        } else {
+            ret[seq] = -1;
+        }
+    }
+    if (jobs.empty())
+        return;
+    BlendBakedJobs(jobs);
+
+    LOGR("[#] Baked planar compositing, time: " << ((getTickCount() - t) / getTickFrequency()) << " sec");
+    clock.Lap(STAGE_BLEND);
+
+    for (size_t j = 0; j < jobs.size(); ++j)
+        ret[jobs[j].seq] = IntegratePlanes(jobs[j].seq, jobs[j].pano, &srcPlanes[jobs[j].seq * 2], destPlanes);
+    clock.Lap(STAGE_CROP);
+}
+
+int StitchCore::Render(camDir_t seq, Mat srcImg[], Mat destImg)
+{
+    StageClock clock(profiler);
+    Mat lens[2][3] = {{srcImg[0]}, {srcImg[1]}};
+    vector<stBakedJob> jobs(1);
+    if(PrepareBakedJob(seq, lens, 1, jobs[0])) {
+        BlendBakedJobs(jobs);
+        clock.Lap(STAGE_BLEND);
+        int ret = IntegrateResult(seq, jobs[0].pano[0], srcImg, destImg) < 0 ? -1 : 1;
+        clock.Lap(STAGE_CROP);
+        return ret;
+    }
+
+    std::shared_ptr<const stRenderParam> param = jobs[0].param;
+    if(!param)
+        return -1;
+    const stRenderParam& p = *param;
+    // Cached calibrations come without seam scale images
+    if((int)p.images.size() != p.num_images)
+        return -1;
+
 #if ENABLE_RENDER_LOG
     int64 app_start_time = getTickCount();
 #endif
@@ -334,54 +1151,22 @@ int Render(camDir_t seq, Mat srcImg[], Mat destImg)
     int64 t = getTickCount();
 #endif
 
-    vector<Point> corners(renderParam[seq].num_images);
-    vector<UMat> masks_warped(renderParam[seq].num_images);
-    vector<UMat> images_warped(renderParam[seq].num_images);
-    vector<Size> sizes(renderParam[seq].num_images);
-    vector<UMat> masks(renderParam[seq].num_images);
+    vector<Point> corners(p.num_images);
+    vector<UMat> masks_warped(p.num_images);
+    vector<UMat> images_warped(p.num_images);
+    vector<Size> sizes(p.num_images);
+    vector<UMat> masks(p.num_images);
 
     // Preapre images masks
-    for (int i = 0; i < renderParam[seq].num_images; ++i)
+    for (int i = 0; i < p.num_images; ++i)
     {
-        masks[i].create(renderParam[seq].images[i].size(), CV_8U);
+        masks[i].create(p.images[i].size(), CV_8U);
         masks[i].setTo(Scalar::all(255));
     }
 
     // Warp images and their masks
 
-    Ptr<WarperCreator> warper_creator;
-    {
-        if (warp_type == "plane")
-            warper_creator = makePtr<cv::PlaneWarper>();
-        else if (warp_type == "cylindrical")
-            warper_creator = makePtr<cv::CylindricalWarper>();
-        else if (warp_type == "spherical")
-            warper_creator = makePtr<cv::SphericalWarper>();
-        else if (warp_type == "fisheye")
-            warper_creator = makePtr<cv::FisheyeWarper>();
-        else if (warp_type == "stereographic")
-            warper_creator = makePtr<cv::StereographicWarper>();
-        else if (warp_type == "compressedPlaneA2B1")
-            warper_creator = makePtr<cv::CompressedRectilinearWarper>(2.0f, 1.0f);
-        else if (warp_type == "compressedPlaneA1.5B1")
-            warper_creator = makePtr<cv::CompressedRectilinearWarper>(1.5f, 1.0f);
-        else if (warp_type == "compressedPlanePortraitA2B1")
-            warper_creator = makePtr<cv::CompressedRectilinearPortraitWarper>(2.0f, 1.0f);
-        else if (warp_type == "compressedPlanePortraitA1.5B1")
-            warper_creator = makePtr<cv::CompressedRectilinearPortraitWarper>(1.5f, 1.0f);
-        else if (warp_type == "paniniA2B1")
-            warper_creator = makePtr<cv::PaniniWarper>(2.0f, 1.0f);
-        else if (warp_type == "paniniA1.5B1")
-            warper_creator = makePtr<cv::PaniniWarper>(1.5f, 1.0f);
-        else if (warp_type == "paniniPortraitA2B1")
-            warper_creator = makePtr<cv::PaniniPortraitWarper>(2.0f, 1.0f);
-        else if (warp_type == "paniniPortraitA1.5B1")
-            warper_creator = makePtr<cv::PaniniPortraitWarper>(1.5f, 1.0f);
-        else if (warp_type == "mercator")
-            warper_creator = makePtr<cv::MercatorWarper>();
-        else if (warp_type == "transverseMercator")
-            warper_creator = makePtr<cv::TransverseMercatorWarper>();
-    }
+    Ptr<WarperCreator> warper_creator = CreateWarperCreator();
 
     if (!warper_creator)
     {
@@ -393,28 +1178,31 @@ int Render(camDir_t seq, Mat srcImg[], Mat destImg)
         return 0;
     }
 
-    Ptr<RotationWarper> warper = warper_creator->create(static_cast<float>(renderParam[seq].warped_image_scale * renderParam[seq].seam_work_aspect));
-
-    for (int i = 0; i < renderParam[seq].num_images; ++i)
-    {
-        Mat_<float> K;
-        renderParam[seq].cameras[i].K().convertTo(K, CV_32F);
-        float swa = (float)renderParam[seq].seam_work_aspect;
-        K(0,0) *= swa; K(0,2) *= swa;
-        K(1,1) *= swa; K(1,2) *= swa;
+    // Warpers keep per-call state, each lens task gets its own
+    RunParallel(Range(0, p.num_images), [&](const Range& r) {
+        Ptr<RotationWarper> warper = warper_creator->create(static_cast<float>(p.warped_image_scale * p.seam_work_aspect));
+        for (int i = r.start; i < r.end; ++i)
+        {
+            Mat_<float> K;
+            p.cameras[i].K().convertTo(K, CV_32F);
+            float swa = (float)p.seam_work_aspect;
+            K(0,0) *= swa; K(0,2) *= swa;
+            K(1,1) *= swa; K(1,2) *= swa;
 
-        corners[i] = warper->warp(renderParam[seq].images[i], K, renderParam[seq].cameras[i].R, INTER_LINEAR, BORDER_REFLECT, images_warped[i]);
-        sizes[i] = images_warped[i].size();
+            corners[i] = warper->warp(p.images[i], K, p.cameras[i].R, INTER_LINEAR, BORDER_REFLECT, images_warped[i]);
+            sizes[i] = images_warped[i].size();
 
-        warper->warp(masks[i], K, renderParam[seq].cameras[i].R, INTER_NEAREST, BORDER_CONSTANT, masks_warped[i]);
-        K.release();
-    }
+            warper->warp(masks[i], K, p.cameras[i].R, INTER_NEAREST, BORDER_CONSTANT, masks_warped[i]);
+            K.release();
+        }
+    });
 
-    vector<UMat> images_warped_f(renderParam[seq].num_images);
-    for (int i = 0; i < renderParam[seq].num_images; ++i)
+    vector<UMat> images_warped_f(p.num_images);
+    for (int i = 0; i < p.num_images; ++i)
         images_warped[i].convertTo(images_warped_f[i], CV_32F);
 
     LOGR("[#] Warping images, time: " << ((getTickCount() - t) / getTickFrequency()) << " sec");
+    clock.Lap(STAGE_WARP);
 
     LOGR("Exposure Compensating...");
 #if ENABLE_RENDER_LOG
@@ -425,29 +1213,14 @@ int Render(camDir_t seq, Mat srcImg[], Mat destImg)
     compensator->feed(corners, images_warped, masks_warped);
 
     LOGR("[#] Exposure compensation, time: " << ((getTickCount() - t) / getTickFrequency()) << " sec");
+    clock.Lap(STAGE_EXPOSURE);
 
     LOGR("Seam Finding...");
 #if ENABLE_RENDER_LOG
     t = getTickCount();
 #endif
 
-    Ptr<SeamFinder> seam_finder;
-    if (seam_find_type == "no")
-        seam_finder = makePtr<detail::NoSeamFinder>();
-    else if (seam_find_type == "voronoi")
-        seam_finder = makePtr<detail::VoronoiSeamFinder>();
-    else if (seam_find_type == "gc_color")
-    {
-            seam_finder = makePtr<detail::GraphCutSeamFinder>(GraphCutSeamFinderBase::COST_COLOR);
-    }
-    else if (seam_find_type == "gc_colorgrad")
-    {
-            seam_finder = makePtr<detail::GraphCutSeamFinder>(GraphCutSeamFinderBase::COST_COLOR_GRAD);
-    }
-    else if (seam_find_type == "dp_color")
-        seam_finder = makePtr<detail::DpSeamFinder>(DpSeamFinder::COLOR);
-    else if (seam_find_type == "dp_colorgrad")
-        seam_finder = makePtr<detail::DpSeamFinder>(DpSeamFinder::COLOR_GRAD);
+    Ptr<SeamFinder> seam_finder = CreateSeamFinder();
     if (!seam_finder)
     {
         cout << "[ERR] Can't create the following seam finder '" << seam_find_type << "'\n";
@@ -467,178 +1240,135 @@ int Render(camDir_t seq, Mat srcImg[], Mat destImg)
     masks.clear();
 
     LOGR("[#] Seam finding, time: " << ((getTickCount() - t) / getTickFrequency()) << " sec");
+    clock.Lap(STAGE_SEAM);
 
     LOGR("Compositing...");
 #if ENABLE_RENDER_LOG
     t = getTickCount();
 #endif
 
-    Mat img_warped, img_warped_s;
-    Mat dilated_mask, seam_mask, mask, mask_warped;
     Ptr<Blender> blender;
     //double compose_seam_aspect = 1;
     double compose_work_aspect = 1;
-    bool is_compose_scale_set = false;
-    vector<Size> full_img_sizes(renderParam[seq].num_images);
-    Mat full_img, img;
-    for (int i = 0; i < renderParam[seq].num_images; ++i)
-        full_img_sizes[i] = srcImg[i].size();
-
-    for (int img_idx = 0; img_idx < renderParam[seq].num_images; ++img_idx)
+    // Cameras are scaled on a copy, the published parameters are read-only
+    vector<CameraParams> cameras(p.cameras);
+    double compose_scale = p.compose_scale;
+    if (compose_megapix > 0)
+        compose_scale = min(1.0, sqrt(compose_megapix * 1e6 / srcImg[0].size().area()));
+
+    // Compute relative scales
+    //compose_seam_aspect = compose_scale / seam_scale;
+    compose_work_aspect = compose_scale / p.work_scale;
+
+    // Update warped image scale
+    float temp_warped_image_scale = p.warped_image_scale * static_cast<float>(compose_work_aspect);
+    Ptr<RotationWarper> warper = warper_creator->create(temp_warped_image_scale);
+
+    // Update corners and sizes
+    for (int i = 0; i < p.num_images; ++i)
     {
-        LOGR("Compositing image #" << renderParam[seq].indices[img_idx]+1);
-
-        // Read image and resize it if necessary
-        full_img = srcImg[img_idx];
-
-        if (!is_compose_scale_set)
+        // Update intrinsics
+        cameras[i].focal *= compose_work_aspect;
+        cameras[i].ppx *= compose_work_aspect;
+        cameras[i].ppy *= compose_work_aspect;
+
+        // Update corner and size
+        Size sz = srcImg[i].size();
+        if (std::abs(compose_scale - 1) > 1e-1)
         {
-            if (compose_megapix > 0)
-                renderParam[seq].compose_scale = min(1.0, sqrt(compose_megapix * 1e6 / full_img.size().area()));
-            is_compose_scale_set = true;
-
-            // Compute relative scales
-            //compose_seam_aspect = compose_scale / seam_scale;
-            compose_work_aspect = renderParam[seq].compose_scale / renderParam[seq].work_scale;
-
-            // Update warped image scale
-            float temp_warped_image_scale = renderParam[seq].warped_image_scale * static_cast<float>(compose_work_aspect);
-            //renderParam[seq].warped_image_scale *= static_cast<float>(compose_work_aspect);
-            warper = warper_creator->create(temp_warped_image_scale);
+            sz.width = cvRound(srcImg[i].cols * compose_scale);
+            sz.height = cvRound(srcImg[i].rows * compose_scale);
+        }
 
-            // Update corners and sizes
-            for (int i = 0; i < renderParam[seq].num_images; ++i)
-            {
-                // Update intrinsics
-                renderParam[seq].cameras[i].focal *= compose_work_aspect;
-                renderParam[seq].cameras[i].ppx *= compose_work_aspect;
-                renderParam[seq].cameras[i].ppy *= compose_work_aspect;
-
-                // TEMP: 한번 focal, ppx, ppy를 셋업하고 난 후에는 캐쉬의 compose_scale과 work_scale을 1.0으로 셋업하여 중첩스케일링이 되지 않도록 한다
-                renderParam[seq].compose_scale = 1.0;
-                renderParam[seq].work_scale = 1.0;
-
-                // Update corner and size
-                Size sz = full_img_sizes[i];
-                if (std::abs(renderParam[seq].compose_scale - 1) > 1e-1)
-                {
-                    sz.width = cvRound(full_img_sizes[i].width * renderParam[seq].compose_scale);
-                    sz.height = cvRound(full_img_sizes[i].height * renderParam[seq].compose_scale);
-                }
+        Mat K;
+        cameras[i].K().convertTo(K, CV_32F);
+        Rect roi = warper->warpRoi(sz, K, cameras[i].R);
+        corners[i] = roi.tl();
+        sizes[i] = roi.size();
 
-                Mat K;
-                renderParam[seq].cameras[i].K().convertTo(K, CV_32F);
-                Rect roi = warper->warpRoi(sz, K, renderParam[seq].cameras[i].R);
-                corners[i] = roi.tl();
-                sizes[i] = roi.size();
+        K.release();
+    }
 
-                K.release();
-            }
-        }
-        if (abs(renderParam[seq].compose_scale - 1) > 1e-1)
-            resize(full_img, img, Size(), renderParam[seq].compose_scale, renderParam[seq].compose_scale);
-        else
-            img = full_img;
-        full_img.release();
-        Size img_size = img.size();
+    // Warp, compensate and convert the lenses concurrently, the blender
+    // is fed serially afterwards
+    vector<Mat> images_warped_s(p.num_images);
+    vector<Mat> masks_blend(p.num_images);
+    RunParallel(Range(0, p.num_images), [&](const Range& r) {
+        Ptr<RotationWarper> lens_warper = warper_creator->create(temp_warped_image_scale);
+        Mat img, img_warped, mask, mask_warped, dilated_mask, seam_mask;
+        for (int img_idx = r.start; img_idx < r.end; ++img_idx)
+        {
+            LOGR("Compositing image #" << p.indices[img_idx]+1);
 
-        Mat K;
-        renderParam[seq].cameras[img_idx].K().convertTo(K, CV_32F);
+            // Read image and resize it if necessary
+            if (abs(compose_scale - 1) > 1e-1)
+                resize(srcImg[img_idx], img, Size(), compose_scale, compose_scale);
+            else
+                img = srcImg[img_idx];
+            Size img_size = img.size();
 
-        // Warp the current image
-        warper->warp(img, K, renderParam[seq].cameras[img_idx].R, INTER_LINEAR, BORDER_REFLECT, img_warped);
+            Mat K;
+            cameras[img_idx].K().convertTo(K, CV_32F);
 
-        // Warp the current image mask
-        mask.create(img_size, CV_8U);
-        mask.setTo(Scalar::all(255));
-        warper->warp(mask, K, renderParam[seq].cameras[img_idx].R, INTER_NEAREST, BORDER_CONSTANT, mask_warped);
+            // Warp the current image
+            lens_warper->warp(img, K, cameras[img_idx].R, INTER_LINEAR, BORDER_REFLECT, img_warped);
 
-        // Compensate exposure
-        compensator->apply(img_idx, corners[img_idx], img_warped, mask_warped);
+            // Warp the current image mask
+            mask.create(img_size, CV_8U);
+            mask.setTo(Scalar::all(255));
+            lens_warper->warp(mask, K, cameras[img_idx].R, INTER_NEAREST, BORDER_CONSTANT, mask_warped);
 
-        img_warped.convertTo(img_warped_s, CV_16S);
-        img_warped.release();
-        img.release();
-        mask.release();
-        K.release();
+            // Compensate exposure
+            compensator->apply(img_idx, corners[img_idx], img_warped, mask_warped);
 
-        dilate(masks_warped[img_idx], dilated_mask, Mat());
-        resize(dilated_mask, seam_mask, mask_warped.size());
-        mask_warped = seam_mask & mask_warped;
+            img_warped.convertTo(images_warped_s[img_idx], CV_16S);
+            img_warped.release();
+            img.release();
+            mask.release();
+            K.release();
 
-        if (!blender)
-        {
-            blender = Blender::createDefault(blend_type, try_cuda);
-            Size dst_sz = resultRoi(corners, sizes).size();
-            float blend_width = sqrt(static_cast<float>(dst_sz.area())) * blend_strength / 100.f;
-            if (blend_width < 1.f)
-                blender = Blender::createDefault(Blender::NO, try_cuda);
-            else if (blend_type == Blender::MULTI_BAND)
-            {
-                MultiBandBlender* mb = dynamic_cast<MultiBandBlender*>(blender.get());
-                mb->setNumBands(static_cast<int>(ceil(log(blend_width)/log(2.)) - 1.));
-                LOGR("Multi-band blender, number of bands: " << mb->numBands());
-            }
-            else if (blend_type == Blender::FEATHER)
-            {
-                FeatherBlender* fb = dynamic_cast<FeatherBlender*>(blender.get());
-                fb->setSharpness(1.f/blend_width);
-                LOGR("Feather blender, sharpness: " << fb->sharpness());
-            }
-            blender->prepare(corners, sizes);
+            dilate(masks_warped[img_idx], dilated_mask, Mat());
+            resize(dilated_mask, seam_mask, mask_warped.size());
+            masks_blend[img_idx] = seam_mask & mask_warped;
         }
-        blender->feed(img_warped_s, mask_warped, corners[img_idx]);
+    });
+
+    blender = Blender::createDefault(blend_type, try_cuda);
+    Size dst_sz = resultRoi(corners, sizes).size();
+    float blend_width = sqrt(static_cast<float>(dst_sz.area())) * blend_strength / 100.f;
+    if (blend_width < 1.f)
+        blender = Blender::createDefault(Blender::NO, try_cuda);
+    else if (blend_type == Blender::MULTI_BAND)
+    {
+        MultiBandBlender* mb = dynamic_cast<MultiBandBlender*>(blender.get());
+        mb->setNumBands(static_cast<int>(ceil(log(blend_width)/log(2.)) - 1.));
+        LOGR("Multi-band blender, number of bands: " << mb->numBands());
+    }
+    else if (blend_type == Blender::FEATHER)
+    {
+        FeatherBlender* fb = dynamic_cast<FeatherBlender*>(blender.get());
+        fb->setSharpness(1.f/blend_width);
+        LOGR("Feather blender, sharpness: " << fb->sharpness());
     }
+    blender->prepare(corners, sizes);
+    for (int img_idx = 0; img_idx < p.num_images; ++img_idx)
+        blender->feed(images_warped_s[img_idx], masks_blend[img_idx], corners[img_idx]);
+    images_warped_s.clear();
+    masks_blend.clear();
 
     Mat result, result_mask;
     blender->blend(result, result_mask);
 
     LOGR("[#] Compositing, time: " << ((getTickCount() - t) / getTickFrequency()) << " sec");
+    clock.Lap(STAGE_BLEND);
 
 #if ENABLE_RENDER_LOG
         t = getTickCount();
 #endif
 
-    Point ptImgL, ptImgR;
-	switch (seq)
-	{
-	case FRONT:
-		ptImgL = Point(0, 0);
-		ptImgR = Point(OutWidth/2, 0);
-		break;
-	case REAR:
-		ptImgL = Point(0, OutHeight/2);
-		ptImgR = Point(OutWidth/2, OutHeight/2);
-		break;
-	default:
-		LOGR("[ERR] Unexpected ERROR. Wierd image sequence");
-		return -1;
-	}
-
-	if(!result.empty()) {
-		if(doCrop) {
-			Mat viewport;
-			result.convertTo(result, CV_8UC3);
-			if(crop2InsideBox(seq, result, viewport)) {
-				resize(viewport, viewport, cv::Size(OutWidth, OutHeight/2), 0, 0, CV_INTER_LINEAR);
-				viewport.copyTo(destImg(cv::Rect(ptImgL, Size(viewport.cols, viewport.rows))));
-				//rectangle(gray, box, rectColor(255, 0, 0), 2);
-			} else {
-				// Fall back: If cannot obtain unique rectangle blob, displays separate screen
-				resize(srcImg[0], srcImg[0], cv::Size(OutWidth/2, OutHeight/2), 0, 0, CV_INTER_LINEAR);
-				srcImg[0].copyTo(destImg(cv::Rect(ptImgL ,Size(srcImg[0].cols, srcImg[0].rows))));
-				resize(srcImg[1], srcImg[1], cv::Size(OutWidth/2, OutHeight/2), 0, 0, CV_INTER_LINEAR);
-				srcImg[1].copyTo(destImg(cv::Rect(ptImgR, Size(srcImg[1].cols, srcImg[1].rows))));
-			}
-			viewport.release();
-		} else {
-			resize(result, result, cv::Size(OutWidth, OutHeight/2), 0, 0, CV_INTER_LINEAR);
-			result.copyTo(destImg(cv::Rect(ptImgL ,Size(result.cols, result.rows))));
-		}
-	} else {
-		//Error case
-		LOGR("[ERR] Unexpected ERROR. Cannot render this frame");
-	}
+    if(IntegrateResult(seq, result, srcImg, destImg) < 0)
+        return -1;
+    clock.Lap(STAGE_CROP);
 
     LOGR("[#] Image Integration, time: " << ((getTickCount() - t) / getTickFrequency()) << " sec");
 
@@ -651,115 +1381,184 @@ int Render(camDir_t seq, Mat srcImg[], Mat destImg)
     return 1;
 }
 
-bool crop2InsideBox(int seq, Mat& src, Mat& dst) {
-	if(renderParam[seq].updated) {
-		renderParam[seq].updated = false;
+int StitchCore::CheckSeamDrift(camDir_t seq, Mat srcImg[])
+{
+    std::shared_ptr<const stRenderParam> param = AcquireRenderParam(seq);
+    if (!param)
+        return -1;
+    const stRenderMap& map = param->map;
+    if (!map.baked || map.probe[0].empty())
+        return -1;
 
-		Mat gray, binary;
-		cvtColor(src, gray, CV_BGR2GRAY);
+    // Mean absolute difference of both lenses over the sampled overlap
+    const int cn = srcImg[0].channels();
+    Rect bounds0(Point(0, 0), srcImg[0].size());
+    Rect bounds1(Point(0, 0), srcImg[1].size());
+    double sum = 0;
+    int count = 0;
+    for (size_t k = 0; k < map.probe[0].size(); ++k)
+    {
+        Point a(cvRound(map.probe[0][k].x), cvRound(map.probe[0][k].y));
+        Point b(cvRound(map.probe[1][k].x), cvRound(map.probe[1][k].y));
+        if (!bounds0.contains(a) || !bounds1.contains(b))
+            continue;
 
-		// Detect edges using Threshold
-		threshold(gray, binary, 0, 255, THRESH_BINARY);
-
-		// Find contour
-		vector<vector<Point> > contours;
-		findContours(binary, contours, RETR_EXTERNAL, CHAIN_APPROX_SIMPLE);
-		//vector<Vec4i> hierarchy;
-		//findContours(binary, contours, hierarchy, CV_RETR_TREE, CV_CHAIN_APPROX_SIMPLE, Point(0, 0) );
-
-		//for (int i = 0; i < contours.size(); ++i)
-		if(contours.size() >= 0) {
-			// Find largest contour
-			int ctrIdx = 0;
-			int ctrArea = 0;
-			for(int i = 0; i < contours.size(); i++) {
-				double area = contourArea(contours[i], false);
-				if(area > ctrArea) {
-					ctrArea = area;
-					ctrIdx = i;
-				}
-			}
+        const uchar* pa = srcImg[0].ptr<uchar>(a.y) + a.x * cn;
+        const uchar* pb = srcImg[1].ptr<uchar>(b.y) + b.x * cn;
+        for (int c = 0; c < cn; ++c)
+            sum += std::abs(pa[c] - pb[c]);
+        count += cn;
+    }
+    if (count == 0)
+        return -1;
 
-			// Create a mask for each single blob
-			Mat1b maskSingleContour(gray.rows, gray.cols, uchar(0));
-			drawContours(maskSingleContour, contours, ctrIdx, Scalar(255), CV_FILLED);
+    float residual = (float)(sum / count);
+    float& ref = renderState[seq].seam_residual_ref;
+    if (ref < 0) {
+        // First frame rendered with these parameters is the reference
+        ref = residual;
+        return 0;
+    }
 
-			// Find minimum rect for each blob
-			renderParam[seq].validBox = findMinRect1b(~maskSingleContour);
+    return residual > ref * seam_drift_ratio + seam_drift_margin ? 1 : 0;
+}
 
-			dst = src(Rect(renderParam[seq].validBox.x, renderParam[seq].validBox.y, renderParam[seq].validBox.width, renderParam[seq].validBox.height));
-		} else if(renderParam[seq].validBox.x >= 0 && renderParam[seq].validBox.x < src.cols && renderParam[seq].validBox.y >= 0 && renderParam[seq].validBox.y < src.rows) {
-		    //If fail to find unique contour, then use previous size.
-		    //If previous box is larger than current src image, limits to current src image size.
-		    //FIXME: Is there more intelligent way to adjust crop size?
-			renderParam[seq].validBox.width = ((renderParam[seq].validBox.width + renderParam[seq].validBox.x) < src.cols) ? renderParam[seq].validBox.width : (src.cols - renderParam[seq].validBox.x);
-			renderParam[seq].validBox.height = ((renderParam[seq].validBox.height + renderParam[seq].validBox.y) < src.rows) ? renderParam[seq].validBox.height : (src.rows - renderParam[seq].validBox.y);
+bool StitchCore::crop2InsideBox(int seq, Mat& src, Mat& dst) {
+	Rect& validBox = renderState[seq].validBox;
+	// Boxes which do not fit this frame (e.g. live path on another input size) are measured again
+	if(renderState[seq].cropPending || (validBox & Rect(0, 0, src.cols, src.rows)) != validBox) {
+		renderState[seq].cropPending = false;
+		validBox = findCropBox(src);
+	}
 
-			dst = src(Rect(renderParam[seq].validBox.x, renderParam[seq].validBox.y, renderParam[seq].validBox.width, renderParam[seq].validBox.height));
-		} else {
-			renderParam[seq].validBox.x = -1;
-			renderParam[seq].validBox.y = -1;
-			renderParam[seq].validBox.width = -1;
-			renderParam[seq].validBox.height = -1;
+	if(validBox.width <= 0 || validBox.height <= 0)
+		return false;
 
-			return false;
-		}
+	dst = src(validBox);
+	return true;
+}
 
-		return true;
-	} else {
-		if(renderParam[seq].validBox.width != -1 && renderParam[seq].validBox.height != -1) {
-			dst = src(Rect(renderParam[seq].validBox.x, renderParam[seq].validBox.y, renderParam[seq].validBox.width, renderParam[seq].validBox.height));
-			return true;
+// Largest rectangle inside the largest non-black blob of src
+Rect findCropBox(const Mat& src)
+{
+	Mat gray, binary;
+	if(src.channels() == 1)
+		gray = src;
+	else
+		cvtColor(src, gray, CV_BGR2GRAY);
+
+	// Detect edges using Threshold
+	threshold(gray, binary, 0, 255, THRESH_BINARY);
+
+	// Find contour
+	vector<vector<Point> > contours;
+	findContours(binary, contours, RETR_EXTERNAL, CHAIN_APPROX_SIMPLE);
+	if(contours.empty())
+		return Rect();
+
+	// Find largest contour
+	int ctrIdx = 0;
+	double ctrArea = 0;
+	for(int i = 0; i < contours.size(); i++) {
+		double area = contourArea(contours[i], false);
+		if(area > ctrArea) {
+			ctrArea = area;
+			ctrIdx = i;
 		}
-		else
-			return false;
 	}
+
+	// Create a mask for the single blob
+	Mat1b maskSingleContour(gray.rows, gray.cols, uchar(0));
+	drawContours(maskSingleContour, contours, ctrIdx, Scalar(255), CV_FILLED);
+
+	return findMinRect1b(~maskSingleContour);
 }
 
+// Largest rectangle of zero pixels. Each row is a histogram of the zero
+// runs ending on it, solved with a stack of increasing heights, so the
+// whole search is O(rows * cols).
 // https://stackoverflow.com/questions/34896431/creating-rectangle-within-a-blob-using-opencv
-// https://stackoverflow.com/a/30418912/5008845
 Rect findMinRect1b(const Mat1b& src)
 {
-    Mat1f W(src.rows, src.cols, float(0));
-    Mat1f H(src.rows, src.cols, float(0));
+    // One extra column of height 0 flushes the stack at the end of a row
+    vector<int> heights(src.cols + 1, 0);
+    vector<int> stack;
+    stack.reserve(src.cols + 1);
 
     Rect maxRect(0, 0, 0, 0);
-    float maxArea = 0.f;
-
-    register short search_start = (short)((int)src.cols * (float)rect_search_start);
-    register short search_end = (short)((int)src.cols * (float)rect_search_end);
+    int maxArea = 0;
 
     for (int r = 0; r < src.rows; ++r)
     {
+        const uchar* row = src.ptr<uchar>(r);
         for (int c = 0; c < src.cols; ++c)
+            heights[c] = (row[c] == 0) ? heights[c] + 1 : 0;
+
+        stack.clear();
+        for (int c = 0; c <= src.cols; ++c)
         {
-            if (src(r, c) == 0)
+            while (!stack.empty() && heights[stack.back()] >= heights[c])
             {
-                H(r, c) = 1.f + ((r>0) ? H(r - 1, c) : 0);
-                W(r, c) = 1.f + ((c>0) ? W(r, c - 1) : 0);
-            }
-
-            // Heuristic optimization for rect searching(skip scheme)
-            if(c > search_end || c < search_start) {
-                float minw = W(r, c);
-                for (int h = 0; h < H(r, c); ++h)
+                int h = heights[stack.back()];
+                stack.pop_back();
+                int left = stack.empty() ? 0 : stack.back() + 1;
+                int area = h * (c - left);
+                if (area > maxArea)
                 {
-                    minw = min(minw, W(r - h, c));
-                    float area = (h + 1) * minw;
-                    if (area > maxArea)
-                    {
-                        maxArea = area;
-                        maxRect = Rect(Point(c - minw + 1, r - h), Point(c + 1, r + 1));
-                    }
+                    maxArea = area;
+                    maxRect = Rect(left, r - h + 1, c - left, h);
                 }
             }
+            stack.push_back(c);
         }
     }
 
     return maxRect;
 }
 
-bool isCameraParamValid(camDir_t seq)
+bool StitchCore::ExportCalib(camDir_t seq, stCalibRecord& rec)
+{
+    std::shared_ptr<const stRenderParam> param = std::atomic_load(&renderParam[seq]);
+    if(!param || !param->map.baked || param->map.seam_masks.empty())
+        return false;
+
+    rec.num_images = param->num_images;
+    rec.work_scale = param->work_scale;
+    rec.seam_scale = param->seam_scale;
+    rec.compose_scale = param->compose_scale;
+    rec.seam_work_aspect = param->seam_work_aspect;
+    rec.warped_image_scale = param->warped_image_scale;
+    rec.cameras = param->cameras;
+    rec.seam_masks = param->map.seam_masks;
+    rec.gain_maps = param->map.gain_maps;
+    rec.crop_box = param->map.crop_box;
+
+    return true;
+}
+
+int StitchCore::ImportCalib(camDir_t seq, const stCalibRecord& rec, Size src_size)
+{
+    if(rec.num_images != calcParam[seq].num_images)
+        return -1;
+
+    ResetParam(seq);
+    calcParam[seq].work_scale = rec.work_scale;
+    calcParam[seq].seam_scale = rec.seam_scale;
+    calcParam[seq].compose_scale = rec.compose_scale;
+    calcParam[seq].seam_work_aspect = rec.seam_work_aspect;
+    calcParam[seq].warped_image_scale = rec.warped_image_scale;
+    calcParam[seq].cameras = rec.cameras;
+
+    if(BuildRenderMap(seq, src_size, rec.seam_masks, rec.gain_maps, rec.crop_box) < 0) {
+        ResetParam(seq);
+        return -1;
+    }
+
+    UpdateParam(seq);
+    return 0;
+}
+
+bool StitchCore::isCameraParamValid(camDir_t seq)
 {
     return true; 
 
@@ -6,10 +6,54 @@
 #include "opencv2/stitching/detail/exposure_compensate.hpp"
 #include "opencv2/stitching/detail/motion_estimators.hpp"
 
+#include <memory>
+
+#include "OverlapFeatures.h"
+#include "StitchProfile.h"
+
 using namespace std;
 using namespace cv;
 using namespace cv::detail;
 
+// Seam strip between two lenses, blended with a multi-band pyramid instead
+// of the feather weights. Baked once per plane size.
+typedef struct _stSeamStrip{
+        Rect roi;               // strip in panorama coordinates, full height
+        vector<Mat> mask_pyr;   // lens 0 share per pyramid level (CV_16SC1)
+        Mat cover;              // pixels covered by any lens (CV_8UC1)
+        Mat gains[2];           // exposure gain of each lens (CV_16UC1)
+} stSeamStrip;
+
+// Precomputed per-lens tables for the static calibration render path.
+// Baked once on the calculation thread whenever new cameras are published.
+typedef struct _stRenderMap{
+        bool baked;
+        Size src_size;          // lens image size the tables are built for
+        double compose_scale;
+        Size pano_size;         // size of the warped panorama
+        vector<Point> corners;  // lens offsets inside the panorama
+        vector<Mat> xymaps;     // fixed-point remap tables (CV_16SC2)
+        vector<Mat> fracmaps;   // remap interpolation tables (CV_16UC1)
+        vector<Mat> weights;    // seam blend weight * exposure gain (CV_32FC1)
+        // Half resolution tables for 4:2:0 chroma planes
+        Size pano_size_c;
+        vector<Point> corners_c;
+        vector<Mat> xymaps_c;
+        vector<Mat> fracmaps_c;
+        vector<Mat> weights_c;
+        // Multi-band seam strips (if seamMultiBand ON), empty mask_pyr if off
+        stSeamStrip seam;
+        stSeamStrip seam_c;
+        // Crop box of the panorama (if doCrop ON)
+        Rect crop_box;
+        // Seam scale inputs the tables are built from
+        vector<Mat> seam_masks; // CV_8UC1
+        vector<Mat> gain_maps;  // CV_32FC1
+        // Source positions of sampled overlap pixels in both lenses, for
+        // the drift check
+        vector<Point2f> probe[2];
+} stRenderMap;
+
 typedef struct _stCalcParam{
         int num_images; // Num of Images in each sequence
         double work_scale;
@@ -20,11 +64,14 @@ typedef struct _stCalcParam{
         double seam_work_aspect;
         vector<int> indices;
         vector<Mat> images;
+        stRenderMap map;
 } stCalcParam;
 
+// Published snapshot of the stitching parameters. Immutable once published,
+// the render loop holds a reference for the duration of a frame.
 typedef struct _stRenderParam{
-        // Updated recently flag
-        bool updated;
+        // Publication counter, tells the render loop about a new snapshot
+        unsigned long generation;
         int num_images; // Num of Images in each sequence
         double work_scale;
         double seam_scale;
@@ -34,12 +81,52 @@ typedef struct _stRenderParam{
         double seam_work_aspect;
         vector<int> indices;
         vector<Mat> images;
-        // valid box size cache for rendering (if doCrop ON)
-        Rect validBox;
+        // remap tables cache for rendering (if precomputeRenderMap ON)
+        stRenderMap map;
 } stRenderParam;
 
-extern string features_type;
-extern bool applyROItoFeatureDetection;
+// Calibration result of one direction, enough to build the render tables
+// without any input frame. Stored by the calibration cache.
+typedef struct _stCalibRecord{
+        int num_images;
+        double work_scale;
+        double seam_scale;
+        double compose_scale;
+        double seam_work_aspect;
+        float warped_image_scale;
+        vector<CameraParams> cameras;
+        vector<Mat> seam_masks;
+        vector<Mat> gain_maps;
+        Rect crop_box;
+} stCalibRecord;
+
+// Render loop state derived from the current snapshot. Only touched by the
+// render loop, reset when a new generation shows up.
+typedef struct _stRenderState{
+        unsigned long generation;
+        // valid box size cache for rendering (if doCrop ON), taken from the
+        // snapshot or measured on the first frame if cropPending
+        bool cropPending;
+        Rect validBox;
+        // seam residual measured on the first frame of the snapshot
+        float seam_residual_ref;
+} stRenderState;
+
+// One direction of the current frame on the baked render path
+typedef struct _stBakedJob{
+        camDir_t seq;
+        std::shared_ptr<const stRenderParam> param;
+        int planes;             // 1 for packed BGR, 3 for Y, U, V
+        vector<Mat> src[3];     // lens planes at compose scale
+        Mat pano[3];            // blended panorama planes
+} stBakedJob;
+
+// Band of rows of one panorama plane, unit of work of the parallel blend
+typedef struct _stRenderTile{
+        int job;
+        int plane;
+        Range rows;
+} stRenderTile;
 
 static bool try_cuda = false;
 static double work_megapix = -1.0;
@@ -60,24 +147,80 @@ static int feature_detect_threshold = 6;
 static float ratioROI = 0.45;
 static bool doCrop = true;
 static float filter_conf = 0.8;
-static float rect_search_start = 0.01;
-static float rect_search_end = 0.75;
-
-// Stitching Parameter buffer in use while cacluation. renderParam will be updated with this value, if the work is suceeded.
-static stCalcParam calcParam[2];
-
-// Stitching Parameter which is used by rendering loop. This parameter must not be null always.
-static stRenderParam renderParam[2];
-
-void InitParam(camDir_t seq /*0 = front, 1 = rear*/, int num_image_in_each_seq /*video channel in a row*/);
-void ResetParam(camDir_t seq);
-void UpdateParam(camDir_t seq);
-// Memory deallocation for program termination
-void DeallocAllParam(camDir_t seq);
-int CalcCameraParam(camDir_t seq/*Front = 0, Rear = 1*/, Mat srcImg[]);
-int Render(camDir_t seq, Mat srcImg[], Mat destImg);
+static bool precomputeRenderMap = true;
+static int seam_probe_step = 8;
+static float seam_drift_ratio = 1.5f;
+static float seam_drift_margin = 4.f;
+static bool parallelRender = true;
+static int render_tile_rows = 32;
+static bool seamMultiBand = true;
+
 Rect findMinRect1b(const Mat1b& src);
-bool crop2InsideBox(int seq, Mat& src, Mat& dst);
-bool isCameraParamValid(camDir_t seq);
+Rect findCropBox(const Mat& src);
+
+// Stitching parameters and routines of one stitching instance
+class StitchCore
+{
+public:
+    StitchCore();
+    ~StitchCore();
+
+    void SetOutputSize(int width, int height);
+
+    void InitParam(camDir_t seq /*0 = front, 1 = rear*/, int num_image_in_each_seq /*video channel in a row*/);
+    void ResetParam(camDir_t seq);
+    void UpdateParam(camDir_t seq);
+    // Memory deallocation for program termination
+    void DeallocAllParam(camDir_t seq);
+    int CalcCameraParam(camDir_t seq/*Front = 0, Rear = 1*/, Mat srcImg[]);
+    int BakeRenderMap(camDir_t seq, Mat srcImg[]);
+    int Render(camDir_t seq, Mat srcImg[], Mat destImg);
+    // Render all directions of a frame, srcImg holds two lenses per direction.
+    // Baked directions are warped and blended together in one parallel pass.
+    // ret[seq] is 1 if rendered, -1 if the caller has to show the input.
+    void RenderFrame(Mat srcImg[], Mat destImg, int ret[]);
+    void RenderFramePlanes(Mat srcPlanes[][3], Mat destPlanes[], int ret[]);
+    // 1 if the seam does not match anymore, 0 if stable, -1 if unknown
+    int CheckSeamDrift(camDir_t seq, Mat srcImg[]);
+    bool crop2InsideBox(int seq, Mat& src, Mat& dst);
+    bool isCameraParamValid(camDir_t seq);
+
+    // Current published calibration, false if there is none
+    bool ExportCalib(camDir_t seq, stCalibRecord& rec);
+    // Publish a stored calibration for lenses of src_size
+    int ImportCalib(camDir_t seq, const stCalibRecord& rec, Size src_size);
+
+    string features_type;
+    bool applyROItoFeatureDetection;
+    // Stage timings sink, NULL unless benchmarking
+    StitchProfiler* profiler;
+
+private:
+    // Load the current snapshot and sync renderState with it
+    std::shared_ptr<const stRenderParam> AcquireRenderParam(camDir_t seq);
+    void PublishParam(camDir_t seq, std::shared_ptr<const stRenderParam> param);
+    int BuildRenderMap(camDir_t seq, Size src_size, const vector<Mat>& seam_masks, const vector<Mat>& gain_maps, Rect crop_box = Rect());
+    bool PrepareBakedJob(camDir_t seq, Mat src[][3], int planes, stBakedJob& job);
+    int IntegrateResult(camDir_t seq, Mat& result, Mat srcImg[], Mat destImg);
+    int IntegratePlanes(camDir_t seq, Mat pano[], Mat srcPlanes[][3], Mat destPlanes[]);
+
+    int outWidth;
+    int outHeight;
+
+    // Stitching Parameter buffer in use while cacluation. renderParam will be updated with this value, if the work is suceeded.
+    stCalcParam calcParam[CAMDIR_END];
+    // ORB pipeline of each lens pair, reused by every calculation
+    OverlapFeatures overlap[CAMDIR_END];
+
+    // Stitching Parameter which is used by rendering loop. Swapped atomically
+    // (std::atomic_load/atomic_exchange), never modified after publication.
+    std::shared_ptr<const stRenderParam> renderParam[CAMDIR_END];
+    // Previous snapshot, kept until the next update so the last reference
+    // is dropped on the calculation thread rather than in the render loop
+    std::shared_ptr<const stRenderParam> retiredParam[CAMDIR_END];
+    unsigned long generation[CAMDIR_END];
+
+    stRenderState renderState[CAMDIR_END];
+};
 
 #endif // _STITCHCORE_H_
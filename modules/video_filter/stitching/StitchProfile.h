@@ -0,0 +1,60 @@
+#ifndef _STITCHPROFILE_H_
+#define _STITCHPROFILE_H_
+
+#include "opencv2/core.hpp"
+
+// Pipeline stages reported to a StitchProfiler
+typedef enum {
+	STAGE_FEATURES = 0,
+	STAGE_MATCH,
+	STAGE_BUNDLE,
+	STAGE_BAKE,     // render tables of a new calibration
+	STAGE_WARP,
+	STAGE_EXPOSURE,
+	STAGE_SEAM,
+	STAGE_BLEND,    // baked tables warp and blend in this single stage
+	STAGE_CROP,
+	STAGE_END
+} stitchStage_t;
+
+static const char* const stitchStageName[STAGE_END] = {
+    "features", "match", "bundle", "bake", "warp", "exposure", "seam", "blend", "crop"
+};
+
+// Receives the duration of every stage run. Nothing is timed without one,
+// the plugin never sets it. Called from whichever thread runs the stage.
+class StitchProfiler
+{
+public:
+    virtual ~StitchProfiler() {}
+    virtual void Record(stitchStage_t stage, double sec) = 0;
+};
+
+// Lap timer over consecutive stages of one call
+class StageClock
+{
+public:
+    explicit StageClock(StitchProfiler* p) : profiler(p), t(p ? cv::getTickCount() : 0) {}
+
+    // Time since the previous lap goes to stage
+    void Lap(stitchStage_t stage)
+    {
+        if(!profiler)
+            return;
+        int64 now = cv::getTickCount();
+        profiler->Record(stage, (now - t) / cv::getTickFrequency());
+        t = now;
+    }
+    // Restart without recording, the work since the last lap reported itself
+    void Skip()
+    {
+        if(profiler)
+            t = cv::getTickCount();
+    }
+
+private:
+    StitchProfiler* profiler;
+    int64 t;
+};
+
+#endif // _STITCHPROFILE_H_
@@ -25,6 +25,7 @@
 #endif
 
 #include <assert.h>
+#include <errno.h>
 #include <atomic>
 #include <iostream>
 
@@ -35,6 +36,7 @@
 #include <vlc_image.h>
 #include <vlc_modules.h>
 #include <vlc_vout.h>
+#include <vlc_fs.h>
 
 #include "filter_picture.h"
 
@@ -42,10 +44,12 @@
 #include "opencv2/objdetect.hpp"
 
 #include "LFSecurity.h"
-#include "stitching.h"
 #include "LFUtil.h"
 #include "StitchCore.h"
 #include "FaceDetection.h"
+#include "CalibScheduler.h"
+#include "CalibCache.h"
+#include "stitching.h"
 
 using namespace cv;
 using namespace std;
@@ -56,6 +60,15 @@ static void Destroy     ( vlc_object_t * );
 static picture_t *Filter( filter_t *, picture_t * );
 static int FilterCallback( vlc_object_t *, char const *, vlc_value_t, vlc_value_t, void * );
 
+#define CFG_PREFIX "stitching-"
+
+#define DEVICE_TEXT N_("Camera device identifier")
+#define DEVICE_LONGTEXT N_("Identifies the camera (e.g. its serial number) " \
+    "in the calibration cache. The cache is disabled without it.")
+#define CACHE_TEXT N_("Calibration cache")
+#define CACHE_LONGTEXT N_("Keep the last good calibration of the camera " \
+    "and start stitching from it.")
+
 vlc_module_begin ()
     set_description( N_("Stitching") )
     set_shortname( N_("Stitching video" ))
@@ -63,49 +76,105 @@ vlc_module_begin ()
     set_category( CAT_VIDEO )
     set_subcategory( SUBCAT_VIDEO_VFILTER )
     set_capability( "video filter", 0 )
+    add_string( CFG_PREFIX "device", "", DEVICE_TEXT, DEVICE_LONGTEXT, false )
+    add_bool( CFG_PREFIX "calib-cache", true, CACHE_TEXT, CACHE_LONGTEXT, false )
     set_callbacks( Create, Destroy )
 vlc_module_end ()
 
 typedef struct {
     image_handler_t* p_image_handle;
+    image_handler_t* p_image_handle_out;
     picture_t* p_proc_image;
     picture_t* p_dest_image;
+    StitchEngine* p_engine;
+    bool b_engine_started;
 } filter_sys_t;
 
-void InitStreamStitcher(int srcWidth, int srcHeight, int outWidth, int outHeight, string fType, int interval, bool bFaceDetectON)
+StitchEngine::StitchEngine()
+    : isFramePlanar(false),
+      frame(0),
+      padding(0),
+      recalc_interval(2000),
+      bFaceDetect(false),
+      bStop(false),
+      inFlight(0)
+{
+    for(int seq = FRONT; seq < CAMDIR_END; seq++) {
+        isParamAvailable[seq] = false;
+        needCalib[seq] = true;
+        pending[seq] = false;
+        calibFailures[seq] = 0;
+        cachedValid[seq] = false;
+    }
+}
+
+StitchEngine::~StitchEngine()
+{
+    StopStreamStitcher();
+}
+
+void StitchEngine::InitStreamStitcher(int srcWidth, int srcHeight, int outWidth, int outHeight, string fType, int interval, bool bFaceDetectON)
 {
     frame = 0;
-    isFrameAvailable = false;
 
-    features_type = fType;
-    RTSP_SrcWidth = srcWidth;
-    RTSP_SrcHeight = srcHeight;
+    core.features_type = fType;
 
-    // If bandwidth is under 0.5Mpx, we don't limit feature detection region
-    //if(RTSP_SrcWidth*RTSP_SrcHeight < 5 * 1e5) {
-    //    if(features_type.compare("orb") == 0) {
-            applyROItoFeatureDetection = false;
-    //    }
-    //    padding = 0;
-    //}
+    // ORB only looks at the overlap bands, other detectors at the whole lens
+    core.applyROItoFeatureDetection = (core.features_type.compare("orb") == 0);
 
-    OutWidth = outWidth;
-    OutHeight = outHeight;
+    core.SetOutputSize(outWidth, outHeight);
+    lensSize = Size(srcWidth/2 - padding, srcHeight/2 - padding);
 
     recalc_interval = interval;
     bFaceDetect = bFaceDetectON;
 }
 
-void RunStreamStitcher()
+void StitchEngine::RunStreamStitcher()
 {
-    stitchFrontThread = std::thread(_CalcFrontThread);
-    stitchRearThread = std::thread(_CalcRearThread);
+    core.InitParam(FRONT, 2);
+    core.InitParam(REAR, 2);
+
+    // Start from the cached calibration, live calibration only refines it
+    if(!cachePath.empty()) {
+        std::lock_guard<std::mutex> lock(mtxCache);
+        LoadCalibCache(cachePath, cached, cachedValid);
+        for(int seq = FRONT; seq < CAMDIR_END; seq++) {
+            if(cachedValid[seq] && core.ImportCalib((camDir_t)seq, cached[seq], lensSize) == 0)
+                isParamAvailable[seq] = true;
+        }
+    }
+
+    mtxJobs.lock();
+    bStop = false;
+    for(int seq = FRONT; seq < CAMDIR_END; seq++)
+        needCalib[seq] = true;
+    scheduler = CalibScheduler::Acquire();
+    mtxJobs.unlock();
 
     if(bFaceDetect)
-        InitFaceDetectionAndGetRef(faceDetectThread);
+        faceDetector.Start();
+}
+
+void StitchEngine::StopStreamStitcher()
+{
+    isParamAvailable[FRONT] = false;
+    isParamAvailable[REAR] = false;
+
+    // Queued jobs return at once, wait for the running ones
+    std::unique_lock<std::mutex> lock(mtxJobs);
+    bStop = true;
+    while(inFlight > 0)
+        condJobs.wait(lock);
+    scheduler.reset();
+    lock.unlock();
+
+    faceDetector.Stop();
+
+    core.DeallocAllParam(FRONT);
+    core.DeallocAllParam(REAR);
 }
 
-void BindStreamStitcherInputBuf()
+void StitchEngine::BindStreamStitcherInputBuf()
 {
     // subMat은 buffer의 물리적인 주소에 dependent하므로, 데이터의 위치가 셋업 된 이후에 subMat을 설정해주어야 한다.
     partFrames[0] = RTSPframe(cv::Rect(padding, padding, RTSPframe.cols/2 - padding, RTSPframe.rows/2 - padding));
@@ -114,117 +183,169 @@ void BindStreamStitcherInputBuf()
     partFrames[3] = RTSPframe(cv::Rect(RTSPframe.cols/2, RTSPframe.rows/2 ,RTSPframe.cols/2 - padding, RTSPframe.rows/2 - padding));
 }
 
-static void _CalcFrontThread()
+// Lens planes of a 4:2:0 frame, same layout as partFrames
+static void BindLensPlanes(Mat planes[], int idx, Mat lens[])
 {
-    InitParam(FRONT, 2);
-    while(true) {
-        if(bSigStop) {
-            cout << "CalcFrontThread exit" << endl;
-            break;
-        }
+    int w = planes[0].cols / 2;
+    int h = planes[0].rows / 2;
+    int x = (idx % 2) * w;
+    int y = (idx / 2) * h;
+
+    lens[0] = planes[0](cv::Rect(x, y, w, h));
+    lens[1] = planes[1](cv::Rect(x / 2, y / 2, w / 2, h / 2));
+    lens[2] = planes[2](cv::Rect(x / 2, y / 2, w / 2, h / 2));
+}
 
-        if (!isFrameAvailable){
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
-            continue;
-        }
+// BGR copy of one lens of the planar frame for parameter calculation
+Mat StitchEngine::CloneLensPlanesToBGR(int idx)
+{
+    Mat lens[3];
+    BindLensPlanes(RTSPplanes, idx, lens);
+
+    int w = lens[0].cols & ~1;
+    int h = lens[0].rows & ~1;
+    Mat i420(h * 3 / 2, w, CV_8UC1);
+    Mat y(h, w, CV_8UC1, i420.ptr(0));
+    Mat u(h / 2, w / 2, CV_8UC1, i420.ptr(h));
+    Mat v(h / 2, w / 2, CV_8UC1, i420.ptr(h) + (h / 2) * (w / 2));
+    lens[0](cv::Rect(0, 0, w, h)).copyTo(y);
+    lens[1](cv::Rect(0, 0, w / 2, h / 2)).copyTo(u);
+    lens[2](cv::Rect(0, 0, w / 2, h / 2)).copyTo(v);
+
+    Mat bgr;
+    cvtColor(i420, bgr, COLOR_YUV2BGR_I420);
+    return bgr;
+}
+
+// Must be called with mtxBuf held
+void StitchEngine::ClonePartFrames(int idx, Mat& left, Mat& right)
+{
+    if(isFramePlanar) {
+        left = CloneLensPlanesToBGR(idx);
+        right = CloneLensPlanesToBGR(idx + 1);
+    } else {
+        left = partFrames[idx].clone();
+        right = partFrames[idx + 1].clone();
+    }
+}
+
+void StitchEngine::CalibrationJob(camDir_t seq)
+{
+    bool published = false;
 
+    if(!bStop) {
+        Mat left, right;
         mtxBuf.lock();
-        Mat left = partFrames[0].clone();
-        Mat right = partFrames[1].clone();
+        ClonePartFrames(seq * 2, left, right);
         mtxBuf.unlock();
 
         Mat input[2] = {left, right};
-        int ret = CalcCameraParam(FRONT, input);
+        int ret = core.CalcCameraParam(seq, input);
+        if(ret != -1 && precomputeRenderMap)
+            core.BakeRenderMap(seq, input);
         left.release();
         right.release();
-        if(ret != -1 && isCameraParamValid(FRONT)) {
-            mtxFrontDraw.lock();
-            UpdateParam(FRONT);
-            mtxFrontDraw.unlock();
-            isParamAvailable[FRONT] = true;
-
-            // If succeded, rest for a while in order to stabilize screen
-            std::this_thread::sleep_for(std::chrono::milliseconds(recalc_interval));
+        if(ret != -1 && core.isCameraParamValid(seq)) {
+            // Lock-free publication, the render loop picks it up on its next frame
+            core.UpdateParam(seq);
+            isParamAvailable[seq] = true;
+            needCalib[seq] = false;
+            published = true;
+            StoreCalibCache(seq);
         }
-
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
     }
+
+    std::lock_guard<std::mutex> lock(mtxJobs);
+    lastCalib[seq] = std::chrono::steady_clock::now();
+    calibFailures[seq] = published ? 0 : calibFailures[seq] + 1;
+    pending[seq] = false;
+    inFlight--;
+    condJobs.notify_all();
 }
 
-static void _CalcRearThread()
+// Remember the calibration just published for the next start
+void StitchEngine::StoreCalibCache(camDir_t seq)
 {
-    InitParam(REAR, 2);
-    while(true) {
-        if(bSigStop) {
-            cout << "CalcRearThread exit" << endl;
-            break;
-        }
+    if(cachePath.empty())
+        return;
+
+    std::lock_guard<std::mutex> lock(mtxCache);
+    if(!core.ExportCalib(seq, cached[seq]))
+        return;
+    cachedValid[seq] = true;
+    if(!SaveCalibCache(cachePath, cached, cachedValid))
+        cout << "[ERR] Cannot write calibration cache " << cachePath << endl;
+}
 
-        if (!isFrameAvailable) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+void StitchEngine::ScheduleCalibration()
+{
+    std::lock_guard<std::mutex> lock(mtxJobs);
+    if(bStop || !scheduler)
+        return;
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    for(int seq = FRONT; seq < CAMDIR_END; seq++) {
+        if(pending[seq])
             continue;
-        }
 
-        mtxBuf.lock();
-        Mat left = partFrames[2].clone();
-        Mat right = partFrames[3].clone();
-        mtxBuf.unlock();
+        if(isParamAvailable[seq] && !needCalib[seq])
+            continue;
 
-        Mat input[2] = {left, right};
-        int ret = CalcCameraParam(REAR, input);
-        left.release();
-        right.release();
-        if(ret != -1 && isCameraParamValid(REAR)) {
-            mtxRearDraw.lock();
-            UpdateParam(REAR);
-            mtxRearDraw.unlock();
-            isParamAvailable[REAR] = true;
-
-            // If succeded, rest for a while in order to stabilize screen
-            std::this_thread::sleep_for(std::chrono::milliseconds(recalc_interval));
-        }
+        // Rest after every job: after a success in order to stabilize
+        // screen, after failures from a quarter of the interval, doubled
+        // each time up to 8 intervals
+        std::chrono::milliseconds rest(recalc_interval);
+        if(calibFailures[seq] > 0)
+            rest = std::chrono::milliseconds(recalc_interval / 4)
+                 * (1 << __MIN(calibFailures[seq] - 1, 5));
+        if(now - lastCalib[seq] < rest)
+            continue;
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        pending[seq] = true;
+        inFlight++;
+        camDir_t dir = (camDir_t)seq;
+        scheduler->Submit([this, dir]() { CalibrationJob(dir); });
     }
 }
 
-void FrameRender()
+// Must be called from the render loop, right after rendering seq
+void StitchEngine::UpdateSeamDrift(camDir_t seq, Mat srcImg[])
 {
-    if(isParamAvailable[FRONT]) {
-        mtxFrontDraw.lock();
-        Mat input[2] = {partFrames[0], partFrames[1]};
-        Render(FRONT, input, RTSPframe_result);
-        mtxFrontDraw.unlock();
-    } else {
-        Mat resized;
-        if(RTSPframe.cols != RTSPframe_result.cols || RTSPframe.rows != RTSPframe_result.rows) {
-            resize(RTSPframe(Rect(0, 0, RTSPframe.cols, RTSPframe.rows/2)), resized, Size(RTSPframe_result.cols, RTSPframe_result.rows/2), INTER_LINEAR);
-        } else {
-            resized = RTSPframe(Rect(0, 0, RTSPframe.cols, RTSPframe.rows/2));
-        }
-        resized.copyTo(RTSPframe_result(Rect(0, 0, RTSPframe_result.cols, RTSPframe_result.rows/2)));
-    }
+    // Without a drift check, fall back to periodic recalculation
+    needCalib[seq] = core.CheckSeamDrift(seq, srcImg) != 0;
+}
 
-    if(isParamAvailable[REAR]) {
-        mtxRearDraw.lock();
-        Mat input[2] = {partFrames[2], partFrames[3]};
-        Render(REAR, input, RTSPframe_result);
-        mtxRearDraw.unlock();
-    } else {
-        Mat resized;
-        if(RTSPframe.cols != RTSPframe_result.cols || RTSPframe.rows != RTSPframe_result.rows) {
-            resize(RTSPframe(Rect(0, RTSPframe.rows/2, RTSPframe.cols, RTSPframe.rows/2)), resized, Size(RTSPframe_result.cols, RTSPframe_result.rows/2), INTER_LINEAR);
-        } else {
-            resized = RTSPframe(Rect(0, RTSPframe.rows/2, RTSPframe.cols, RTSPframe.rows/2));
+void StitchEngine::FrameRender(int64_t pts)
+{
+    // Both directions are rendered in one pass, see StitchCore::RenderFrame()
+    Mat input[4] = {partFrames[0], partFrames[1], partFrames[2], partFrames[3]};
+    int ret[CAMDIR_END];
+    core.RenderFrame(input, RTSPframe_result, ret);
+
+    for(int seq = FRONT; seq < CAMDIR_END; seq++) {
+        if(isParamAvailable[seq])
+            UpdateSeamDrift((camDir_t)seq, &partFrames[seq * 2]);
+
+        if(ret[seq] != 1) {
+            // Not stitched (yet), show the input half as it is
+            Rect src_half(0, seq * RTSPframe.rows/2, RTSPframe.cols, RTSPframe.rows/2);
+            Rect dst_half(0, seq * RTSPframe_result.rows/2, RTSPframe_result.cols, RTSPframe_result.rows/2);
+            Mat resized;
+            if(RTSPframe.cols != RTSPframe_result.cols || RTSPframe.rows != RTSPframe_result.rows) {
+                resize(RTSPframe(src_half), resized, dst_half.size(), INTER_LINEAR);
+            } else {
+                resized = RTSPframe(src_half);
+            }
+            resized.copyTo(RTSPframe_result(dst_half));
         }
-        resized.copyTo(RTSPframe_result(Rect(0, RTSPframe_result.rows/2, RTSPframe_result.cols, RTSPframe_result.rows/2)));
     }
 
     if(bFaceDetect) {
-        RunFaceDetectionIfPossible(RTSPframe_result);
+        faceDetector.Submit(RTSPframe_result, pts);
 
+        // Boxes of the analysed frames around this one
         vector<Rect> faces;
-        GetFaceDetectedResult(faces);
+        faceDetector.GetFaces(pts, faces);
         for( size_t i = 0; i < faces.size(); i++ ){
             Point lb(faces[i].x + faces[i].width, faces[i].y + faces[i].height);
             Point tr(faces[i].x, faces[i].y);
@@ -238,6 +359,69 @@ void FrameRender()
     }
 }
 
+void StitchEngine::FramePlanesRender(Mat destPlanes[])
+{
+    Mat lens[4][3];
+    for(int i = 0; i < 4; i++)
+        BindLensPlanes(RTSPplanes, i, lens[i]);
+
+    int ret[CAMDIR_END];
+    core.RenderFramePlanes(lens, destPlanes, ret);
+
+    for(int seq = FRONT; seq < CAMDIR_END; seq++) {
+        if(isParamAvailable[seq]) {
+            Mat luma[2] = {lens[seq * 2][0], lens[seq * 2 + 1][0]};
+            UpdateSeamDrift((camDir_t)seq, luma);
+        }
+
+        if(ret[seq] != 1) {
+            // Not stitched (yet), show the input half as it is
+            for(int plane = 0; plane < 3; plane++) {
+                Mat src = RTSPplanes[plane](Rect(0, seq * RTSPplanes[plane].rows / 2, RTSPplanes[plane].cols, RTSPplanes[plane].rows / 2));
+                Mat dst = destPlanes[plane](Rect(0, seq * destPlanes[plane].rows / 2, destPlanes[plane].cols, destPlanes[plane].rows / 2));
+                if(src.size() != dst.size())
+                    resize(src, dst, dst.size(), 0, 0, INTER_LINEAR);
+                else
+                    src.copyTo(dst);
+            }
+        }
+    }
+}
+
+// Cache file keyed by device and input resolution, in the user cache dir.
+// Without a device identifier, cameras of the same resolution could not be
+// told apart, so there is no cache.
+static void SetupCalibCache( filter_t *p_filter, StitchEngine *p_engine )
+{
+    char *psz_device = var_InheritString( p_filter, CFG_PREFIX "device" );
+    if( psz_device == NULL )
+    {
+        msg_Dbg( p_filter, "no camera device identifier, calibration cache disabled" );
+        return;
+    }
+    string device( psz_device );
+    free( psz_device );
+
+    char *psz_cache = config_GetUserDir( VLC_CACHE_DIR );
+    if( psz_cache == NULL )
+        return;
+
+    string dir = string( psz_cache ) + DIR_SEP "stitching";
+    free( psz_cache );
+    if( vlc_mkdir( dir.c_str(), 0700 ) != 0 && errno != EEXIST )
+    {
+        msg_Warn( p_filter, "cannot create calibration cache directory %s", dir.c_str() );
+        return;
+    }
+
+    string path = MakeCalibCachePath( dir, device,
+                                      p_filter->fmt_in.video.i_visible_width,
+                                      p_filter->fmt_in.video.i_visible_height );
+
+    msg_Dbg( p_filter, "calibration cache %s", path.c_str() );
+    p_engine->SetCalibCache( path );
+}
+
 static int Create( vlc_object_t *p_this )
 {
     filter_t *p_filter = (filter_t *)p_this;
@@ -264,8 +448,21 @@ static int Create( vlc_object_t *p_this )
     p_filter->p_sys = p_sys;
     p_filter->pf_video_filter = Filter;
     p_sys->p_image_handle = image_HandlerCreate( p_filter );
+    p_sys->p_image_handle_out = image_HandlerCreate( p_filter );
     p_sys->p_proc_image = NULL;
     p_sys->p_dest_image = NULL;
+    p_sys->b_engine_started = false;
+
+    p_sys->p_engine = new (std::nothrow) StitchEngine();
+    if(p_sys->p_engine == NULL) {
+        image_HandlerDelete( p_sys->p_image_handle );
+        image_HandlerDelete( p_sys->p_image_handle_out );
+        free( p_sys );
+        return VLC_ENOMEM;
+    }
+
+    if( var_InheritBool( p_filter, CFG_PREFIX "calib-cache" ) )
+        SetupCalibCache( p_filter, p_sys->p_engine );
 
     printf("Open stitching plugin\n");
 
@@ -274,32 +471,19 @@ static int Create( vlc_object_t *p_this )
 
 static void Destroy( vlc_object_t *p_this )
 {
-    // Prevent destroy repeat
-    if(!stitcherInitDone)
-        return;
-
     filter_t *p_filter = (filter_t *)p_this;
     filter_sys_t *p_sys = (filter_sys_t *)p_filter->p_sys;
+    StitchEngine *p_engine = p_sys->p_engine;
 
-    isParamAvailable[FRONT] = false;
-    isParamAvailable[REAR] = false;
-
-    stitcherInitDone = false;
-    bSigStop = true;
-
-    if(stitchFrontThread.joinable())
-        stitchFrontThread.join();
-    if(stitchRearThread.joinable())
-        stitchRearThread.join();
-    if(bFaceDetect && faceDetectThread.joinable())
-        faceDetectThread.join();
-
-    DeallocAllParam(FRONT);
-    DeallocAllParam(REAR);
+    // Worker threads must be gone before the buffers they read are released
+    p_engine->StopStreamStitcher();
 
     if (p_sys->p_image_handle) {
         image_HandlerDelete( p_sys->p_image_handle );
     }
+    if (p_sys->p_image_handle_out) {
+        image_HandlerDelete( p_sys->p_image_handle_out );
+    }
 
     if(p_sys->p_proc_image) {
         picture_Release(p_sys->p_proc_image);
@@ -310,10 +494,7 @@ static void Destroy( vlc_object_t *p_this )
         p_sys->p_dest_image = NULL;
     }
 
-    RTSPframe.release();
-    RTSPframe_result.release();
-
-    bSigStop = false;
+    delete p_engine;
 
     printf("Close stitching plugin\n");
     free( p_sys );
@@ -326,7 +507,7 @@ static void ReleaseImages( filter_t* p_filter )
         picture_Release(p_sys->p_dest_image);
         p_sys->p_dest_image = NULL;
     }
-    RTSPframe_result.release();
+    p_sys->p_engine->RTSPframe_result.release();
 }
 
 static void PictureToRGBMat( filter_t* p_filter, picture_t* p_in, Mat& m)
@@ -348,7 +529,9 @@ static void PictureToRGBMat( filter_t* p_filter, picture_t* p_in, Mat& m)
         picture_Release(p_sys->p_proc_image);
         p_sys->p_proc_image = NULL;
     }
-    RTSPframe.release();
+    p_sys->p_engine->RTSPframe.release();
+    for(int i = 0; i < 3; i++)
+        p_sys->p_engine->RTSPplanes[i].release();
 
     p_sys->p_proc_image = image_Convert(p_sys->p_image_handle, p_in, &(p_in->format), &fmt_out );
 
@@ -362,6 +545,44 @@ static void PictureToRGBMat( filter_t* p_filter, picture_t* p_in, Mat& m)
     m = Mat(sz, CV_8UC3, p_sys->p_proc_image->p[0].p_pixels);
 }
 
+static Mat PlaneToMat( plane_t* p )
+{
+    return Mat(p->i_visible_lines, p->i_visible_pitch / p->i_pixel_pitch, CV_8UC1, p->p_pixels, p->i_pitch);
+}
+
+// 4:2:0 input can be rendered on its planes, without RGB conversion
+static bool CanRenderPlanes( filter_t* p_filter, picture_t* p_pic )
+{
+    filter_sys_t* p_sys = (filter_sys_t *)p_filter->p_sys;
+    if(!precomputeRenderMap || p_sys->p_engine->isFaceDetectEnabled())
+        return false;
+
+    switch( p_pic->format.i_chroma ) {
+        case VLC_CODEC_I420:
+        case VLC_CODEC_J420:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static void HoldInputPlanes( filter_t* p_filter, picture_t* p_in )
+{
+    filter_sys_t* p_sys = (filter_sys_t *)p_filter->p_sys;
+
+    // Release previous memory
+    if(p_sys->p_proc_image) {
+        picture_Release(p_sys->p_proc_image);
+        p_sys->p_proc_image = NULL;
+    }
+    p_sys->p_engine->RTSPframe.release();
+
+    // Keep the input picture alive for the calculation threads instead of copying it
+    p_sys->p_proc_image = picture_Hold(p_in);
+    for(int i = 0; i < 3; i++)
+        p_sys->p_engine->RTSPplanes[i] = PlaneToMat(&p_in->p[i]);
+}
+
 static void PrepareResultPicture(filter_t* p_filter, picture_t* ref_pic, picture_t* out_pic)
 {
     filter_sys_t* p_sys = (filter_sys_t *)p_filter->p_sys;
@@ -377,7 +598,7 @@ static void PrepareResultPicture(filter_t* p_filter, picture_t* ref_pic, picture
 
     // RGB -> YUV
     picture_t* p_outpic_tmp = image_Convert(
-            p_sys->p_image_handle,
+            p_sys->p_image_handle_out,
             p_sys->p_dest_image,
             &(p_sys->p_dest_image->format),
             &fmt_out );
@@ -415,34 +636,53 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
         return NULL;
     }
 
+    filter_sys_t *p_sys = (filter_sys_t *)p_filter->p_sys;
+    StitchEngine *p_engine = p_sys->p_engine;
+
     // Prevent repeat create
-    if(!stitcherInitDone) {
-        stitcherInitDone = true;
+    if(!p_sys->b_engine_started) {
+        p_sys->b_engine_started = true;
         int width = abs(p_pic->p[0].i_visible_pitch / p_pic->p[0].i_pixel_pitch);
         int height = abs(p_pic->p[0].i_visible_lines);
-        InitStreamStitcher(width, height, width, height, "orb");
-        RunStreamStitcher();
+        p_engine->InitStreamStitcher(width, height, width, height, "orb");
+        p_engine->RunStreamStitcher();
     }
 
-    filter_sys_t *p_sys = (filter_sys_t *)p_filter->p_sys;
+    bool planar = CanRenderPlanes(p_filter, p_pic);
 
-    isFrameAvailable = false;
-    mtxBuf.lock();
-    // Make OpenCV mat from picture and allocate separately
-    PictureToRGBMat(p_filter, p_pic, RTSPframe);
-    // Set separated sub mat of each camera
-    BindStreamStitcherInputBuf();
-    mtxBuf.unlock();
-    isFrameAvailable = true;
+    p_engine->mtxBuf.lock();
+    if(planar) {
+        // Use the input planes as they are
+        HoldInputPlanes(p_filter, p_pic);
+    } else {
+        // Make OpenCV mat from picture and allocate separately
+        PictureToRGBMat(p_filter, p_pic, p_engine->RTSPframe);
+        // Set separated sub mat of each camera
+        p_engine->BindStreamStitcherInputBuf();
+    }
+    p_engine->isFramePlanar = planar;
+    p_engine->mtxBuf.unlock();
+
+    if(planar) {
+        // Render scene of current input straight into the output planes
+        Mat destPlanes[3];
+        for(int i = 0; i < 3; i++)
+            destPlanes[i] = PlaneToMat(&p_outpic->p[i]);
+        p_engine->FramePlanesRender(destPlanes);
+        picture_CopyProperties(p_outpic, p_pic);
+    } else {
+        // Prepare dest picture on which we draw
+        PrepareDestPicture(p_filter, p_pic, p_engine->RTSPframe_result);
 
-    // Prepare dest picture on which we draw
-    PrepareDestPicture(p_filter, p_pic, RTSPframe_result);
+        // Render scene of current input
+        p_engine->FrameRender(p_pic->date);
 
-    // Render scene of current input
-    FrameRender();
+        // Make output picture(YUV) from dest picture(RGB)
+        PrepareResultPicture(p_filter, p_pic, p_outpic);
+    }
 
-    // Make output picture(YUV) from dest picture(RGB)
-    PrepareResultPicture(p_filter, p_pic, p_outpic);
+    // Calibrate against this frame if the seam drifted
+    p_engine->ScheduleCalibration();
 
     // Release current output buffer and Mat
     ReleaseImages(p_filter);
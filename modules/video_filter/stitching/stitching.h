@@ -4,55 +4,101 @@
 #ifdef __MINGW32__
 #include "mingw.thread.h"
 #include "mingw.mutex.h"
+#include "mingw.condition_variable.h"
 #else
 #include <thread>
 #include <mutex>
+#include <condition_variable>
 #endif
+#include <atomic>
+#include <chrono>
+#include <memory>
 
 using namespace std;
 using namespace cv;
 
-static unsigned long long frame = 0;
-static bool stitcherInitDone = false;
+// One stitching instance: input/output frame buffers and stitching
+// parameters. Each filter owns its own engine, parameter calculation runs
+// on the process-wide CalibScheduler pool.
+class StitchEngine
+{
+public:
+    StitchEngine();
+    ~StitchEngine();
 
-// Mutexes for Rendering
-static std::mutex mtxBuf;
-static std::mutex mtxResultBuf;
-static std::mutex mtxFrontDraw;
-static std::mutex mtxRearDraw;
+    void InitStreamStitcher(int srcWidth, int srcHeight, int outWidth, int outHeight, string fType, int interval = 2000/*recalculation interval in ms*/, bool bFaceDetectON = false);
+    void RunStreamStitcher();
+    void StopStreamStitcher();
+    void BindStreamStitcherInputBuf();
+    // Calibration cache file, loaded by RunStreamStitcher() (empty = off)
+    void SetCalibCache(const string& path) { cachePath = path; }
+    // Submit calculation jobs for the current input if needed
+    void ScheduleCalibration();
 
-static Mat RTSPframe;
-static Mat RTSPframe_result;
+    // Internal Rendering routine for stitching front & rear and merge it to one,
+    // pts (us) of the frame tags it for face detection
+    void FrameRender(int64_t pts);
+    void FramePlanesRender(Mat destPlanes[]);
 
-// PartFrames
-/*-----------------*/
-/*|   0   |   1   |*/
-/*|----------------*/
-/*|   2   |   3   |*/
-/*|----------------*/
-static Mat partFrames[4];
-static bool isFrameAvailable = false;
-static bool isParamAvailable[CAMDIR_END] = {false, false};
+    bool isFaceDetectEnabled() const { return bFaceDetect; }
 
-static short padding = 0;
-static int recalc_interval = 2000; /*ms*/
+    // Mutex for the input buffers below
+    std::mutex mtxBuf;
 
-// Enable face detection
-static bool bFaceDetect = false;
+    Mat RTSPframe;
+    Mat RTSPframe_result;
 
-void InitStreamStitcher(int srcWidth, int srcHeight, int outWidth, int outHeight, string fType, int interval = 2000/*recalculation interval in ms*/, bool bFaceDetectON = false);
-void RunStreamStitcher();
-void BindStreamStitcherInputBuf();
+    // Planes of the input picture when rendering 4:2:0 input directly (Y, U, V)
+    Mat RTSPplanes[3];
+    bool isFramePlanar;
 
-// Internal Rendering routine for stitching front & rear and merge it to one
-void FrameRender();
+private:
+    // Parameter calcuation job, runs on a scheduler worker
+    void CalibrationJob(camDir_t seq);
+    void UpdateSeamDrift(camDir_t seq, Mat srcImg[]);
+    void ClonePartFrames(int idx, Mat& left, Mat& right);
+    Mat CloneLensPlanesToBGR(int idx);
+    void StoreCalibCache(camDir_t seq);
 
-// Threading for parameter calcuation
-static void _CalcFrontThread();
-static void _CalcRearThread();
+    StitchCore core;
+    FaceDetector faceDetector;
 
-std::thread stitchFrontThread;
-std::thread stitchRearThread;
-std::thread faceDetectThread;
+    // PartFrames
+    /*-----------------*/
+    /*|   0   |   1   |*/
+    /*|----------------*/
+    /*|   2   |   3   |*/
+    /*|----------------*/
+    Mat partFrames[4];
+    std::atomic<bool> isParamAvailable[CAMDIR_END];
+    // Set by the render loop when the seam drifted, or cannot be checked
+    std::atomic<bool> needCalib[CAMDIR_END];
+
+    // Calibration cache, records protected by mtxCache
+    string cachePath;
+    std::mutex mtxCache;
+    stCalibRecord cached[CAMDIR_END];
+    bool cachedValid[CAMDIR_END];
+
+    Size lensSize;
+    unsigned long long frame;
+    short padding;
+    int recalc_interval; /*minimum ms between two updates*/
+
+    // Enable face detection
+    bool bFaceDetect;
+
+    std::atomic<bool> bStop;
+
+    // Calculation jobs in flight, protected by mtxJobs
+    std::shared_ptr<CalibScheduler> scheduler;
+    std::mutex mtxJobs;
+    std::condition_variable condJobs;
+    bool pending[CAMDIR_END];
+    int inFlight;
+    // End of the last job, published or not, and jobs failed in a row
+    std::chrono::steady_clock::time_point lastCalib[CAMDIR_END];
+    int calibFailures[CAMDIR_END];
+};
 
 #endif // _STITCH_H_
@@ -323,11 +323,14 @@ struct opengl_tex_converter_t
     struct {
         GLint mixRatioFront; // mixture ratio between front cameras(0.0 ~ 0.25, 0.25 to whole overlap)
         GLint mixRatioRear;  // mixture ratio between rear cameras(0.0 ~ 0.25, 0.25 to whole overlap)
-        GLint fitToDisplay;  // fit alpha blended image to display width
-        GLint showDivider;   // show horizontal/vertical divider between cameras
-        GLint enableBlend;   // Alpha blending enabled (start rendering with rear camera swapping)
     } uAlphaBlendParams;
 
+    /* Alpha blend parameters, kept up to date by variable callbacks so that
+     * pf_prepare_shader only uploads them after a change. The boolean options
+     * are compiled in the shader instead, see opengl_alpha_blend_outdated().
+     * NULL if the alpha blend shader is not used. */
+    struct opengl_alpha_blend *alpha_blend;
+
     bool yuv_color;
     GLfloat yuv_coefficients[16];
 
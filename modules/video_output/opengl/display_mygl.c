@@ -31,6 +31,7 @@
 #include <vlc_plugin.h>
 #include <vlc_vout_display.h>
 #include <vlc_opengl.h>
+#include <vlc_picture_pool.h>
 #include "vout_helper.h"
 
 /* Plugin callbacks */
@@ -50,6 +51,27 @@ static void Close (vlc_object_t *);
 #define ALPHABLEND_PROJECTION_FITTODISPLAY_TEXT N_("Enable fitting to display after alpha blend")
 #define ALPHABLEND_PROJECTION_ENABLE_TEXT N_("Enable alpha blend")
 #define ALPHABLEND_PROJECTION_SHOW_DIVIDER_TEXT N_("Show camera divider")
+#define MOSAIC_TEXT N_("Mosaic name")
+#define MOSAIC_LONGTEXT N_( \
+    "Players of the process using the same mosaic name are drawn as tiles " \
+    "of one OpenGL output, in the window of the first of them, with a " \
+    "single pass and a single swap. Empty to use a display of its own.")
+#define MOSAIC_COLS_TEXT N_("Mosaic columns")
+#define MOSAIC_ROWS_TEXT N_("Mosaic rows")
+#define MOSAIC_TILE_TEXT N_("Mosaic tile")
+#define MOSAIC_TILE_LONGTEXT N_( \
+    "Tile of the mosaic, in row order. -1 takes the first free one.")
+#define MOSAIC_FPS_TEXT N_("Mosaic refresh rate")
+#define MOSAIC_FPS_LONGTEXT N_( \
+    "Maximum number of mosaic redraws per second, whatever the number of " \
+    "tiles.")
+
+#define add_mosaic_opts() \
+    add_string("mygl-mosaic", "", MOSAIC_TEXT, MOSAIC_LONGTEXT, true) \
+    add_integer_with_range("mygl-mosaic-cols", 4, 1, 16, MOSAIC_COLS_TEXT, MOSAIC_COLS_TEXT, true) \
+    add_integer_with_range("mygl-mosaic-rows", 4, 1, 16, MOSAIC_ROWS_TEXT, MOSAIC_ROWS_TEXT, true) \
+    add_integer("mygl-mosaic-tile", -1, MOSAIC_TILE_TEXT, MOSAIC_TILE_LONGTEXT, true) \
+    add_float_with_range("mygl-mosaic-fps", 30.f, 1.f, 240.f, MOSAIC_FPS_TEXT, MOSAIC_FPS_LONGTEXT, true)
 
 vlc_module_begin ()
 #if defined (USE_OPENGL_ES2)
@@ -93,14 +115,21 @@ vlc_module_begin ()
     add_shortcut ("myopengl", "mygl")
     add_module("mygl", "myopengl", NULL, GL_TEXT, PROVIDER_LONGTEXT)
 #endif
+    add_mosaic_opts ()
     add_glopts ()
 vlc_module_end ()
 
+typedef struct mosaic mosaic_t;
+
 struct vout_display_sys_t
 {
     vout_display_opengl_t *vgl;
     vlc_gl_t *gl;
     picture_pool_t *pool;
+
+    /* Mosaic tile mode */
+    mosaic_t *mosaic;
+    unsigned tile;
 };
 
 /* Display callbacks */
@@ -109,18 +138,31 @@ static void PictureRender (vout_display_t *, picture_t *, subpicture_t *, vlc_ti
 static void PictureDisplay (vout_display_t *, picture_t *, subpicture_t *);
 static int Control (vout_display_t *, int, va_list);
 
+static int OpenTile (vout_display_t *, const char *);
+
 /**
  * Allocates a surface and an OpenGL context for video output.
  */
 static int Open (vlc_object_t *obj)
 {
     vout_display_t *vd = (vout_display_t *)obj;
+
+    char *mosaic_name = var_InheritString(vd, "mygl-mosaic");
+    if (mosaic_name != NULL && mosaic_name[0] != '\0')
+    {
+        int ret = OpenTile(vd, mosaic_name);
+        free(mosaic_name);
+        return ret;
+    }
+    free(mosaic_name);
+
     vout_display_sys_t *sys = malloc (sizeof (*sys));
     if (unlikely(sys == NULL))
         return VLC_ENOMEM;
 
     sys->gl = NULL;
     sys->pool = NULL;
+    sys->mosaic = NULL;
 
     vout_window_t *surface = vd->cfg->window;
     char *gl_name = var_InheritString(surface, MODULE_VARNAME);
@@ -187,6 +229,8 @@ error:
     return VLC_EGENERIC;
 }
 
+static void CloseTile (vout_display_t *);
+
 /**
  * Destroys the OpenGL context.
  */
@@ -196,6 +240,12 @@ static void Close (vlc_object_t *obj)
     vout_display_sys_t *sys = vd->sys;
     vlc_gl_t *gl = sys->gl;
 
+    if (sys->mosaic != NULL)
+    {
+        CloseTile(vd);
+        return;
+    }
+
     vlc_gl_MakeCurrent (gl);
     vout_display_opengl_Delete (sys->vgl);
     vlc_gl_ReleaseCurrent (gl);
@@ -304,3 +354,545 @@ static int Control (vout_display_t *vd, int query, va_list ap)
     }
     return VLC_EGENERIC;
 }
+
+/*****************************************************************************
+ * Mosaic: displays drawn as the tiles of one shared OpenGL output
+ *****************************************************************************/
+struct mosaic
+{
+    char *name;
+    unsigned refs; /* protected by mosaics_lock */
+    mosaic_t *next;
+
+    unsigned cols, rows;
+    vlc_tick_t interval;
+    video_format_t fmt; /* of the whole canvas, cols x rows I420 tiles */
+
+    vlc_mutex_t lock;
+    picture_t **pics;        /* cols * rows, last picture of each tile */
+    bool *dirty;             /* cols * rows, tiles to upload */
+    vout_display_t **tiles;  /* cols * rows, NULL if free */
+
+    /* GL output, in the window of one of the tiles. Whoever holds gl_lock
+     * draws, the other tiles only copy their picture in their tile. */
+    vlc_mutex_t gl_lock;
+    vout_display_t *owner;
+    vlc_gl_t *gl;
+    vout_display_opengl_t *vgl;
+    vlc_tick_t next_display; /* deadline of the next redraw */
+    vlc_timer_t timer;       /* draws the tiles left dirty by a pass */
+};
+
+static vlc_mutex_t mosaics_lock = VLC_STATIC_MUTEX;
+static mosaic_t *mosaics = NULL;
+
+static void MosaicClearTile(mosaic_t *m, unsigned tile)
+{
+    picture_t *pic = m->pics[tile];
+
+    for (int i = 0; i < pic->i_planes; i++)
+    {
+        const plane_t *p = &pic->p[i];
+        for (int y = 0; y < p->i_visible_lines; y++)
+            memset(&p->p_pixels[y * p->i_pitch], i == 0 ? 0x10 : 0x80,
+                   p->i_visible_pitch);
+    }
+    m->dirty[tile] = true;
+}
+
+static void MosaicFreePictures(mosaic_t *m)
+{
+    for (unsigned i = 0; i < m->cols * m->rows && m->pics[i] != NULL; i++)
+        picture_Release(m->pics[i]);
+    free(m->pics);
+}
+
+/* Draws the dirty tiles, with gl_lock held. The tiles left dirty, held back
+ * by the rate limit or drawn after the pass, are drawn by the timer even if
+ * no tile displays a picture anymore. */
+static void MosaicRedraw(mosaic_t *m)
+{
+    const vlc_tick_t now = vlc_tick_now();
+    bool draw = false;
+
+    /* Pictures of sources at the mosaic rate arrive around the deadline,
+     * some a bit early: half an interval of tolerance */
+    if (m->gl != NULL && now + m->interval / 2 >= m->next_display
+     && vlc_gl_MakeCurrent (m->gl) == VLC_SUCCESS)
+    {
+        /* Only the tiles drawn since the last pass are uploaded */
+        vlc_mutex_lock(&m->lock);
+        for (unsigned i = 0; i < m->cols * m->rows; i++)
+        {
+            if (!m->dirty[i])
+                continue;
+
+            const picture_t *tile = m->pics[i];
+            vout_display_opengl_PrepareTile (m->vgl, tile,
+                (i % m->cols) * tile->format.i_visible_width,
+                (i / m->cols) * tile->format.i_visible_height);
+            m->dirty[i] = false;
+            draw = true;
+        }
+        vlc_mutex_unlock(&m->lock);
+
+        if (draw)
+        {
+            vout_display_opengl_Display (m->vgl, &m->fmt);
+            m->next_display += m->interval;
+            if (m->next_display < now) /* far behind, or idle */
+                m->next_display = now + m->interval;
+        }
+        vlc_gl_ReleaseCurrent (m->gl);
+    }
+
+    if (m->gl == NULL)
+        return; /* the next tile to display attaches and draws */
+
+    bool pending = false;
+    vlc_mutex_lock(&m->lock);
+    for (unsigned i = 0; i < m->cols * m->rows && !pending; i++)
+        pending = m->dirty[i];
+    vlc_mutex_unlock(&m->lock);
+
+    if (pending)
+    {
+        vlc_tick_t date = m->next_display - m->interval / 2;
+        if (date <= now)
+            date = now + m->interval;
+        vlc_timer_schedule(m->timer, true, date, 0);
+    }
+}
+
+static void MosaicTimer(void *data)
+{
+    mosaic_t *m = data;
+
+    vlc_mutex_lock(&m->gl_lock);
+    MosaicRedraw(m);
+    vlc_mutex_unlock(&m->gl_lock);
+}
+
+/* Finds or creates the mosaic of the given name, with mosaics_lock held */
+static mosaic_t *MosaicGet(vout_display_t *vd, const char *name)
+{
+    for (mosaic_t *m = mosaics; m != NULL; m = m->next)
+    {
+        if (strcmp(m->name, name) == 0)
+        {
+            m->refs++;
+            return m;
+        }
+    }
+
+    const unsigned cols = var_InheritInteger(vd, "mygl-mosaic-cols");
+    const unsigned rows = var_InheritInteger(vd, "mygl-mosaic-rows");
+
+    /* The first player sets the tile aspect, scaled down to its cell of the
+     * output so that the canvas stays within the display (and the GL texture
+     * size) whatever the sources; the core scales the pictures of every
+     * player to the tile size */
+    unsigned width = vd->source.i_visible_width;
+    unsigned height = vd->source.i_visible_height;
+    const unsigned cell_width = vd->cfg->display.width / cols;
+    const unsigned cell_height = vd->cfg->display.height / rows;
+
+    if (width == 0 || height == 0)
+        return NULL;
+    if (cell_width > 0 && cell_height > 0
+     && (width > cell_width || height > cell_height))
+    {
+        if ((uint64_t)width * cell_height > (uint64_t)height * cell_width)
+        {
+            height = (uint64_t)height * cell_width / width;
+            width = cell_width;
+        }
+        else
+        {
+            width = (uint64_t)width * cell_height / height;
+            height = cell_height;
+        }
+    }
+    /* Rows of every plane tightly packed: one upload per plane and tile */
+    width &= ~31;
+    height &= ~1;
+    if (width == 0 || height == 0)
+        return NULL;
+
+    mosaic_t *m = malloc(sizeof (*m));
+    if (unlikely(m == NULL))
+        return NULL;
+
+    m->cols = cols;
+    m->rows = rows;
+    m->interval = CLOCK_FREQ / var_InheritFloat(vd, "mygl-mosaic-fps");
+
+    video_format_t tile_fmt;
+    video_format_Init(&tile_fmt, VLC_CODEC_I420);
+    tile_fmt.i_width  = tile_fmt.i_visible_width  = width;
+    tile_fmt.i_height = tile_fmt.i_visible_height = height;
+    tile_fmt.i_sar_num = tile_fmt.i_sar_den = 1;
+
+    m->fmt = tile_fmt;
+    m->fmt.i_width  = m->fmt.i_visible_width  = cols * width;
+    m->fmt.i_height = m->fmt.i_visible_height = rows * height;
+
+    m->name = strdup(name);
+    m->pics = calloc(cols * rows, sizeof (*m->pics));
+    m->dirty = calloc(cols * rows, sizeof (*m->dirty));
+    m->tiles = calloc(cols * rows, sizeof (*m->tiles));
+    if (m->name == NULL || m->pics == NULL || m->dirty == NULL
+     || m->tiles == NULL)
+        goto error;
+    for (unsigned i = 0; i < cols * rows; i++)
+    {
+        m->pics[i] = picture_NewFromFormat(&tile_fmt);
+        if (m->pics[i] == NULL)
+            goto error;
+        MosaicClearTile(m, i);
+    }
+
+    if (vlc_timer_create(&m->timer, MosaicTimer, m))
+        goto error;
+
+    vlc_mutex_init(&m->lock);
+    vlc_mutex_init(&m->gl_lock);
+    m->owner = NULL;
+    m->gl = NULL;
+    m->vgl = NULL;
+    m->next_display = 0;
+
+    m->refs = 1;
+    m->next = mosaics;
+    mosaics = m;
+    return m;
+
+error:
+    if (m->pics != NULL)
+        MosaicFreePictures(m);
+    free(m->tiles);
+    free(m->dirty);
+    free(m->name);
+    free(m);
+    return NULL;
+}
+
+/* Drops a reference, with mosaics_lock held */
+static void MosaicRelease(mosaic_t *m)
+{
+    if (--m->refs > 0)
+        return;
+
+    for (mosaic_t **pp = &mosaics; *pp != NULL; pp = &(*pp)->next)
+    {
+        if (*pp == m)
+        {
+            *pp = m->next;
+            break;
+        }
+    }
+
+    assert(m->gl == NULL);
+    vlc_timer_destroy(m->timer);
+    vlc_mutex_destroy(&m->gl_lock);
+    vlc_mutex_destroy(&m->lock);
+    MosaicFreePictures(m);
+    free(m->tiles);
+    free(m->dirty);
+    free(m->name);
+    free(m);
+}
+
+/* Places the canvas in the output, with the context current */
+static void MosaicPlace(mosaic_t *m, const vout_display_cfg_t *cfg)
+{
+    vout_display_cfg_t c = *cfg;
+    vout_display_place_t place;
+
+    /* Reverse vertical alignment as the GL tex are Y inverted */
+    if (c.align.vertical == VOUT_DISPLAY_ALIGN_TOP)
+        c.align.vertical = VOUT_DISPLAY_ALIGN_BOTTOM;
+    else if (c.align.vertical == VOUT_DISPLAY_ALIGN_BOTTOM)
+        c.align.vertical = VOUT_DISPLAY_ALIGN_TOP;
+
+    vout_display_PlacePicture (&place, &m->fmt, &c, false);
+    vout_display_opengl_SetWindowAspectRatio(m->vgl, (float)place.width / place.height);
+    vout_display_opengl_Viewport(m->vgl, place.x, place.y, place.width, place.height);
+}
+
+/* Creates the GL output in the window of a tile, with gl_lock held */
+static int MosaicAttach(mosaic_t *m, vout_display_t *vd)
+{
+    vout_window_t *surface = vd->cfg->window;
+    char *gl_name = var_InheritString(surface, MODULE_VARNAME);
+    vlc_gl_t *gl = vlc_gl_Create (surface, API, gl_name);
+    free(gl_name);
+    if (gl == NULL)
+        return VLC_EGENERIC;
+
+    /* The alpha blend geometry applies to each tile of the canvas */
+    var_Create(gl, "alpha-blend-grid-cols", VLC_VAR_INTEGER);
+    var_SetInteger(gl, "alpha-blend-grid-cols", m->cols);
+    var_Create(gl, "alpha-blend-grid-rows", VLC_VAR_INTEGER);
+    var_SetInteger(gl, "alpha-blend-grid-rows", m->rows);
+
+    vlc_gl_Resize (gl, vd->cfg->display.width, vd->cfg->display.height);
+    if (vlc_gl_MakeCurrent (gl))
+    {
+        vlc_gl_Release (gl);
+        return VLC_EGENERIC;
+    }
+
+    const vlc_fourcc_t *spu_chromas;
+    video_format_t fmt = m->fmt;
+    vout_display_opengl_t *vgl =
+        vout_display_opengl_New (&fmt, &spu_chromas, gl, &vd->cfg->viewpoint);
+    if (vgl != NULL && fmt.i_chroma != m->fmt.i_chroma)
+    {
+        msg_Err(vd, "mosaic needs %4.4s textures", (const char *)&m->fmt.i_chroma);
+        vout_display_opengl_Delete (vgl);
+        vgl = NULL;
+    }
+    /* Shrunk to GL_MAX_TEXTURE_SIZE: the tiles would not fit */
+    if (vgl != NULL && (fmt.i_width != m->fmt.i_width
+                     || fmt.i_height != m->fmt.i_height))
+    {
+        msg_Err(vd, "mosaic canvas %ux%u too large for the GL textures",
+                m->fmt.i_width, m->fmt.i_height);
+        vout_display_opengl_Delete (vgl);
+        vgl = NULL;
+    }
+    if (vgl != NULL)
+    {
+        m->vgl = vgl;
+        MosaicPlace(m, vd->cfg);
+    }
+    vlc_gl_ReleaseCurrent (gl);
+
+    if (vgl == NULL)
+    {
+        vlc_gl_Release (gl);
+        return VLC_EGENERIC;
+    }
+
+    /* New textures: every tile is uploaded again */
+    vlc_mutex_lock(&m->lock);
+    for (unsigned i = 0; i < m->cols * m->rows; i++)
+        m->dirty[i] = true;
+    vlc_mutex_unlock(&m->lock);
+
+    m->gl = gl;
+    m->owner = vd;
+    msg_Dbg(vd, "drawing mosaic %s (%ux%u tiles)", m->name, m->cols, m->rows);
+    return VLC_SUCCESS;
+}
+
+/* Destroys the GL output, with gl_lock held */
+static void MosaicDetach(mosaic_t *m)
+{
+    vlc_gl_MakeCurrent (m->gl);
+    vout_display_opengl_Delete (m->vgl);
+    vlc_gl_ReleaseCurrent (m->gl);
+    vlc_gl_Release (m->gl);
+
+    m->vgl = NULL;
+    m->gl = NULL;
+    m->owner = NULL;
+}
+
+static picture_pool_t *TilePool (vout_display_t *, unsigned);
+static void TileRender (vout_display_t *, picture_t *, subpicture_t *, vlc_tick_t);
+static void TileDisplay (vout_display_t *, picture_t *, subpicture_t *);
+static int TileControl (vout_display_t *, int, va_list);
+
+/**
+ * Registers the display as a tile of a mosaic. The GL output is created by
+ * the first tile to display a picture, in its own window.
+ */
+static int OpenTile (vout_display_t *vd, const char *name)
+{
+    vout_display_sys_t *sys = malloc (sizeof (*sys));
+    if (unlikely(sys == NULL))
+        return VLC_ENOMEM;
+
+    vlc_mutex_lock(&mosaics_lock);
+    mosaic_t *m = MosaicGet(vd, name);
+    if (m == NULL)
+    {
+        vlc_mutex_unlock(&mosaics_lock);
+        free(sys);
+        return VLC_EGENERIC;
+    }
+
+    const unsigned count = m->cols * m->rows;
+    int64_t tile = var_InheritInteger(vd, "mygl-mosaic-tile");
+
+    vlc_mutex_lock(&m->lock);
+    if (tile < 0)
+        for (tile = 0; tile < count && m->tiles[tile] != NULL; tile++);
+    if (tile >= count || m->tiles[tile] != NULL)
+    {
+        vlc_mutex_unlock(&m->lock);
+        msg_Err(vd, "no free tile in mosaic %s", name);
+        MosaicRelease(m);
+        vlc_mutex_unlock(&mosaics_lock);
+        free(sys);
+        return VLC_EGENERIC;
+    }
+    m->tiles[tile] = vd;
+    vlc_mutex_unlock(&m->lock);
+    vlc_mutex_unlock(&mosaics_lock);
+
+    sys->vgl = NULL;
+    sys->gl = NULL;
+    sys->pool = NULL;
+    sys->mosaic = m;
+    sys->tile = tile;
+
+    /* The core converts the pictures to the tile format */
+    video_format_t fmt = vd->fmt;
+    fmt.i_chroma = m->fmt.i_chroma;
+    fmt.i_width  = fmt.i_visible_width  = m->pics[tile]->format.i_visible_width;
+    fmt.i_height = fmt.i_visible_height = m->pics[tile]->format.i_visible_height;
+    fmt.i_x_offset = fmt.i_y_offset = 0;
+    fmt.orientation = ORIENT_NORMAL;
+    fmt.projection_mode = PROJECTION_MODE_RECTANGULAR;
+    vd->fmt = fmt;
+
+    msg_Dbg(vd, "tile %u of mosaic %s", sys->tile, name);
+
+    vd->sys = sys;
+    vd->info.has_pictures_invalid = false;
+    vd->info.subpicture_chromas = NULL;
+    vd->pool = TilePool;
+    vd->prepare = TileRender;
+    vd->display = TileDisplay;
+    vd->control = TileControl;
+    return VLC_SUCCESS;
+}
+
+static void CloseTile (vout_display_t *vd)
+{
+    vout_display_sys_t *sys = vd->sys;
+    mosaic_t *m = sys->mosaic;
+
+    /* The next tile to display takes over, in its own window */
+    vlc_mutex_lock(&m->gl_lock);
+    if (m->owner == vd)
+        MosaicDetach(m);
+    vlc_mutex_unlock(&m->gl_lock);
+
+    vlc_mutex_lock(&m->lock);
+    m->tiles[sys->tile] = NULL;
+    MosaicClearTile(m, sys->tile);
+    vlc_mutex_unlock(&m->lock);
+
+    vlc_mutex_lock(&mosaics_lock);
+    MosaicRelease(m);
+    vlc_mutex_unlock(&mosaics_lock);
+
+    if (sys->pool != NULL)
+        picture_pool_Release(sys->pool);
+    free (sys);
+}
+
+static picture_pool_t *TilePool (vout_display_t *vd, unsigned count)
+{
+    vout_display_sys_t *sys = vd->sys;
+
+    if (!sys->pool)
+        sys->pool = picture_pool_NewFromFormat(&vd->fmt, count);
+    return sys->pool;
+}
+
+static void TileRender (vout_display_t *vd, picture_t *pic, subpicture_t *subpicture,
+                        vlc_tick_t date)
+{
+    VLC_UNUSED(subpicture); VLC_UNUSED(date);
+    vout_display_sys_t *sys = vd->sys;
+    mosaic_t *m = sys->mosaic;
+
+    vlc_mutex_lock(&m->lock);
+    picture_CopyPixels(m->pics[sys->tile], pic);
+    m->dirty[sys->tile] = true;
+    vlc_mutex_unlock(&m->lock);
+}
+
+static void TileDisplay (vout_display_t *vd, picture_t *pic, subpicture_t *subpicture)
+{
+    vout_display_sys_t *sys = vd->sys;
+    mosaic_t *m = sys->mosaic;
+
+    /* If another tile is drawing, it checks the dirty tiles again before
+     * unlocking: its pass or the timer shows this picture. At most one
+     * redraw per interval for all the tiles. */
+    if (vlc_mutex_trylock(&m->gl_lock) == 0)
+    {
+        if (m->gl == NULL && MosaicAttach(m, vd) != VLC_SUCCESS)
+            msg_Err(vd, "cannot draw mosaic %s", m->name);
+
+        MosaicRedraw(m);
+        vlc_mutex_unlock(&m->gl_lock);
+    }
+
+    picture_Release (pic);
+    if (subpicture != NULL)
+        subpicture_Delete(subpicture);
+}
+
+static int TileControl (vout_display_t *vd, int query, va_list ap)
+{
+    vout_display_sys_t *sys = vd->sys;
+    mosaic_t *m = sys->mosaic;
+    int ret = VLC_SUCCESS;
+
+    switch (query)
+    {
+#ifndef NDEBUG
+      case VOUT_DISPLAY_RESET_PICTURES: // not needed
+        vlc_assert_unreachable();
+#endif
+
+      case VOUT_DISPLAY_CHANGE_DISPLAY_SIZE:
+      case VOUT_DISPLAY_CHANGE_DISPLAY_FILLED:
+      case VOUT_DISPLAY_CHANGE_ZOOM:
+      {
+        const vout_display_cfg_t *cfg = va_arg (ap, const vout_display_cfg_t *);
+
+        /* Only the window holding the output matters */
+        vlc_mutex_lock(&m->gl_lock);
+        if (m->owner == vd)
+        {
+            vlc_gl_Resize (m->gl, cfg->display.width, cfg->display.height);
+            if (vlc_gl_MakeCurrent (m->gl) == VLC_SUCCESS)
+            {
+                MosaicPlace(m, cfg);
+                vlc_gl_ReleaseCurrent (m->gl);
+            }
+            else
+                ret = VLC_EGENERIC;
+        }
+        vlc_mutex_unlock(&m->gl_lock);
+        return ret;
+      }
+
+      case VOUT_DISPLAY_CHANGE_SOURCE_ASPECT:
+      case VOUT_DISPLAY_CHANGE_SOURCE_CROP:
+        /* The tile keeps its place in the canvas */
+        return VLC_SUCCESS;
+
+      case VOUT_DISPLAY_CHANGE_VIEWPOINT:
+      {
+        const vout_display_cfg_t *cfg = va_arg (ap, const vout_display_cfg_t *);
+
+        vlc_mutex_lock(&m->gl_lock);
+        if (m->owner == vd)
+            ret = vout_display_opengl_SetViewpoint (m->vgl, &cfg->viewpoint);
+        vlc_mutex_unlock(&m->gl_lock);
+        return ret;
+      }
+      default:
+        msg_Err (vd, "Unknown request %d", query);
+    }
+    return VLC_EGENERIC;
+}
@@ -23,6 +23,7 @@
 #endif
 
 #include <assert.h>
+#include <stdatomic.h>
 #include <stdlib.h>
 
 #ifdef HAVE_LIBPLACEBO
@@ -32,6 +33,7 @@
 
 #include <vlc_common.h>
 #include <vlc_memstream.h>
+#include <vlc_vout_window.h>
 #include "internal.h"
 #include "vout_helper.h"
 
@@ -359,9 +361,6 @@ tc_base_fetch_locations(opengl_tex_converter_t *tc, GLuint program)
 
     tc->uAlphaBlendParams.mixRatioFront = tc->vt->GetUniformLocation(program, "mixRatioFront");
     tc->uAlphaBlendParams.mixRatioRear  = tc->vt->GetUniformLocation(program, "mixRatioRear");
-    tc->uAlphaBlendParams.fitToDisplay  = tc->vt->GetUniformLocation(program, "fitToDisplay");
-    tc->uAlphaBlendParams.showDivider   = tc->vt->GetUniformLocation(program, "showDivider");
-    tc->uAlphaBlendParams.enableBlend   = tc->vt->GetUniformLocation(program, "enableBlend");
 
 #ifdef HAVE_LIBPLACEBO
     const struct pl_shader_res *res = tc->pl_sh_res;
@@ -374,6 +373,178 @@ tc_base_fetch_locations(opengl_tex_converter_t *tc, GLuint program)
     return VLC_SUCCESS;
 }
 
+/* Alpha blend projection variables, in this order */
+static const char *const alpha_blend_vars[] = {
+    "alpha-blend-ratio-front",
+    "alpha-blend-ratio-rear",
+    "alpha-blend-fit-to-display",
+    "alpha-blend-show-divider",
+    "alpha-blend-enable-blend",
+};
+enum {
+    ALPHA_BLEND_RATIO_FRONT,
+    ALPHA_BLEND_RATIO_REAR,
+    ALPHA_BLEND_FIT_TO_DISPLAY,
+    ALPHA_BLEND_SHOW_DIVIDER,
+    ALPHA_BLEND_ENABLE_BLEND,
+    ALPHA_BLEND_VAR_COUNT
+};
+
+struct opengl_alpha_blend
+{
+    vlc_mutex_t lock;
+    vlc_value_t val[ALPHA_BLEND_VAR_COUNT]; /* protected by lock */
+    atomic_bool changed;
+    atomic_bool rebuild; /* a boolean option changed */
+    /* The vout, where the variables are created and always watched */
+    vlc_object_t *vout;
+    /* Nearest ancestor of the vout holding each variable, watched too */
+    vlc_object_t *owner[ALPHA_BLEND_VAR_COUNT];
+
+    /* Shader generation inputs, tex_target is 0 until they are set */
+    GLenum tex_target;
+    vlc_fourcc_t chroma;
+    video_color_space_t yuv_space;
+    bool is_yuv;
+    bool yuv_swap_uv;
+    const char *swizzle_per_tex[PICTURE_PLANE_MAX];
+    /* Boolean options the current shader was built for, and the ones of the
+     * shader before it until the new program is linked, protected by lock */
+    bool built[ALPHA_BLEND_VAR_COUNT];
+    bool previous[ALPHA_BLEND_VAR_COUNT];
+    /* Tiles of a mosaic canvas, each one is blended on its own */
+    unsigned grid_cols, grid_rows;
+};
+
+static int
+AlphaBlendVarCallback(vlc_object_t *obj, const char *name, vlc_value_t oldval,
+                      vlc_value_t newval, void *data)
+{
+    VLC_UNUSED(obj); VLC_UNUSED(oldval);
+    struct opengl_alpha_blend *ab = data;
+
+    for (unsigned i = 0; i < ALPHA_BLEND_VAR_COUNT; ++i)
+    {
+        if (strcmp(name, alpha_blend_vars[i]))
+            continue;
+        vlc_mutex_lock(&ab->lock);
+        ab->val[i] = newval;
+        vlc_mutex_unlock(&ab->lock);
+        if (i >= ALPHA_BLEND_FIT_TO_DISPLAY)
+            atomic_store(&ab->rebuild, true);
+        else
+            atomic_store(&ab->changed, true);
+        break;
+    }
+    return VLC_SUCCESS;
+}
+
+int
+opengl_alpha_blend_init(opengl_tex_converter_t *tc)
+{
+    struct opengl_alpha_blend *ab = malloc(sizeof(*ab));
+    if (ab == NULL)
+        return VLC_ENOMEM;
+
+    vlc_mutex_init(&ab->lock);
+    atomic_init(&ab->changed, true);
+    atomic_init(&ab->rebuild, false);
+    ab->tex_target = 0;
+
+    /* Set on the GL object by a mosaic display only */
+    ab->grid_cols = ab->grid_rows = 1;
+    if (var_Type(tc->gl, "alpha-blend-grid-cols") != 0
+     && var_Type(tc->gl, "alpha-blend-grid-rows") != 0)
+    {
+        int64_t cols = var_GetInteger(tc->gl, "alpha-blend-grid-cols");
+        int64_t rows = var_GetInteger(tc->gl, "alpha-blend-grid-rows");
+        if (cols > 0 && rows > 0)
+        {
+            ab->grid_cols = cols;
+            ab->grid_rows = rows;
+        }
+    }
+
+    /* The variables are created on the vout (the parent of the window), so
+     * they can be watched even when only the configuration holds them, or
+     * set on the vout later. The libvlc media player creates them too, the
+     * changes made there are watched as well. */
+    ab->vout = vlc_object_hold(tc->gl->surface->obj.parent);
+
+    for (unsigned i = 0; i < ALPHA_BLEND_VAR_COUNT; ++i)
+    {
+        const char *name = alpha_blend_vars[i];
+        const bool is_float = i == ALPHA_BLEND_RATIO_FRONT
+                           || i == ALPHA_BLEND_RATIO_REAR;
+
+        var_Create(ab->vout, name,
+                   (is_float ? VLC_VAR_FLOAT : VLC_VAR_BOOL) | VLC_VAR_DOINHERIT);
+        var_AddCallback(ab->vout, name, AlphaBlendVarCallback, ab);
+
+        vlc_object_t *obj = ab->vout->obj.parent;
+        while (obj != NULL && var_Type(obj, name) == 0)
+            obj = obj->obj.parent;
+        if (obj != NULL)
+        {
+            vlc_object_hold(obj);
+            var_AddCallback(obj, name, AlphaBlendVarCallback, ab);
+        }
+        ab->owner[i] = obj;
+
+        vlc_mutex_lock(&ab->lock);
+        if (is_float)
+            ab->val[i].f_float = var_GetFloat(ab->vout, name);
+        else
+            ab->val[i].b_bool = var_GetBool(ab->vout, name);
+        vlc_mutex_unlock(&ab->lock);
+    }
+
+    tc->alpha_blend = ab;
+    return VLC_SUCCESS;
+}
+
+void
+opengl_alpha_blend_clean(opengl_tex_converter_t *tc)
+{
+    struct opengl_alpha_blend *ab = tc->alpha_blend;
+    if (ab == NULL)
+        return;
+
+    for (unsigned i = 0; i < ALPHA_BLEND_VAR_COUNT; ++i)
+    {
+        var_DelCallback(ab->vout, alpha_blend_vars[i],
+                        AlphaBlendVarCallback, ab);
+        var_Destroy(ab->vout, alpha_blend_vars[i]);
+
+        if (ab->owner[i] == NULL)
+            continue;
+        var_DelCallback(ab->owner[i], alpha_blend_vars[i],
+                        AlphaBlendVarCallback, ab);
+        vlc_object_release(ab->owner[i]);
+    }
+    vlc_object_release(ab->vout);
+
+    vlc_mutex_destroy(&ab->lock);
+    free(ab);
+    tc->alpha_blend = NULL;
+}
+
+bool
+opengl_alpha_blend_outdated(opengl_tex_converter_t *tc)
+{
+    struct opengl_alpha_blend *ab = tc->alpha_blend;
+    if (ab == NULL || ab->tex_target == 0
+     || !atomic_exchange(&ab->rebuild, false))
+        return false;
+
+    bool outdated = false;
+    vlc_mutex_lock(&ab->lock);
+    for (unsigned i = ALPHA_BLEND_FIT_TO_DISPLAY; i < ALPHA_BLEND_VAR_COUNT; ++i)
+        outdated |= ab->val[i].b_bool != ab->built[i];
+    vlc_mutex_unlock(&ab->lock);
+    return outdated;
+}
+
 static void
 tc_base_prepare_shader(const opengl_tex_converter_t *tc,
                        const GLsizei *tex_width, const GLsizei *tex_height,
@@ -389,29 +560,19 @@ tc_base_prepare_shader(const opengl_tex_converter_t *tc,
 
     tc->vt->Uniform4f(tc->uloc.FillColor, 1.0f, 1.0f, 1.0f, alpha);
 
-    if(tc->uAlphaBlendParams.mixRatioFront != -1) {
-        float frontMix = var_InheritFloat(tc->gl, "alpha-blend-ratio-front");
-        tc->vt->Uniform1f(tc->uAlphaBlendParams.mixRatioFront, frontMix);
-    }
-
-    if(tc->uAlphaBlendParams.mixRatioRear != -1) {
-        float rearMix = var_InheritFloat(tc->gl, "alpha-blend-ratio-rear");
-        tc->vt->Uniform1f(tc->uAlphaBlendParams.mixRatioRear, rearMix);
-    }
-
-    if(tc->uAlphaBlendParams.fitToDisplay != -1) {
-        bool bFitToDisplay = var_InheritBool(tc->gl, "alpha-blend-fit-to-display");
-        tc->vt->Uniform1i(tc->uAlphaBlendParams.fitToDisplay, (int)bFitToDisplay);
-    }
-
-    if(tc->uAlphaBlendParams.showDivider != -1) {
-        bool bShowDivider = var_InheritBool(tc->gl, "alpha-blend-show-divider");
-        tc->vt->Uniform1i(tc->uAlphaBlendParams.showDivider, (int)bShowDivider);
-    }
-
-    if(tc->uAlphaBlendParams.enableBlend != -1) {
-        bool bEnableBlend = var_InheritBool(tc->gl, "alpha-blend-enable-blend");
-        tc->vt->Uniform1i(tc->uAlphaBlendParams.enableBlend, (int)bEnableBlend);
+    /* Uniforms keep their value in the program, only upload changes */
+    struct opengl_alpha_blend *ab = tc->alpha_blend;
+    if (ab != NULL && atomic_exchange(&ab->changed, false))
+    {
+        vlc_value_t val[ALPHA_BLEND_VAR_COUNT];
+        vlc_mutex_lock(&ab->lock);
+        memcpy(val, ab->val, sizeof(val));
+        vlc_mutex_unlock(&ab->lock);
+
+        if(tc->uAlphaBlendParams.mixRatioFront != -1)
+            tc->vt->Uniform1f(tc->uAlphaBlendParams.mixRatioFront, val[ALPHA_BLEND_RATIO_FRONT].f_float);
+        if(tc->uAlphaBlendParams.mixRatioRear != -1)
+            tc->vt->Uniform1f(tc->uAlphaBlendParams.mixRatioRear, val[ALPHA_BLEND_RATIO_REAR].f_float);
     }
 
     if (tc->tex_target == GL_TEXTURE_RECTANGLE)
@@ -832,11 +993,12 @@ GLuint
 opengl_fragment_shader_init_impl_for_alpha_blend(opengl_tex_converter_t *tc, GLenum tex_target,
                                  vlc_fourcc_t chroma, video_color_space_t yuv_space)
 {
-    const char *swizzle_per_tex[PICTURE_PLANE_MAX] = { NULL, };
+    struct opengl_alpha_blend *ab = tc->alpha_blend;
     const bool is_yuv = vlc_fourcc_IsYUV(chroma);
-    bool yuv_swap_uv = false;
     int ret;
 
+    assert(ab != NULL);
+
     const vlc_chroma_description_t *desc = vlc_fourcc_GetChromaDescription(chroma);
     if (desc == NULL)
         return VLC_EGENERIC;
@@ -844,44 +1006,17 @@ opengl_fragment_shader_init_impl_for_alpha_blend(opengl_tex_converter_t *tc, GLe
     if (chroma == VLC_CODEC_XYZ12)
         return xyz12_shader_init(tc);
 
+    memset(ab->swizzle_per_tex, 0, sizeof(ab->swizzle_per_tex));
+    ab->yuv_swap_uv = false;
     if (is_yuv)
-        ret = tc_yuv_base_init(tc, tex_target, chroma, desc, yuv_space, &yuv_swap_uv, swizzle_per_tex);
+        ret = tc_yuv_base_init(tc, tex_target, chroma, desc, yuv_space,
+                               &ab->yuv_swap_uv, ab->swizzle_per_tex);
     else
         ret = tc_rgb_base_init(tc, tex_target, chroma);
 
     if (ret != VLC_SUCCESS)
         return 0;
 
-    const char *sampler, *lookup, *coord_name;
-    switch (tex_target)
-    {
-        case GL_TEXTURE_2D:
-            sampler = "sampler2D";
-            lookup  = "texture2D";
-            coord_name = "TexCoord";
-            break;
-        case GL_TEXTURE_RECTANGLE:
-            sampler = "sampler2DRect";
-            lookup  = "texture2DRect";
-            coord_name = "TexCoordRect";
-            break;
-        default:
-            vlc_assert_unreachable();
-    }
-
-    struct vlc_memstream ms;
-    if (vlc_memstream_open(&ms) != 0)
-        return 0;
-
-#define ADD(x) vlc_memstream_puts(&ms, x)
-#define ADDF(x, ...) vlc_memstream_printf(&ms, x, ##__VA_ARGS__)
-
-    ADDF("#version %u\n%s", tc->glsl_version, tc->glsl_precision_header);
-
-    for (unsigned i = 0; i < tc->tex_count; ++i)
-        ADDF("uniform %s Texture%u;\n"
-             "varying vec2 TexCoord%u;\n", sampler, i, i);
-
 #ifdef HAVE_LIBPLACEBO
     if (tc->pl_sh) {
         struct pl_shader *sh = tc->pl_sh;
@@ -934,21 +1069,10 @@ opengl_fragment_shader_init_impl_for_alpha_blend(opengl_tex_converter_t *tc, GLe
 
         FREENULL(tc->uloc.pl_vars);
         tc->uloc.pl_vars = calloc(res->num_variables, sizeof(GLint));
-        for (int i = 0; i < res->num_variables; i++) {
-            struct pl_shader_var sv = res->variables[i];
-#if PL_API_VER >= 4
-            const char *glsl_type_name = pl_var_glsl_type_name(sv.var);
-#else
-            const char *glsl_type_name = ra_var_glsl_type_name(sv.var);
-#endif
-            ADDF("uniform %s %s;\n", glsl_type_name, sv.var.name);
-        }
 
         // We can't handle these yet, but nothing we use requires them, either
         assert(res->num_vertex_attribs == 0);
         assert(res->num_descriptors == 0);
-
-        ADD(res->glsl);
     }
 #else
     if (tc->fmt.transfer == TRANSFER_FUNC_SMPTE_ST2084 ||
@@ -959,7 +1083,103 @@ opengl_fragment_shader_init_impl_for_alpha_blend(opengl_tex_converter_t *tc, GLe
     }
 #endif
 
-    if (tex_target == GL_TEXTURE_RECTANGLE)
+    ab->tex_target = tex_target;
+    ab->chroma = chroma;
+    ab->yuv_space = yuv_space;
+    ab->is_yuv = is_yuv;
+
+    GLuint fragment_shader = opengl_alpha_blend_build_shader(tc);
+    if (fragment_shader == 0)
+        return 0;
+
+    tc->tex_target = tex_target;
+
+    tc->pf_fetch_locations = tc_base_fetch_locations;
+    tc->pf_prepare_shader = tc_base_prepare_shader;
+
+    return fragment_shader;
+}
+
+/* The program of the previous shader is kept: back to its options */
+void
+opengl_alpha_blend_restore(opengl_tex_converter_t *tc)
+{
+    struct opengl_alpha_blend *ab = tc->alpha_blend;
+
+    vlc_mutex_lock(&ab->lock);
+    for (unsigned i = ALPHA_BLEND_FIT_TO_DISPLAY; i < ALPHA_BLEND_VAR_COUNT; ++i)
+        ab->built[i] = ab->previous[i];
+    vlc_mutex_unlock(&ab->lock);
+}
+
+GLuint
+opengl_alpha_blend_build_shader(opengl_tex_converter_t *tc)
+{
+    struct opengl_alpha_blend *ab = tc->alpha_blend;
+    const bool is_yuv = ab->is_yuv;
+
+    /* The options are baked in the source, the shader is rebuilt when they
+     * change. Only the ratios stay uniforms. */
+    vlc_mutex_lock(&ab->lock);
+    for (unsigned i = ALPHA_BLEND_FIT_TO_DISPLAY; i < ALPHA_BLEND_VAR_COUNT; ++i)
+    {
+        ab->previous[i] = ab->built[i];
+        ab->built[i] = ab->val[i].b_bool;
+    }
+    vlc_mutex_unlock(&ab->lock);
+    const bool fit_to_display = ab->built[ALPHA_BLEND_FIT_TO_DISPLAY];
+    const bool show_divider = ab->built[ALPHA_BLEND_SHOW_DIVIDER];
+    const bool enable_blend = ab->built[ALPHA_BLEND_ENABLE_BLEND];
+    const bool grid = ab->grid_cols > 1 || ab->grid_rows > 1;
+
+    /* A new program has none of the ratios yet */
+    atomic_store(&ab->changed, true);
+
+    const char *sampler, *lookup;
+    switch (ab->tex_target)
+    {
+        case GL_TEXTURE_2D:
+            sampler = "sampler2D";
+            lookup  = "texture2D";
+            break;
+        case GL_TEXTURE_RECTANGLE:
+            sampler = "sampler2DRect";
+            lookup  = "texture2DRect";
+            break;
+        default:
+            vlc_assert_unreachable();
+    }
+
+    struct vlc_memstream ms;
+    if (vlc_memstream_open(&ms) != 0)
+        return 0;
+
+#define ADD(x) vlc_memstream_puts(&ms, x)
+#define ADDF(x, ...) vlc_memstream_printf(&ms, x, ##__VA_ARGS__)
+
+    ADDF("#version %u\n%s", tc->glsl_version, tc->glsl_precision_header);
+
+    for (unsigned i = 0; i < tc->tex_count; ++i)
+        ADDF("uniform %s Texture%u;\n"
+             "varying vec2 TexCoord%u;\n", sampler, i, i);
+
+#ifdef HAVE_LIBPLACEBO
+    if (tc->pl_sh_res) {
+        const struct pl_shader_res *res = tc->pl_sh_res;
+        for (int i = 0; i < res->num_variables; i++) {
+            struct pl_shader_var sv = res->variables[i];
+#if PL_API_VER >= 4
+            const char *glsl_type_name = pl_var_glsl_type_name(sv.var);
+#else
+            const char *glsl_type_name = ra_var_glsl_type_name(sv.var);
+#endif
+            ADDF("uniform %s %s;\n", glsl_type_name, sv.var.name);
+        }
+        ADD(res->glsl);
+    }
+#endif
+
+    if (ab->tex_target == GL_TEXTURE_RECTANGLE)
     {
         for (unsigned i = 0; i < tc->tex_count; ++i)
             ADDF("uniform vec2 TexSize%u;\n", i);
@@ -970,188 +1190,113 @@ opengl_fragment_shader_init_impl_for_alpha_blend(opengl_tex_converter_t *tc, GLe
 
     ADD("uniform vec4 FillColor;\n\n");
 
-    ADD("uniform float mixRatioFront;\n");
-    ADD("uniform float mixRatioRear;\n");
-    ADD("uniform int fitToDisplay;\n");
-    ADD("uniform int showDivider;\n");
-    ADD("uniform int enableBlend;\n");
-    ADD("const vec3 border = vec3(0.0, 0.5, 1.0);\n");
-    // In order to retain same line width, we assume that the screen has 16:9 aspect ratio
-    // So h_divider wil be v_divider * 9 / 16, but D1 resolution has 4:3 resolution, so will be some error
-    // FIXME(aiden): need to consider screen's aspect ratio
-    ADD("const float v_divider_default = 0.002;\n");
-    ADD("const float h_divider_default = v_divider_default * 9.0 / 16.0;\n");
-
-    ADD("vec3 getLSourceCoord(vec2 pt) {                                    \n"
-        "   if(enableBlend == 0) {                                          \n"
-        "       return vec3(pt, 1.0);                                       \n"
-        "   }                                                               \n"
-        "   float alpha = 1.0;                                              \n"
-        "   float v_divider = 0.0;                                          \n"
-        "   float h_divider = 0.0;                                          \n"
-        "   if(showDivider == 1) {                                          \n"
-        "       v_divider = v_divider_default;                              \n"
-        "       h_divider = h_divider_default;                              \n"
-        "   }                                                               \n"
-        "   if(pt.y < border.y - v_divider) {                               \n"
-                // line padding(along to Y)
-        "       if(mixRatioFront == 0.0 && pt.x > border.y - h_divider) { return vec3(pt, 0.0); }\n"
-                // Left front
-        "       if(fitToDisplay != 1) pt.x -= mixRatioFront;                \n"
-        "       else {                                                      \n"
-        "           float scale = (border.y + mixRatioFront) / border.y;    \n"
-        "           pt.x = ((pt.x - mixRatioFront)) / scale + (mixRatioFront / scale);\n"
-        "       }                                                           \n"
-        "       if(pt.x < border.x || pt.x > border.y) {                    \n"
-        "           alpha = 0.0;                                            \n"
-        "       } else {                                                    \n"
-        "           float overlap = 2.0 * mixRatioFront;                    \n"
-        "           float start = border.y - overlap;                       \n"
-        "           float end = border.y;                                   \n"
-        "           if(pt.x > start && pt.x < end) {                        \n"
-        "               alpha = 1.0 - (pt.x - start) * (1.0 / overlap);     \n"
-        "           }                                                       \n"
-        "       }                                                           \n"
-        "   } else if(pt.y > border.y + v_divider) {                        \n"
-                // line padding(along to Y)
-        "       if(mixRatioRear == 0.0 && pt.x > border.y - h_divider) { return vec3(pt, 0.0); }\n"
-                // Left Rear
-        "       if(fitToDisplay != 1) pt.x -= mixRatioRear;                 \n"
-        "       else {                                                      \n"
-        "           float scale = (border.y + mixRatioRear) / border.y;     \n"
-        "           pt.x = (pt.x - mixRatioRear) / scale + (mixRatioRear / scale);\n"
-        "       }                                                           \n"
-        "       if(pt.x < border.x || pt.x > border.y) {                    \n"
-        "           alpha = 0.0;                                            \n"
-        "       } else {                                                    \n"
-        "           float overlap = 2.0 * mixRatioRear;                     \n"
-        "           float start = border.y - overlap;                       \n"
-        "           float end = border.y;                                   \n"
-        "           if(pt.x > start && pt.x < end) {                        \n"
-        "               alpha = 1.0 - (pt.x - start) * (1.0 / overlap);     \n"
-        "           }                                                       \n"
-        "       }                                                           \n"
-        "   } else {                                                        \n"
-                // line padding(along to X)
-        "       alpha = 0.0;                                                \n"
-        "   }                                                               \n"
-        "                                                                   \n"
-        "   return vec3(pt, alpha);                                         \n"
-        "};                                                                 \n"
-        "                                                                   \n"
-       );
-    ADD("vec3 getRSourceCoord(vec2 pt) {                                    \n"
-        "   if(enableBlend == 0) {                                          \n"
-        "       return vec3(pt, 1.0);                                       \n"
-        "   }                                                               \n"
-        "   float alpha = 1.0;                                              \n"
-        "   float v_divider = 0.0;                                          \n"
-        "   float h_divider = 0.0;                                          \n"
-        "   if(showDivider == 1) {                                          \n"
-        "       v_divider = v_divider_default;                              \n"
-        "       h_divider = h_divider_default;                              \n"
-        "   }                                                               \n"
-        "   if(pt.y < border.y - v_divider) {                               \n"
-                // line padding(along to Y)
-        "       if(mixRatioFront == 0.0 && pt.x < border.y + h_divider) { return vec3(pt, 0.0); }\n"
-                // Right front
-        "       if(fitToDisplay != 1) pt.x += mixRatioFront;                \n"
-        "       else {                                                      \n"
-        "           float scale = (border.y + mixRatioFront) / border.y;    \n"
-        "           pt.x = ((pt.x + mixRatioFront)) / scale + (mixRatioFront / scale);\n"
-        "       }                                                           \n"
-        "       if(pt.x < border.y || pt.x > border.z) {                    \n"
-        "           alpha = 0.0;                                            \n"
-        "       } else {                                                    \n"
-        "           float overlap = 2.0 * mixRatioFront;                    \n"
-        "           float start = border.y;                                 \n"
-        "           float end = border.y + overlap;                         \n"
-        "           if(pt.x > start && pt.x < end) {                        \n"
-        "               alpha = (pt.x - start) * (1.0 / overlap);           \n"
-        "           }                                                       \n"
-        "       }                                                           \n"
-        "   } else if(pt.y > border.y + v_divider) {                        \n"
-                // line padding(along to Y)
-        "       if(mixRatioRear == 0.0 && pt.x < border.y + h_divider) { return vec3(pt, 0.0); }\n"
-                // Right Rear
-        "       if(fitToDisplay != 1) pt.x += mixRatioRear;                 \n"
-        "       else {                                                      \n"
-        "           float scale = (border.y + mixRatioRear) / border.y;     \n"
-        "           pt.x = (pt.x + mixRatioRear) / scale + (mixRatioRear / scale);\n"
-        "       }                                                           \n"
-        "       if(pt.x < border.y || pt.x > border.z) {                    \n"
-        "           alpha = 0.0;                                            \n"
-        "       } else {                                                    \n"
-        "           float overlap = 2.0 * mixRatioRear;                     \n"
-        "           float start = border.y;                                 \n"
-        "           float end = border.y + overlap;                         \n"
-        "           if(pt.x > start && pt.x < end) {                        \n"
-        "               alpha = (pt.x - start) * (1.0 / overlap);           \n"
-        "           }                                                       \n"
-        "       }                                                           \n"
-        "   } else {                                                        \n"
-                // line padding(along to X)
-        "       alpha = 0.0;                                                \n"
-        "   }                                                               \n"
-        "                                                                   \n"
-        "   return vec3(pt, alpha);                                         \n"
-        "};                                                                 \n"
-        "                                                                   \n"
-       );
+    if (enable_blend)
+    {
+        ADD("uniform float mixRatioFront;\n"
+            "uniform float mixRatioRear;\n");
+        if (show_divider)
+        {
+            // In order to retain same line width, we assume that the screen has 16:9 aspect ratio
+            // So h_divider wil be v_divider * 9 / 16, but D1 resolution has 4:3 resolution, so will be some error
+            // FIXME(aiden): need to consider screen's aspect ratio
+            ADD("const float v_divider = 0.002;\n"
+                "const float h_divider = v_divider * 9.0 / 16.0;\n");
+        }
+    }
 
     ADD("void main(void) {\n"
         " float val;\n"
-        " vec4 colors;\n"
-        " vec3 coord_l;\n"
-        " vec3 coord_r;\n"
-        " vec4 colors_l;\n"
-        " vec4 colors_r;\n"
-       );
+        " vec4 colors;\n");
 
-    if (tex_target == GL_TEXTURE_RECTANGLE)
+    /* Lens geometry, once per pixel: the top half is the front pair and the
+     * bottom half the rear one. Each lens is read at x * a + b, and weighted
+     * by its ramp over the overlap (left lens: [0, 0.5], right: [0.5, 1]). */
+    if (enable_blend)
     {
-        for (unsigned i = 0; i < tc->tex_count; ++i)
-            ADDF(" vec2 TexCoordRect%u = vec2(TexCoord%u.x * TexSize%u.x, TexCoord%u.y * TexSize%u.y);\n", i, i, i, i, i);
+        if (grid)
+            ADDF(" const vec2 grid = vec2(%u.0, %u.0);\n"
+                 " vec2 cell = floor(TexCoord0 * grid);\n"
+                 " vec2 pt = TexCoord0 * grid - cell;\n",
+                 ab->grid_cols, ab->grid_rows);
+        else
+            ADD(" vec2 pt = TexCoord0;\n");
+        ADD(" float m = mix(mixRatioFront, mixRatioRear, step(0.5, pt.y));\n"
+            " float overlap = max(2.0 * m, 1.0e-6);\n");
+        if (fit_to_display)
+            ADD(" float a = 1.0 / (1.0 + 2.0 * m);\n"
+                " float b_l = 0.0;\n"
+                " float b_r = 2.0 * m * a;\n");
+        else
+            ADD(" const float a = 1.0;\n"
+                " float b_l = -m;\n"
+                " float b_r = m;\n");
+        ADD(" float x_l = pt.x * a + b_l;\n"
+            " float x_r = pt.x * a + b_r;\n"
+            " float alpha_l = step(0.0, x_l) * step(x_l, 0.5)\n"
+            "               * clamp((0.5 - x_l) / overlap, 0.0, 1.0);\n"
+            " float alpha_r = step(0.5, x_r) * step(x_r, 1.0)\n"
+            "               * clamp((x_r - 0.5) / overlap, 0.0, 1.0);\n");
+        if (show_divider)
+        {
+            // Horizontal line between the pairs, vertical one on a pair
+            // that is not blended at all
+            ADD(" float row = step(v_divider, abs(pt.y - 0.5));\n"
+                " float cut = step(1.0e-7, m);\n"
+                " alpha_l *= row * max(cut, step(pt.x, 0.5 - h_divider));\n"
+                " alpha_r *= row * max(cut, step(0.5 + h_divider, pt.x));\n");
+        }
+        ADD(" float sum = alpha_l + alpha_r;\n"
+            " float lit = step(1.0e-6, sum);\n"
+            " float w_l = alpha_l / max(sum, 1.0e-6);\n"
+            " float w_r = alpha_r / max(sum, 1.0e-6);\n");
     }
 
     unsigned color_idx = 0;
     for (unsigned i = 0; i < tc->tex_count; ++i)
     {
-        const char *swizzle = swizzle_per_tex[i];
+        const char *swizzle = ab->swizzle_per_tex[i];
+        /* Rectangle textures are addressed in texels */
+        const char *scale = "";
+        char scale_buf[sizeof(" * TexSizeX")];
+        if (ab->tex_target == GL_TEXTURE_RECTANGLE)
+        {
+            snprintf(scale_buf, sizeof(scale_buf), " * TexSize%1u", i);
+            scale = scale_buf;
+        }
+
+        if (enable_blend && grid)
+            ADDF(" colors = %s(Texture%u, (cell + vec2((TexCoord%u.x * grid.x - cell.x) * a + b_l,\n"
+                 "                                   TexCoord%u.y * grid.y - cell.y)) / grid%s) * w_l\n"
+                 "        + %s(Texture%u, (cell + vec2((TexCoord%u.x * grid.x - cell.x) * a + b_r,\n"
+                 "                                   TexCoord%u.y * grid.y - cell.y)) / grid%s) * w_r;\n",
+                 lookup, i, i, i, scale, lookup, i, i, i, scale);
+        else if (enable_blend)
+            ADDF(" colors = %s(Texture%u, vec2(TexCoord%u.x * a + b_l, TexCoord%u.y)%s) * w_l\n"
+                 "        + %s(Texture%u, vec2(TexCoord%u.x * a + b_r, TexCoord%u.y)%s) * w_r;\n",
+                 lookup, i, i, i, scale, lookup, i, i, i, scale);
+        else
+            ADDF(" colors = %s(Texture%u, TexCoord%u%s);\n", lookup, i, i, scale);
+
         if (swizzle)
         {
             size_t swizzle_count = strlen(swizzle);
-            // get pixel corresponding pixel location
-            ADDF("  coord_l = getLSourceCoord(%s%u);\n", coord_name, i);
-            ADDF("  coord_r = getRSourceCoord(%s%u);\n", coord_name, i);
-            ADDF("  colors_l = %s(Texture%u, coord_l.xy);\n", lookup, i);
-            ADDF("  colors_r = %s(Texture%u, coord_r.xy);\n", lookup, i);
-            // composite
-            // 0(coord_l.z + coord_r.z = 0)으로 나누어 Nan발생시에는 yuv좌표계상에서 black컬러로 처리되는 듯 하다
-            ADD ("  colors = (colors_l * coord_l.z + colors_r * coord_r.z) / (coord_l.z + coord_r.z);\n");
             for (unsigned j = 0; j < swizzle_count; ++j)
             {
                 ADDF(" val = colors.%c;\n"
-                     " vec4 color%u = vec4(val, val, val, 1);\n\n", swizzle[j], color_idx);
+                     " vec4 color%u = vec4(val, val, val, 1);\n", swizzle[j], color_idx);
                 color_idx++;
                 assert(color_idx <= PICTURE_PLANE_MAX);
             }
         }
         else
         {
-            // same as swizzle case above
-            ADDF("  coord_l = getLSourceCoord(%s%u);\n", coord_name, i);
-            ADDF("  coord_r = getRSourceCoord(%s%u);\n", coord_name, i);
-            ADDF("  colors_l = %s(Texture%u, coord_l.xy);\n", lookup, i);
-            ADDF("  colors_r = %s(Texture%u, coord_r.xy);\n", lookup, i);
-            ADD ("  colors = (colors_l * coord_l.z + colors_r * coord_r.z) / (coord_l.z + coord_r.z);\n");
-            ADDF(" vec4 color%u = vec4(colors.xyz, 1);\n\n", color_idx);
+            ADDF(" vec4 color%u = vec4(colors.xyz, 1);\n", color_idx);
             color_idx++;
             assert(color_idx <= PICTURE_PLANE_MAX);
         }
     }
     unsigned color_count = color_idx;
-    assert(yuv_space == COLOR_SPACE_UNDEF || color_count == 3);
+    assert(ab->yuv_space == COLOR_SPACE_UNDEF || color_count == 3);
 
     if (is_yuv)
         ADD(" vec4 result = (color0 * Coefficients[0]) + Coefficients[3];\n");
@@ -1160,7 +1305,7 @@ opengl_fragment_shader_init_impl_for_alpha_blend(opengl_tex_converter_t *tc, GLe
 
     for (unsigned i = 1; i < color_count; ++i)
     {
-        if (yuv_swap_uv)
+        if (ab->yuv_swap_uv)
         {
             assert(color_count == 3);
             color_idx = (i % 2) + 1;
@@ -1183,6 +1328,10 @@ opengl_fragment_shader_init_impl_for_alpha_blend(opengl_tex_converter_t *tc, GLe
     }
 #endif
 
+    /* Pixels seen by neither lens are black, whatever the color space */
+    if (enable_blend)
+        ADD(" result.rgb *= lit;\n");
+
     ADD(" gl_FragColor = result * FillColor;\n"
         "}");
 
@@ -1202,33 +1351,12 @@ opengl_fragment_shader_init_impl_for_alpha_blend(opengl_tex_converter_t *tc, GLe
     tc->vt->ShaderSource(fragment_shader, 1, (const char **)&ms.ptr, &length);
     tc->vt->CompileShader(fragment_shader);
 
-    //GLint compiled = 0;
-    //tc->vt->GetShaderiv(fragment_shader, GL_COMPILE_STATUS, &compiled);
-    //if(!compiled) {
-    //    GLint infoLen = 0;
-    //    tc->vt->GetShaderiv(fragment_shader, GL_INFO_LOG_LENGTH, &infoLen);
-    //    if (infoLen) {
-    //        char* buf = (char*) malloc(infoLen);
-    //        if (buf) {
-    //            tc->vt->GetShaderInfoLog(fragment_shader, infoLen, NULL, buf);
-    //            msg_Err(tc->gl, "Could not compile shader %d:\n%s\n", GL_FRAGMENT_SHADER, buf);
-    //            free(buf);
-    //        }
-    //        tc->vt->DeleteShader(fragment_shader);
-    //        fragment_shader = 0;
-    //    }
-    //    free(ms.ptr);
-    //    return 0;
-    //}
-
     if (tc->b_dump_shaders)
-        msg_Dbg(tc->gl, "\n=== Fragment shader for fourcc: %4.4s, colorspace: %d ===\n%s\n", (const char *)&chroma, yuv_space, ms.ptr);
+        msg_Dbg(tc->gl, "\n=== Alpha blend fragment shader for fourcc: %4.4s, colorspace: %d, "
+                "blend: %d, fit: %d, divider: %d, tiles: %ux%u ===\n%s\n",
+                (const char *)&ab->chroma, ab->yuv_space, enable_blend,
+                fit_to_display, show_divider, ab->grid_cols, ab->grid_rows, ms.ptr);
     free(ms.ptr);
 
-    tc->tex_target = tex_target;
-
-    tc->pf_fetch_locations = tc_base_fetch_locations;
-    tc->pf_prepare_shader = tc_base_prepare_shader;
-
     return fragment_shader;
 }
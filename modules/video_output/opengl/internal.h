@@ -31,6 +31,21 @@ GLuint
 opengl_fragment_shader_init_impl_for_alpha_blend(opengl_tex_converter_t *,
                                  GLenum, vlc_fourcc_t, video_color_space_t);
 
+int
+opengl_alpha_blend_init(opengl_tex_converter_t *);
+
+void
+opengl_alpha_blend_clean(opengl_tex_converter_t *);
+
+GLuint
+opengl_alpha_blend_build_shader(opengl_tex_converter_t *);
+
+void
+opengl_alpha_blend_restore(opengl_tex_converter_t *);
+
+bool
+opengl_alpha_blend_outdated(opengl_tex_converter_t *);
+
 int
 opengl_tex_converter_generic_init(opengl_tex_converter_t *, bool);
 
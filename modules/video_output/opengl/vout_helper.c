@@ -572,6 +572,33 @@ error:
     return VLC_EGENERIC;
 }
 
+/* Link the program again on an alpha blend shader built for the current
+ * options, the previous program is kept if that fails */
+static void
+opengl_relink_alpha_blend(struct prgm *prgm)
+{
+    opengl_tex_converter_t *tc = prgm->tc;
+
+    GLuint fshader = opengl_alpha_blend_build_shader(tc);
+    if (fshader == 0)
+    {
+        msg_Err(tc->gl, "Unable to build the alpha blend shader");
+        opengl_alpha_blend_restore(tc);
+        return;
+    }
+
+    struct prgm old = *prgm;
+    tc->fshader = fshader;
+    if (opengl_link_program(prgm) != VLC_SUCCESS)
+    {
+        *prgm = old;
+        tc->pf_fetch_locations(tc, prgm->id);
+        opengl_alpha_blend_restore(tc);
+        return;
+    }
+    tc->vt->DeleteProgram(old.id);
+}
+
 static void
 opengl_deinit_program(vout_display_opengl_t *vgl, struct prgm *prgm)
 {
@@ -582,6 +609,7 @@ opengl_deinit_program(vout_display_opengl_t *vgl, struct prgm *prgm)
         opengl_tex_converter_generic_deinit(tc);
     if (prgm->id != 0)
         vgl->vt.DeleteProgram(prgm->id);
+    opengl_alpha_blend_clean(tc);
 
 #ifdef HAVE_LIBPLACEBO
     FREENULL(tc->uloc.pl_vars);
@@ -623,6 +651,11 @@ opengl_init_program(vout_display_opengl_t *vgl, struct prgm *prgm,
     if(vgl->alphaBlendProjectionEnabled && !subpics) {
         tc->pf_fragment_shader_init = opengl_fragment_shader_init_impl_for_alpha_blend;
         msg_Dbg(tc->gl,"AIDEN: shader: opengl_fragment_shader_init_impl_for_alpha_blend");
+        if (opengl_alpha_blend_init(tc) != VLC_SUCCESS)
+        {
+            vlc_object_release(tc);
+            return VLC_ENOMEM;
+        }
     }
     else {
         tc->pf_fragment_shader_init = opengl_fragment_shader_init_impl;
@@ -674,6 +707,7 @@ opengl_init_program(vout_display_opengl_t *vgl, struct prgm *prgm,
 
         if (desc == NULL)
         {
+            opengl_alpha_blend_clean(tc);
             vlc_object_release(tc);
             return VLC_EGENERIC;
         }
@@ -695,6 +729,7 @@ opengl_init_program(vout_display_opengl_t *vgl, struct prgm *prgm,
 
     if (ret != VLC_SUCCESS)
     {
+        opengl_alpha_blend_clean(tc);
         vlc_object_release(tc);
         return VLC_EGENERIC;
     }
@@ -1265,6 +1300,46 @@ int vout_display_opengl_Prepare(vout_display_opengl_t *vgl,
     return ret;
 }
 
+/* Updates the part of the textures at (x, y) from a smaller picture, with
+ * the format of the main program. Only the textures allocated here, by a
+ * software converter, can be updated this way. */
+int vout_display_opengl_PrepareTile(vout_display_opengl_t *vgl,
+                                    const picture_t *tile,
+                                    unsigned x, unsigned y)
+{
+    GL_ASSERT_NOERROR();
+
+    const opengl_tex_converter_t *tc = vgl->prgm->tc;
+    if (tc->handle_texs_gen || tile->i_planes < (int)tc->tex_count)
+        return VLC_EGENERIC;
+
+    vgl->vt.PixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    for (unsigned j = 0; j < tc->tex_count; j++)
+    {
+        const plane_t *p = &tile->p[j];
+        const GLint xoffset = x * tc->texs[j].w.num / tc->texs[j].w.den;
+        const GLint yoffset = y * tc->texs[j].h.num / tc->texs[j].h.den;
+        const GLsizei width = p->i_visible_pitch / p->i_pixel_pitch;
+
+        vgl->vt.ActiveTexture(GL_TEXTURE0 + j);
+        vgl->vt.BindTexture(tc->tex_target, vgl->texture[j]);
+        if (p->i_pitch == p->i_visible_pitch)
+            vgl->vt.TexSubImage2D(tc->tex_target, 0, xoffset, yoffset,
+                                  width, p->i_visible_lines,
+                                  tc->texs[j].format, tc->texs[j].type,
+                                  p->p_pixels);
+        else /* no GL_UNPACK_ROW_LENGTH in GLES2: one line at a time */
+            for (int l = 0; l < p->i_visible_lines; l++)
+                vgl->vt.TexSubImage2D(tc->tex_target, 0, xoffset, yoffset + l,
+                                      width, 1, tc->texs[j].format,
+                                      tc->texs[j].type,
+                                      &p->p_pixels[l * p->i_pitch]);
+    }
+
+    GL_ASSERT_NOERROR();
+    return VLC_SUCCESS;
+}
+
 static int BuildSphere(unsigned nbPlanes,
                         GLfloat **vertexCoord, GLfloat **textureCoord, unsigned *nbVertices,
                         GLushort **indices, unsigned *nbIndices,
@@ -1701,6 +1776,9 @@ int vout_display_opengl_Display(vout_display_opengl_t *vgl,
        Currently, the OS X provider uses it to get a smooth window resizing */
     vgl->vt.Clear(GL_COLOR_BUFFER_BIT);
 
+    if (opengl_alpha_blend_outdated(vgl->prgm->tc))
+        opengl_relink_alpha_blend(vgl->prgm);
+
     vgl->vt.UseProgram(vgl->prgm->id);
 
     if (source->i_x_offset != vgl->last_source.i_x_offset
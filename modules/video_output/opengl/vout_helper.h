@@ -225,6 +225,9 @@ void vout_display_opengl_Viewport(vout_display_opengl_t *vgl, int x, int y,
 
 int vout_display_opengl_Prepare(vout_display_opengl_t *vgl,
                                 picture_t *picture, subpicture_t *subpicture);
+int vout_display_opengl_PrepareTile(vout_display_opengl_t *vgl,
+                                    const picture_t *tile,
+                                    unsigned x, unsigned y);
 int vout_display_opengl_Display(vout_display_opengl_t *vgl,
                                 const video_format_t *source);
 
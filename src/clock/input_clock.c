@@ -102,6 +102,13 @@
 /* */
 #define INPUT_CLOCK_LATE_COUNT (3)
 
+/* Rates (in 1/256) at which the pts delay of a live clock may grow or shrink
+ * toward its target, that is how much faster or slower than the sender we
+ * play meanwhile. Shrinking is kept well inside what audio resampling hides.
+ */
+#define CR_LIVE_SLEW_UP   (8)
+#define CR_LIVE_SLEW_DOWN (2)
+
 /* */
 struct input_clock_t
 {
@@ -137,6 +144,10 @@ struct input_clock_t
     vlc_tick_t    i_external_clock;
     bool          b_has_external_clock;
 
+    /* Live mode: pts delay slewed toward the target */
+    bool          b_live;
+    vlc_tick_t    i_live_target;
+
     /* Current modifiers */
     bool    b_paused;
     int     i_rate;
@@ -176,6 +187,9 @@ input_clock_t *input_clock_New( int i_rate )
     for( int i = 0; i < INPUT_CLOCK_LATE_COUNT; i++ )
         cl->late.pi_value[i] = 0;
 
+    cl->b_live = false;
+    cl->i_live_target = 0;
+
     cl->i_rate = i_rate;
     cl->i_pts_delay = 0;
     cl->b_paused = false;
@@ -274,6 +288,8 @@ void input_clock_Update( input_clock_t *cl, vlc_object_t *p_log,
     //fprintf( stderr, "input_clock_Update: %d :: %lld\n", b_buffering_allowed, cl->i_buffering_duration/1000 );
 
     /* */
+    const vlc_tick_t i_elapsed = b_reset_reference ? 0 :
+                                 __MAX( i_ck_system - cl->last.i_system, 0 );
     cl->last = clock_point_Create( i_ck_stream, i_ck_system );
 
     /* It does not take the decoder latency into account but it is not really
@@ -287,6 +303,23 @@ void input_clock_Update( input_clock_t *cl, vlc_object_t *p_log,
         cl->late.i_index = ( cl->late.i_index + 1 ) % INPUT_CLOCK_LATE_COUNT;
     }
 
+    /* Live mode: instead of waiting for a rebuffering, play slightly slower
+     * until late data fits in the pts delay again, and slightly faster
+     * while it is above the target */
+    if( cl->b_live && !b_can_pace_control )
+    {
+        vlc_tick_t i_goal = cl->i_live_target;
+        if( i_late > 0 && cl->i_pts_delay + i_late > i_goal )
+            i_goal = cl->i_pts_delay + i_late;
+
+        if( i_goal > cl->i_pts_delay )
+            cl->i_pts_delay += __MIN( i_goal - cl->i_pts_delay,
+                                      i_elapsed * CR_LIVE_SLEW_UP / 256 );
+        else
+            cl->i_pts_delay -= __MIN( cl->i_pts_delay - i_goal,
+                                      i_elapsed * CR_LIVE_SLEW_DOWN / 256 );
+    }
+
     vlc_mutex_unlock( &cl->lock );
 }
 
@@ -540,6 +573,20 @@ void input_clock_SetJitter( input_clock_t *cl,
     vlc_mutex_unlock( &cl->lock );
 }
 
+void input_clock_SetLive( input_clock_t *cl, vlc_tick_t i_target )
+{
+    vlc_mutex_lock( &cl->lock );
+
+    cl->b_live = true;
+    cl->i_live_target = i_target;
+
+    /* Nothing was converted yet, no need to slew */
+    if( !cl->b_has_reference )
+        cl->i_pts_delay = i_target;
+
+    vlc_mutex_unlock( &cl->lock );
+}
+
 vlc_tick_t input_clock_GetJitter( input_clock_t *cl )
 {
     vlc_mutex_lock( &cl->lock );
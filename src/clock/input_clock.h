@@ -129,6 +129,14 @@ int input_clock_GetState( input_clock_t *,
 void input_clock_SetJitter( input_clock_t *,
                             vlc_tick_t i_pts_delay, int i_cr_average );
 
+/**
+ * This function switches the clock to live mode: the pts_delay is then
+ * slewed toward i_target (and above it while the clock updates are late)
+ * at a rate audio resampling can follow, instead of only growing.
+ * It can be called again to change the target.
+ */
+void input_clock_SetLive( input_clock_t *, vlc_tick_t i_target );
+
 /**
  * This function returns an estimation of the pts_delay needed to avoid rebufferization.
  * XXX in the current implementation, the pts_delay will never be decreased.
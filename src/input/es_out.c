@@ -129,6 +129,11 @@ struct es_out_id_t
     /* ID for the meta data */
     int         i_meta_id;
 
+    /* Live mode: late drop decision for the current access unit */
+    vlc_tick_t  i_live_pts; /* PTS of the current access unit */
+    bool        b_live_decided;
+    bool        b_live_drop;
+
     struct vlc_list node;
 
     vlc_mouse_event mouse_event_cb;
@@ -184,6 +189,10 @@ typedef struct
     int         i_cr_average;
     int         i_rate;
 
+    /* Live mode, see ES_OUT_SET_LIVE_JITTER */
+    bool        b_live;
+    vlc_tick_t  i_live_target;
+
     /* */
     bool        b_paused;
     vlc_tick_t  i_pause_date;
@@ -1122,6 +1131,8 @@ static es_out_pgrm_t *EsOutProgramAdd( es_out_t *out, int i_group )
     if( p_sys->b_paused )
         input_clock_ChangePause( p_pgrm->p_input_clock, p_sys->b_paused, p_sys->i_pause_date );
     input_clock_SetJitter( p_pgrm->p_input_clock, p_sys->i_pts_delay, p_sys->i_cr_average );
+    if( p_sys->b_live )
+        input_clock_SetLive( p_pgrm->p_input_clock, p_sys->i_live_target );
 
     /* Append it */
     vlc_list_append(&p_pgrm->node, &p_sys->programs);
@@ -1685,6 +1696,9 @@ static es_out_id_t *EsOutAddSlaveLocked( es_out_t *out, const es_format_t *fmt,
     es->cc.type = 0;
     es->cc.i_bitmap = 0;
     es->p_master = p_master;
+    es->i_live_pts = VLC_TICK_INVALID;
+    es->b_live_decided = false;
+    es->b_live_drop = false;
     es->mouse_event_cb = NULL;
     es->mouse_event_userdata = NULL;
 
@@ -2151,6 +2165,41 @@ static int EsOutSend( es_out_t *out, es_out_id_t *es, block_t *p_block )
         return VLC_SUCCESS;
     }
 
+    /* Live mode: skip the decoding of pictures that would be displayed late
+     * anyway, nothing depends on them. An access unit starts with its PTS,
+     * and the decision taken on its first droppable block applies to all
+     * its slices, so that the decoder never gets a partial picture. */
+    if( p_block->i_pts != VLC_TICK_INVALID )
+    {
+        es->i_live_pts = p_block->i_pts;
+        es->b_live_decided = false;
+    }
+    if( p_sys->b_live && ( p_block->i_flags & BLOCK_FLAG_DROPPABLE ) &&
+        es->p_pgrm )
+    {
+        if( !es->b_live_decided )
+        {
+            vlc_tick_t i_date = es->i_live_pts;
+
+            es->b_live_decided = true;
+            es->b_live_drop = !p_sys->b_buffering &&
+                i_date != VLC_TICK_INVALID &&
+                input_clock_ConvertTS( VLC_OBJECT(p_input),
+                                       es->p_pgrm->p_input_clock, NULL,
+                                       &i_date, NULL, INT64_MAX ) == VLC_SUCCESS &&
+                i_date < vlc_tick_now();
+            if( es->b_live_drop && stats != NULL )
+                atomic_fetch_add_explicit(&stats->lost_pictures, 1,
+                                          memory_order_relaxed);
+        }
+        if( es->b_live_drop )
+        {
+            block_Release( p_block );
+            vlc_mutex_unlock( &p_sys->lock );
+            return VLC_SUCCESS;
+        }
+    }
+
     /* Check for sout mode */
     if( input_priv(p_input)->p_sout )
     {
@@ -2609,6 +2658,7 @@ static int EsOutVaControlLocked( es_out_t *out, int i_query, va_list args )
         /* TODO do not use vlc_tick_now() but proper stream acquisition date */
         bool b_late;
         bool b_extra_buffering_allowed = !input_priv(p_sys->p_input)->b_low_delay &&
+                                         !p_sys->b_live &&
                                          EsOutIsExtraBufferingAllowed( out );
         input_clock_Update( p_pgrm->p_input_clock, VLC_OBJECT(p_sys->p_input),
                             &b_late,
@@ -2624,8 +2674,9 @@ static int EsOutVaControlLocked( es_out_t *out, int i_query, va_list args )
             /* Check buffering state on master clock update */
             EsOutDecodersStopBuffering( out, false );
         }
-        else if( p_pgrm == p_sys->p_pgrm )
+        else if( p_pgrm == p_sys->p_pgrm && !p_sys->b_live )
         {
+            /* In live mode the clock absorbs the lateness by itself */
             if( b_late && ( !input_priv(p_sys->p_input)->p_sout ||
                             !input_priv(p_sys->p_input)->b_out_pace_control ) )
             {
@@ -2956,6 +3007,27 @@ static int EsOutVaControlLocked( es_out_t *out, int i_query, va_list args )
         return VLC_SUCCESS;
     }
 
+    case ES_OUT_SET_LIVE_JITTER:
+    {
+        vlc_tick_t i_target = va_arg( args, vlc_tick_t );
+        es_out_pgrm_t *pgrm;
+
+        if( i_target < 0 )
+            return VLC_EGENERIC;
+        if( i_target > INPUT_PTS_DELAY_MAX )
+            i_target = INPUT_PTS_DELAY_MAX;
+
+        if( !p_sys->b_live )
+            msg_Dbg( p_sys->p_input, "live mode, jitter buffer %"PRId64" ms",
+                     MS_FROM_VLC_TICK(i_target) );
+        p_sys->b_live = true;
+        p_sys->i_live_target = i_target;
+
+        vlc_list_foreach(pgrm, &p_sys->programs, node)
+            input_clock_SetLive(pgrm->p_input_clock, i_target);
+        return VLC_SUCCESS;
+    }
+
     case ES_OUT_GET_PCR_SYSTEM:
     {
         if( p_sys->b_buffering )
@@ -0,0 +1,409 @@
+/*****************************************************************************
+ * stitching_bench.cpp: stitching pipeline benchmark
+ *****************************************************************************
+ * Copyright (C) 2018 LINKFLOW Co., Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Feeds recorded quad frames through the stitching core, the same way the
+ * stitching video filter does, without libvlc:
+ *
+ *   stitching_bench [options] <directory of quad images | file.y4m>
+ *
+ * Timings of every pipeline stage and of whole frames are printed as JSON
+ * on stdout, with the peak resident set size of the process. */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+# ifndef NOMINMAX
+#  define NOMINMAX
+# endif
+# include <windows.h>
+# include <psapi.h>
+#else
+# include <sys/resource.h>
+#endif
+
+#include "opencv2/core.hpp"
+#include "opencv2/imgcodecs.hpp"
+#include "opencv2/imgproc.hpp"
+
+#include "LFSecurity.h"
+#include "StitchCore.h"
+
+using namespace cv;
+using namespace std;
+
+// Peak resident set size of the process, in kB
+static long PeakRSS()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if(!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+        return 0;
+    return pmc.PeakWorkingSetSize / 1024;
+#else
+    struct rusage ru;
+    if(getrusage(RUSAGE_SELF, &ru) != 0)
+        return 0;
+    return ru.ru_maxrss;
+#endif
+}
+
+// Quotes a string for JSON output (e.g. the backslashes of Windows paths)
+static string JsonEscape(const char *str)
+{
+    string out;
+    for(; *str; str++) {
+        const unsigned char c = *str;
+        if(c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if(c < 0x20) {
+            char esc[7];
+            snprintf(esc, sizeof(esc), "\\u%04x", c);
+            out += esc;
+        } else
+            out += c;
+    }
+    return out;
+}
+
+static void usage(const char *name)
+{
+    cerr << "Usage: " << name << " [options] <frames directory | file.y4m>\n"
+         << "  --features orb|surf  feature detector (default: orb)\n"
+         << "  --calib N            recalibrate every N frames, 0 for the first one only (default: 0)\n"
+         << "  --warmup N           frames left out of the statistics (default: 2)\n"
+         << "  --frames N           stop after N frames (default: all)\n"
+         << "  --size WxH           output size (default: input size)\n"
+         << "  --planar             render Y4M input on its I420 planes\n";
+}
+
+/* Samples of each stage, in seconds */
+class BenchProfiler : public StitchProfiler
+{
+public:
+    void Record(stitchStage_t stage, double sec)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if(counting)
+            samples[stage].push_back(sec);
+    }
+
+    void SetCounting(bool on)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        counting = on;
+    }
+
+    vector<double> samples[STAGE_END];
+
+private:
+    std::mutex mtx;
+    bool counting = false;
+};
+
+/* Source of quad frames, either image files or a 4:2:0 Y4M stream */
+class FrameSource
+{
+public:
+    bool Open(const string& path)
+    {
+        if(path.size() > 4 && path.compare(path.size() - 4, 4, ".y4m") == 0)
+            return OpenY4M(path);
+
+        glob(path + "/*", files, false); // sorted
+        next = 0;
+        return !files.empty();
+    }
+
+    bool IsY4M() const { return y4m.is_open(); }
+
+    // Next frame as BGR, and as I420 if the source is Y4M
+    bool Read(Mat& bgr, Mat& i420)
+    {
+        if(IsY4M()) {
+            if(!ReadY4M(i420))
+                return false;
+            cvtColor(i420, bgr, COLOR_YUV2BGR_I420);
+            return true;
+        }
+
+        while(next < files.size()) {
+            bgr = imread(files[next++], IMREAD_COLOR);
+            if(!bgr.empty())
+                return true;
+            cerr << "skipping " << files[next - 1] << endl;
+        }
+        return false;
+    }
+
+private:
+    // 8 bits 4:2:0 chroma tags, whatever the chroma siting
+    static bool IsY4M420(const char *tag)
+    {
+        static const char *const chromas[] = {
+            "420", "420jpeg", "420paldv", "420mpeg2",
+        };
+        const size_t len = strcspn(tag, " \n");
+        for(size_t i = 0; i < sizeof(chromas) / sizeof(chromas[0]); i++)
+            if(strlen(chromas[i]) == len && strncmp(tag, chromas[i], len) == 0)
+                return true;
+        return false;
+    }
+
+    bool OpenY4M(const string& path)
+    {
+        y4m.open(path.c_str(), ios::binary);
+        string header;
+        if(!y4m || !getline(y4m, header) || header.compare(0, 10, "YUV4MPEG2 ") != 0) {
+            cerr << path << ": not a YUV4MPEG2 file" << endl;
+            return false;
+        }
+
+        width = height = 0;
+        size_t pos = 0;
+        while((pos = header.find(' ', pos)) != string::npos) {
+            const char *tag = header.c_str() + ++pos;
+            if(tag[0] == 'W')
+                width = atoi(tag + 1);
+            else if(tag[0] == 'H')
+                height = atoi(tag + 1);
+            else if(tag[0] == 'C' && !IsY4M420(tag + 1)) {
+                cerr << path << ": only 4:2:0 8 bits is supported" << endl;
+                return false;
+            }
+        }
+        if(width <= 0 || height <= 0 || width % 2 || height % 2) {
+            cerr << path << ": bad frame size" << endl;
+            return false;
+        }
+        return true;
+    }
+
+    bool ReadY4M(Mat& i420)
+    {
+        string frame;
+        if(!getline(y4m, frame) || frame.compare(0, 5, "FRAME") != 0)
+            return false;
+        i420.create(height * 3 / 2, width, CV_8UC1);
+        return (bool)y4m.read((char *)i420.data, i420.total());
+    }
+
+    vector<String> files;
+    size_t next;
+    ifstream y4m;
+    int width, height;
+};
+
+// Same lens layout as the stitching filter, without padding
+static void SplitQuad(const Mat& frame, Mat lens[4])
+{
+    int w = frame.cols / 2, h = frame.rows / 2;
+    for(int i = 0; i < 4; i++)
+        lens[i] = frame(Rect((i % 2) * w, (i / 2) * h, w, h));
+}
+
+static void SplitQuadPlanes(Mat planes[3], Mat lens[4][3])
+{
+    int w = planes[0].cols / 2, h = planes[0].rows / 2;
+    for(int i = 0; i < 4; i++) {
+        int x = (i % 2) * w, y = (i / 2) * h;
+        lens[i][0] = planes[0](Rect(x, y, w, h));
+        lens[i][1] = planes[1](Rect(x / 2, y / 2, w / 2, h / 2));
+        lens[i][2] = planes[2](Rect(x / 2, y / 2, w / 2, h / 2));
+    }
+}
+
+static void PrintStats(const char *name, vector<double> v, bool last)
+{
+    printf("    \"%s\": {\"count\": %zu", name, v.size());
+    if(!v.empty()) {
+        sort(v.begin(), v.end());
+        double sum = 0;
+        for(size_t i = 0; i < v.size(); i++)
+            sum += v[i];
+        static const int pct[] = {50, 90, 99};
+        printf(", \"mean_ms\": %.3f", sum * 1e3 / v.size());
+        for(int p : pct)
+            printf(", \"p%d_ms\": %.3f", p, v[min(v.size() - 1, v.size() * p / 100)] * 1e3);
+        printf(", \"max_ms\": %.3f", v.back() * 1e3);
+    }
+    printf("}%s\n", last ? "" : ",");
+}
+
+int main(int argc, char **argv)
+{
+    string features = "orb";
+    int calib_interval = 0, warmup = 2, max_frames = -1;
+    int out_width = 0, out_height = 0;
+    bool planar = false;
+    const char *input = NULL;
+
+    for(int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if(arg == "--features" && has_value)
+            features = argv[++i];
+        else if(arg == "--calib" && has_value)
+            calib_interval = atoi(argv[++i]);
+        else if(arg == "--warmup" && has_value)
+            warmup = atoi(argv[++i]);
+        else if(arg == "--frames" && has_value)
+            max_frames = atoi(argv[++i]);
+        else if(arg == "--size" && has_value) {
+            if(sscanf(argv[++i], "%dx%d", &out_width, &out_height) != 2) {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if(arg == "--planar")
+            planar = true;
+        else if(arg[0] != '-' && !input)
+            input = argv[i];
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if(!input) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    FrameSource source;
+    if(!source.Open(input)) {
+        cerr << "cannot read frames from " << input << endl;
+        return 1;
+    }
+    if(planar && !source.IsY4M()) {
+        cerr << "--planar needs a Y4M input" << endl;
+        return 1;
+    }
+
+    BenchProfiler profiler;
+    StitchCore core;
+    core.features_type = features;
+    core.applyROItoFeatureDetection = (features == "orb");
+    core.profiler = &profiler;
+
+    vector<double> frame_times;
+    int frames = 0, calib_runs = 0, calib_failed = 0, not_stitched = 0;
+    Size in_size;
+    Mat bgr, i420, dest, destPlanes[3];
+
+    while((max_frames < 0 || frames < max_frames) && source.Read(bgr, i420)) {
+        if(frames == 0) {
+            in_size = bgr.size();
+            if(out_width <= 0 || out_height <= 0) {
+                out_width = in_size.width;
+                out_height = in_size.height;
+            }
+            core.SetOutputSize(out_width, out_height);
+            core.InitParam(FRONT, 2);
+            core.InitParam(REAR, 2);
+            dest.create(out_height, out_width, CV_8UC3);
+            destPlanes[0].create(out_height, out_width, CV_8UC1);
+            destPlanes[1].create(out_height / 2, out_width / 2, CV_8UC1);
+            destPlanes[2].create(out_height / 2, out_width / 2, CV_8UC1);
+        } else if(bgr.size() != in_size) {
+            cerr << "frame " << frames << ": size changed, stopping" << endl;
+            break;
+        }
+        Mat lens[4];
+        SplitQuad(bgr, lens);
+
+        // Calibration as the filter's calculation thread does it, always
+        // counted as it mostly happens during the warm up
+        if(frames == 0 || (calib_interval > 0 && frames % calib_interval == 0)) {
+            profiler.SetCounting(true);
+            for(int seq = FRONT; seq < CAMDIR_END; seq++) {
+                Mat input[2] = {lens[seq * 2].clone(), lens[seq * 2 + 1].clone()};
+                int ret = core.CalcCameraParam((camDir_t)seq, input);
+                if(ret != -1 && precomputeRenderMap)
+                    core.BakeRenderMap((camDir_t)seq, input);
+                calib_runs++;
+                if(ret != -1 && core.isCameraParamValid((camDir_t)seq))
+                    core.UpdateParam((camDir_t)seq);
+                else
+                    calib_failed++;
+            }
+        }
+
+        profiler.SetCounting(frames >= warmup);
+        int ret[CAMDIR_END];
+        int64 t = getTickCount();
+        if(planar) {
+            Mat planes[3];
+            int w = i420.cols, h = i420.rows * 2 / 3;
+            planes[0] = i420(Rect(0, 0, w, h));
+            planes[1] = Mat(h / 2, w / 2, CV_8UC1, i420.ptr(h));
+            planes[2] = Mat(h / 2, w / 2, CV_8UC1, i420.ptr(h) + (h / 2) * (w / 2));
+            Mat lensPlanes[4][3];
+            SplitQuadPlanes(planes, lensPlanes);
+            core.RenderFramePlanes(lensPlanes, destPlanes, ret);
+        } else {
+            core.RenderFrame(lens, dest, ret);
+        }
+        double sec = (getTickCount() - t) / getTickFrequency();
+
+        if(frames >= warmup) {
+            frame_times.push_back(sec);
+            for(int seq = FRONT; seq < CAMDIR_END; seq++)
+                if(ret[seq] != 1)
+                    not_stitched++;
+        }
+        frames++;
+    }
+
+    if(frames == 0) {
+        cerr << "no frame in " << input << endl;
+        return 1;
+    }
+
+    double total = 0;
+    for(size_t i = 0; i < frame_times.size(); i++)
+        total += frame_times[i];
+
+    printf("{\n");
+    printf("  \"input\": \"%s\",\n", JsonEscape(input).c_str());
+    printf("  \"width\": %d, \"height\": %d,\n", in_size.width, in_size.height);
+    printf("  \"output_width\": %d, \"output_height\": %d,\n", out_width, out_height);
+    printf("  \"path\": \"%s\",\n", planar ? "planar" : "bgr");
+    printf("  \"features\": \"%s\",\n", features.c_str());
+    printf("  \"frames\": %d, \"warmup\": %d,\n", frames, warmup);
+    printf("  \"calibrations\": %d, \"calibrations_failed\": %d,\n", calib_runs, calib_failed);
+    printf("  \"directions_not_stitched\": %d,\n", not_stitched);
+    printf("  \"fps\": %.2f,\n", total > 0 ? frame_times.size() / total : 0.);
+    printf("  \"peak_rss_kb\": %ld,\n", PeakRSS());
+    printf("  \"stages\": {\n");
+    for(int s = 0; s < STAGE_END; s++)
+        PrintStats(stitchStageName[s], profiler.samples[s], false);
+    PrintStats("frame", frame_times, true);
+    printf("  }\n");
+    printf("}\n");
+
+    return 0;
+}